@@ -0,0 +1,231 @@
+// manitc_bench: compiler throughput benchmarks over synthetic programs.
+//
+// Each workload is generated at its base size and at twice that size. Lexer,
+// parser and codegen are timed separately over repeated runs; the harness
+// reports throughput statistics, flags phases whose time grows superlinearly
+// with input size, and compares median throughput against a baseline file so
+// CI can fail on regressions.
+
+#include "program_generators.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "codegen.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct BenchOptions {
+    int repeat = 7;
+    double scale = 1.0;
+    std::string filter;
+    std::string baseline_path;
+    std::string write_baseline_path;
+    double tolerance = 0.15;   // Allowed median throughput drop vs. baseline
+    double max_scaling = 3.0;  // Allowed time(2n)/time(n) before a phase counts as superlinear
+};
+
+struct Stats {
+    double min = 0, median = 0, mean = 0, stddev = 0;
+};
+
+static Stats compute_stats(std::vector<double> samples) {
+    Stats s;
+    if (samples.empty()) return s;
+    std::sort(samples.begin(), samples.end());
+    s.min = samples.front();
+    size_t mid = samples.size() / 2;
+    s.median = samples.size() % 2 ? samples[mid] : (samples[mid - 1] + samples[mid]) / 2;
+    s.mean = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+    double var = 0;
+    for (double x : samples) var += (x - s.mean) * (x - s.mean);
+    s.stddev = std::sqrt(var / samples.size());
+    return s;
+}
+
+static double time_ms(const std::function<void()>& fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+struct PhaseTimes {
+    Stats lex, parse, codegen; // parse excludes the lexing it drives
+    std::uint64_t bytes = 0;
+};
+
+// Times each phase on source; false if the source does not parse.
+static bool run_workload(const std::string& source, int repeat, PhaseTimes& t) {
+    std::vector<double> lex_ms, parse_ms, codegen_ms;
+    // The first iteration warms caches and the allocator and is discarded.
+    for (int r = -1; r < repeat; ++r) {
+        double lex = time_ms([&]() {
+            Lexer l(source);
+            while (l.next_token().type != TokenType::END_OF_FILE) {}
+        });
+
+        std::unique_ptr<Program> program;
+        double parse = time_ms([&]() {
+            Lexer l(source);
+            Parser p(l);
+            program = p.parse_program();
+        });
+        if (!program) return false;
+
+        double codegen = time_ms([&]() {
+            CodeGenerator generator;
+            generator.generate(*program);
+        });
+
+        if (r < 0) continue;
+        lex_ms.push_back(lex);
+        parse_ms.push_back(parse);
+        codegen_ms.push_back(codegen);
+    }
+
+    t.bytes = source.size();
+    t.lex = compute_stats(lex_ms);
+    t.parse = compute_stats(parse_ms);
+    t.parse.min = std::max(t.parse.min - t.lex.min, 1e-6);
+    t.parse.median = std::max(t.parse.median - t.lex.median, 1e-6);
+    t.parse.mean = std::max(t.parse.mean - t.lex.mean, 1e-6);
+    t.codegen = compute_stats(codegen_ms);
+    return true;
+}
+
+// Throughput in MB/s of source text for a phase time in ms.
+static double throughput(std::uint64_t bytes, double ms) {
+    return ms > 0 ? (bytes / 1e6) / (ms / 1e3) : 0;
+}
+
+static std::map<std::string, double> read_baseline(const std::string& path) {
+    std::map<std::string, double> baseline;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::stringstream ss(line);
+        std::string workload, phase;
+        double mbps;
+        if (ss >> workload >> phase >> mbps) baseline[workload + "/" + phase] = mbps;
+    }
+    return baseline;
+}
+
+static void print_usage(const char* argv0) {
+    std::cerr << "Usage: " << argv0 << " [options]\n"
+              << "  --repeat=N              Runs per measurement (default: 7)\n"
+              << "  --scale=F               Multiply every workload's base size (default: 1)\n"
+              << "  --filter=name           Only run workloads whose name contains `name`\n"
+              << "  --baseline=file         Fail if median MB/s drops below baseline by more than the tolerance\n"
+              << "  --tolerance=F           Allowed throughput drop as a fraction (default: 0.15)\n"
+              << "  --write-baseline=file   Record current median MB/s as the new baseline\n"
+              << "  --max-scaling=F         Allowed time(2n)/time(n) ratio (default: 3.0)\n";
+}
+
+static bool starts_with(const std::string& s, const std::string& prefix) {
+    return s.compare(0, prefix.size(), prefix) == 0;
+}
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&arg]() { return arg.substr(arg.find('=') + 1); };
+        if (starts_with(arg, "--repeat=")) options.repeat = std::max(1, std::stoi(value()));
+        else if (starts_with(arg, "--scale=")) options.scale = std::stod(value());
+        else if (starts_with(arg, "--filter=")) options.filter = value();
+        else if (starts_with(arg, "--baseline=")) options.baseline_path = value();
+        else if (starts_with(arg, "--tolerance=")) options.tolerance = std::stod(value());
+        else if (starts_with(arg, "--write-baseline=")) options.write_baseline_path = value();
+        else if (starts_with(arg, "--max-scaling=")) options.max_scaling = std::stod(value());
+        else { print_usage(argv[0]); return 1; }
+    }
+
+    std::map<std::string, double> baseline;
+    if (!options.baseline_path.empty()) {
+        baseline = read_baseline(options.baseline_path);
+        if (baseline.empty()) {
+            std::cerr << "Error: Could not read baseline '" << options.baseline_path << "'" << std::endl;
+            return 1;
+        }
+    }
+
+    std::stringstream recorded;
+    recorded << "# workload phase median_MB_per_s\n";
+    int failures = 0;
+
+    std::cout << std::left << std::setw(18) << "Workload" << std::setw(9) << "Phase" << std::right
+              << std::setw(8) << "Size" << std::setw(12) << "Median ms" << std::setw(10) << "Min ms"
+              << std::setw(10) << "Stddev" << std::setw(10) << "MB/s" << std::setw(9) << "2n/n" << "  Status\n";
+    std::cout << std::fixed;
+
+    for (const auto& workload : all_workloads()) {
+        if (!options.filter.empty() && std::string(workload.name).find(options.filter) == std::string::npos) continue;
+
+        std::size_t size = std::max<std::size_t>(1, static_cast<std::size_t>(workload.base_size * options.scale));
+        PhaseTimes small, large;
+        if (!run_workload(workload.generate(size), options.repeat, small) ||
+            !run_workload(workload.generate(size * 2), options.repeat, large)) {
+            std::cerr << "Error: The generated '" << workload.name << "' program does not parse" << std::endl;
+            ++failures;
+            continue;
+        }
+
+        struct Row { const char* phase; const Stats& small; const Stats& large; };
+        for (const Row& row : {Row{"lex", small.lex, large.lex}, Row{"parse", small.parse, large.parse},
+                               Row{"codegen", small.codegen, large.codegen}}) {
+            double mbps = throughput(small.bytes, row.small.median);
+            // Normalize by the actual growth of the source, which is only roughly 2x.
+            double byte_ratio = static_cast<double>(large.bytes) / small.bytes;
+            // Fastest runs are the least noisy estimate of the cost itself.
+            double scaling = row.small.min > 0 ? (row.large.min / row.small.min) * (2.0 / byte_ratio) : 0;
+            std::string status = "ok";
+
+            // Sub-millisecond phases are dominated by noise; only judge scaling above that.
+            if (row.small.median >= 1.0 && scaling > options.max_scaling) {
+                status = "SUPERLINEAR";
+                ++failures;
+            }
+            std::string key = std::string(workload.name) + "/" + row.phase;
+            auto it = baseline.find(key);
+            if (it != baseline.end() && mbps < it->second * (1.0 - options.tolerance)) {
+                std::stringstream msg;
+                msg << std::fixed << std::setprecision(2) << "REGRESSED (baseline " << it->second << ")";
+                status = status == "ok" ? msg.str() : status + ", " + msg.str();
+                ++failures;
+            }
+
+            std::cout << std::left << std::setw(18) << workload.name << std::setw(9) << row.phase << std::right
+                      << std::setw(8) << size << std::setprecision(3) << std::setw(12) << row.small.median
+                      << std::setw(10) << row.small.min << std::setw(10) << row.small.stddev
+                      << std::setprecision(2) << std::setw(10) << mbps << std::setw(9) << scaling
+                      << "  " << status << "\n";
+            recorded << workload.name << " " << row.phase << " " << std::fixed << std::setprecision(3) << mbps << "\n";
+        }
+    }
+
+    if (!options.write_baseline_path.empty()) {
+        std::ofstream out(options.write_baseline_path);
+        if (!out.is_open()) {
+            std::cerr << "Error: Could not write baseline '" << options.write_baseline_path << "'" << std::endl;
+            return 1;
+        }
+        out << recorded.str();
+    }
+
+    if (failures) {
+        std::cerr << failures << " benchmark check(s) failed." << std::endl;
+        return 1;
+    }
+    return 0;
+}
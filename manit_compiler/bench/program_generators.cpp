@@ -0,0 +1,97 @@
+#include "program_generators.hpp"
+#include <sstream>
+
+std::string generate_many_functions(std::size_t count) {
+    std::stringstream ss;
+    ss << "let f0 = fn(a, b) { return a + b; };\n";
+    for (std::size_t i = 1; i < count; ++i) {
+        ss << "let f" << i << " = fn(a, b) {\n"
+           << "    let t = a * " << (i % 7 + 1) << " - b;\n"
+           << "    return f" << (i - 1) << "(t, b) + 1;\n"
+           << "};\n";
+    }
+    ss << "let main = fn() { return f" << (count - 1) << "(1, 2); };\n";
+    return ss.str();
+}
+
+std::string generate_many_scopes(std::size_t count) {
+    std::stringstream ss;
+    for (std::size_t i = 0; i < count; ++i) {
+        ss << "var v" << i << " = " << i << ";\n";
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+        ss << "let g" << i << " = fn(x) { var y = x + " << i << "; return y * 2; };\n";
+    }
+    // Call every function so reachability-driven codegen generates them all.
+    for (std::size_t i = 0; i < count; ++i) {
+        ss << "v" << i << " = g" << i << "(v" << i << ");\n";
+    }
+    return ss.str();
+}
+
+std::string generate_nested_ifs(std::size_t depth) {
+    std::stringstream ss;
+    ss << "let pick = fn(x) {\n    return ";
+    for (std::size_t i = 0; i < depth; ++i) {
+        ss << "if (x > " << i << ") { ";
+    }
+    ss << "x";
+    for (std::size_t i = depth; i-- > 0;) {
+        ss << " } else { x - " << i << " }";
+    }
+    ss << ";\n};\n";
+    ss << "let main = fn() { return pick(" << depth / 2 << "); };\n";
+    return ss.str();
+}
+
+std::string generate_expression_chain(std::size_t terms) {
+    std::stringstream ss;
+    ss << "let chain = fn(a, b) {\n    return a";
+    const char* ops[] = {" + ", " - ", " * ", " + "};
+    for (std::size_t i = 1; i < terms; ++i) {
+        ss << ops[i % 4] << (i % 3 == 0 ? "b" : (i % 3 == 1 ? "a" : std::to_string(i % 97)));
+    }
+    ss << ";\n};\n";
+    ss << "let main = fn() { return chain(3, 4); };\n";
+    return ss.str();
+}
+
+std::string generate_big_array(std::size_t elements) {
+    std::stringstream ss;
+    ss << "let data = [";
+    for (std::size_t i = 0; i < elements; ++i) {
+        ss << (i ? ", " : "") << (i * 31 % 1000);
+    }
+    ss << "];\n";
+    ss << "var sum = 0;\n"
+       << "for (var i = 0; i < " << elements << "; i = i + 1) { sum = sum + data[i]; };\n"
+       << "sum;\n";
+    return ss.str();
+}
+
+std::string generate_deep_loops(std::size_t depth) {
+    std::stringstream ss;
+    ss << "let nest = fn(n) {\n    var total = 0;\n";
+    for (std::size_t i = 0; i < depth; ++i) {
+        ss << "for (var i" << i << " = 0; i" << i << " < n; i" << i << " = i" << i << " + 1) {\n";
+    }
+    ss << "total = total + 1;\n";
+    for (std::size_t i = 0; i < depth; ++i) {
+        ss << "};\n";
+    }
+    ss << "    return total;\n};\n";
+    ss << "let main = fn() { return nest(1); };\n";
+    return ss.str();
+}
+
+const std::vector<Workload>& all_workloads() {
+    static const std::vector<Workload> workloads = {
+        {"many_functions", "chained functions", generate_many_functions, 2000},
+        {"many_scopes", "top-level vars + functions", generate_many_scopes, 1000},
+        {"nested_ifs", "nested if/else expressions", generate_nested_ifs, 200},
+        {"expression_chain", "long infix expression", generate_expression_chain, 2000},
+        {"big_array", "large array literal", generate_big_array, 5000},
+        {"deep_loops", "nested for loops", generate_deep_loops, 100},
+    };
+    return workloads;
+}
@@ -0,0 +1,33 @@
+#ifndef MANIT_BENCH_PROGRAM_GENERATORS_HPP
+#define MANIT_BENCH_PROGRAM_GENERATORS_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Synthesizes a ManiT source whose size grows with `size`.
+using ProgramGenerator = std::string (*)(std::size_t size);
+
+struct Workload {
+    const char* name;
+    const char* description;
+    ProgramGenerator generate;
+    std::size_t base_size; // Size used at --scale=1
+};
+
+// Thousands of small functions, each calling its predecessor.
+std::string generate_many_functions(std::size_t count);
+// Top-level variables followed by functions: stresses per-function scope handling.
+std::string generate_many_scopes(std::size_t count);
+// A value-producing if/else nested `depth` levels deep.
+std::string generate_nested_ifs(std::size_t depth);
+// One return expression with `terms` operands.
+std::string generate_expression_chain(std::size_t terms);
+// An array literal with `elements` entries, then a reduction over it.
+std::string generate_big_array(std::size_t elements);
+// `depth` nested for loops.
+std::string generate_deep_loops(std::size_t depth);
+
+const std::vector<Workload>& all_workloads();
+
+#endif // MANIT_BENCH_PROGRAM_GENERATORS_HPP
@@ -0,0 +1,9 @@
+/* Recursive Fibonacci: call overhead and branch prediction. */
+static int fib(int n) {
+    if (n < 2) return n;
+    return fib(n - 1) + fib(n - 2);
+}
+
+int main(void) {
+    return fib(32);
+}
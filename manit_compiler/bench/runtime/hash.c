@@ -0,0 +1,12 @@
+/* Polynomial hashing into a 1024-bucket histogram. */
+int main(void) {
+    int table[1024] = {0};
+    int h = 7;
+    for (int i = 0; i < 20000000; i = i + 1) {
+        h = h * 31 + i;
+        h = h - (h / 1000003) * 1000003;
+        int bucket = h - (h / 1024) * 1024;
+        table[bucket] = table[bucket] + 1;
+    }
+    return h + table[h - (h / 1024) * 1024];
+}
@@ -0,0 +1,20 @@
+/* 16x16 integer matrix multiply, repeated. */
+int main(void) {
+    int a[256] = {0}, b[256] = {0}, c[256] = {0};
+    for (int i = 0; i < 256; i = i + 1) {
+        a[i] = i - (i / 7) * 7;
+        b[i] = i - (i / 5) * 5 + 1;
+    }
+    int checksum = 0;
+    for (int rep = 0; rep < 10000; rep = rep + 1) {
+        for (int i = 0; i < 16; i = i + 1) {
+            for (int j = 0; j < 16; j = j + 1) {
+                int s = 0;
+                for (int k = 0; k < 16; k = k + 1) s = s + a[i * 16 + k] * b[k * 16 + j];
+                c[i * 16 + j] = s + rep;
+            }
+        }
+        checksum = checksum + c[rep - (rep / 256) * 256];
+    }
+    return checksum;
+}
@@ -0,0 +1,16 @@
+/* Sum and max reductions over a 1024-entry array, repeated. */
+int main(void) {
+    int data[1024] = {0};
+    for (int i = 0; i < 1024; i = i + 1) data[i] = i * 37 - ((i * 37) / 1000) * 1000;
+    int total = 0;
+    for (int rep = 0; rep < 50000; rep = rep + 1) {
+        int sum = 0;
+        int max = 0;
+        for (int i = 0; i < 1024; i = i + 1) {
+            sum = sum + data[i];
+            if (data[i] > max) max = data[i];
+        }
+        total = total + sum / 1024 + max - rep / 1000;
+    }
+    return total;
+}
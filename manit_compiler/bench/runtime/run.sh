@@ -0,0 +1,78 @@
+#!/bin/bash
+# Runtime benchmarks: ManiT kernels vs. equivalent C at each optimization level.
+#
+# For every kernel K in this directory (K.manit + K.c) and level N:
+#   manitc -ON K.manit > K.ll ; llc -ON K.ll ; cc K.o        (ManiT)
+#   cc -ON K.c                                                 (C baseline)
+# Both binaries run RUNS times; the table shows median wall time and the
+# ManiT/C ratio. Exit codes (the kernel checksum) must match.
+#
+# Environment: MANITC (default ../../build/manitc), LLC, CC, RUNS (default 5),
+#              LEVELS (default "0 1 2 3"), KERNELS (default: all).
+
+set -u
+here=$(cd "$(dirname "$0")" && pwd)
+MANITC=${MANITC:-$here/../../build/manitc}
+LLC=${LLC:-llc}
+CC=${CC:-cc}
+RUNS=${RUNS:-5}
+LEVELS=${LEVELS:-"0 1 2 3"}
+KERNELS=${KERNELS:-$(cd "$here" && ls *.manit | sed 's/\.manit$//')}
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+# Prints "<median_ms> <exit_code>" for RUNS executions of $1.
+measure() {
+    local exe=$1 times=() code=0 start end
+    for ((r = 0; r < RUNS; r++)); do
+        start=$(date +%s%N)
+        "$exe"
+        code=$?
+        end=$(date +%s%N)
+        times+=($(( (end - start) / 1000 )))
+    done
+    local median
+    median=$(printf '%s\n' "${times[@]}" | sort -n | awk '{ v[NR] = $1 } END { print (NR % 2) ? v[(NR + 1) / 2] : (v[NR / 2] + v[NR / 2 + 1]) / 2 }')
+    echo "$(awk -v us="$median" 'BEGIN { printf "%.2f", us / 1000 }') $code"
+}
+
+failures=0
+printf '%-8s %-4s %12s %12s %8s  %s\n' "Kernel" "Opt" "ManiT (ms)" "C (ms)" "Ratio" "Status"
+for level in $LEVELS; do
+    ratios=()
+    for kernel in $KERNELS; do
+        src="$here/$kernel"
+        exe_manit="$work/$kernel.O$level.manit"
+        exe_c="$work/$kernel.O$level.c"
+        if ! "$MANITC" "-O$level" "$src.manit" > "$work/$kernel.ll" ||
+           ! "$LLC" "-O$level" -relocation-model=pic -filetype=obj "$work/$kernel.ll" -o "$work/$kernel.o" ||
+           ! "$CC" "$work/$kernel.o" -o "$exe_manit"; then
+            printf '%-8s -O%-2s %12s %12s %8s  %s\n' "$kernel" "$level" "-" "-" "-" "BUILD FAILED (manit)"
+            failures=$((failures + 1))
+            continue
+        fi
+        if ! "$CC" "-O$level" "$src.c" -o "$exe_c"; then
+            printf '%-8s -O%-2s %12s %12s %8s  %s\n' "$kernel" "$level" "-" "-" "-" "BUILD FAILED (c)"
+            failures=$((failures + 1))
+            continue
+        fi
+
+        read -r manit_ms manit_code <<< "$(measure "$exe_manit")"
+        read -r c_ms c_code <<< "$(measure "$exe_c")"
+        ratio=$(awk -v m="$manit_ms" -v c="$c_ms" 'BEGIN { printf "%.2f", (c > 0) ? m / c : 0 }')
+        status="ok"
+        if [ "$manit_code" != "$c_code" ]; then
+            status="MISMATCH (manit=$manit_code c=$c_code)"
+            failures=$((failures + 1))
+        fi
+        ratios+=("$ratio")
+        printf '%-8s -O%-2s %12s %12s %8s  %s\n' "$kernel" "$level" "$manit_ms" "$c_ms" "$ratio" "$status"
+    done
+    if [ ${#ratios[@]} -gt 0 ]; then
+        geomean=$(printf '%s\n' "${ratios[@]}" | awk '$1 > 0 { s += log($1); n++ } END { if (n) printf "%.2f", exp(s / n) }')
+        printf '%-8s -O%-2s %12s %12s %8s\n' "geomean" "$level" "" "" "$geomean"
+    fi
+done
+
+exit $((failures > 0))
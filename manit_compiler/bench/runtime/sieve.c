@@ -0,0 +1,17 @@
+/* Sieve of Eratosthenes over 1024 entries, repeated. */
+int main(void) {
+    int flags[1024] = {0};
+    int count = 0;
+    for (int rep = 0; rep < 20000; rep = rep + 1) {
+        for (int i = 0; i < 1024; i = i + 1) flags[i] = 1;
+        flags[0] = 0;
+        flags[1] = 0;
+        for (int p = 2; p * p < 1024; p = p + 1) {
+            if (flags[p] == 1) {
+                for (int m = p * p; m < 1024; m = m + p) flags[m] = 0;
+            }
+        }
+        for (int k = 0; k < 1024; k = k + 1) count = count + flags[k];
+    }
+    return count;
+}
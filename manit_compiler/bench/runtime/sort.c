@@ -0,0 +1,24 @@
+/* Insertion sort of 512 pseudo-random values, repeated. */
+int main(void) {
+    int arr[512] = {0};
+    int seed = 1;
+    int check = 0;
+    for (int rep = 0; rep < 1000; rep = rep + 1) {
+        for (int i = 0; i < 512; i = i + 1) {
+            seed = seed * 75 + 74;
+            seed = seed - (seed / 65537) * 65537;
+            arr[i] = seed;
+        }
+        for (int i = 1; i < 512; i = i + 1) {
+            int key = arr[i];
+            int j = i - 1;
+            while (j >= 0 && arr[j] > key) {
+                arr[j + 1] = arr[j];
+                j = j - 1;
+            }
+            arr[j + 1] = key;
+        }
+        check = check + arr[0] + arr[511] / 64;
+    }
+    return check;
+}
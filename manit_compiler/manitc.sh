@@ -1,6 +1,6 @@
 #!/bin/bash
 mkdir -p build
-clang++ -std=c++17 src/main.cpp src/lexer.cpp src/parser.cpp src/codegen.cpp src/ast.cpp $(llvm-config --cxxflags --ldflags --system-libs --libs core) -o build/manitc
+clang++ -std=c++17 src/main.cpp src/symbol.cpp src/lexer.cpp src/source_map.cpp src/parser.cpp src/codegen.cpp src/interface.cpp src/optimizer.cpp src/abi.cpp src/noalias.cpp src/attributes.cpp src/instrumentation.cpp src/lto.cpp src/target.cpp src/timing.cpp src/driver.cpp src/server.cpp src/thread_pool.cpp src/ast.cpp $(llvm-config --cxxflags --ldflags --system-libs --libs core passes bitwriter lto native) -lpthread -o build/manitc
 echo "Running ManiT program..."
 ./build/manitc | lli
 result=$?
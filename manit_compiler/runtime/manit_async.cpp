@@ -0,0 +1,204 @@
+// manit_async: single-threaded runtime for `async fn` tasks.
+//
+// The compiler lowers async functions to LLVM switched-resume coroutines.
+// A task handle is the coroutine frame; like every switched-resume frame it
+// starts with its resume and destroy function pointers, which is all this
+// runtime needs to know about it. Completion, results and the awaiting task
+// are kept in the frame's promise and handled by generated code.
+//
+// The event loop owns three kinds of pending work: tasks ready to resume,
+// timers (a min-heap, which sets the epoll_wait timeout) and file
+// descriptors registered with epoll. Everything runs on the thread that
+// calls the loop; the runtime is not thread-safe.
+//
+// Frames come from __manit_frame_alloc, which keeps freed frames on
+// per-size free lists so that short-lived tasks do not go through malloc.
+// Frames that LLVM's CoroElide places in the caller never reach it.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <vector>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+namespace {
+
+// Layout of the start of every switched-resume coroutine frame.
+struct FramePrefix {
+    void (*resume)(void*);
+    void (*destroy)(void*);
+};
+
+void resume(void* handle) { static_cast<FramePrefix*>(handle)->resume(handle); }
+void destroy(void* handle) { static_cast<FramePrefix*>(handle)->destroy(handle); }
+
+// Frame allocation: sizes are rounded to 64-byte classes up to max_pooled and
+// freed frames are kept for reuse. The header records the class.
+constexpr std::uint64_t granule = 64;
+constexpr std::uint64_t max_pooled = 4096;
+constexpr std::uint64_t header = 16; // Keeps frames 16-byte aligned
+
+struct FreeFrame {
+    FreeFrame* next;
+};
+
+FreeFrame* free_lists[max_pooled / granule + 1];
+
+struct Timer {
+    std::chrono::steady_clock::time_point due;
+    std::uint64_t sequence; // Orders timers with the same deadline by creation
+    void* handle;
+    bool operator>(const Timer& other) const {
+        return due != other.due ? due > other.due : sequence > other.sequence;
+    }
+};
+
+struct Loop {
+    std::deque<void*> ready;      // Tasks to resume
+    std::vector<void*> reap;      // Finished detached tasks to destroy
+    std::vector<Timer> timers;    // Min-heap on due
+    std::uint64_t timer_sequence = 0;
+    int epoll_fd = -1;
+    unsigned waiting_fds = 0;     // Tasks suspended on epoll
+};
+
+Loop& loop() {
+    static Loop instance;
+    return instance;
+}
+
+int epoll_instance() {
+    Loop& l = loop();
+    if (l.epoll_fd < 0) {
+        l.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (l.epoll_fd < 0) {
+            std::perror("manit: epoll_create1");
+            std::abort();
+        }
+    }
+    return l.epoll_fd;
+}
+
+bool has_work() {
+    Loop& l = loop();
+    return !l.ready.empty() || !l.reap.empty() || !l.timers.empty() || l.waiting_fds > 0;
+}
+
+// Runs everything that is ready, then waits for the next timer or descriptor.
+void run_once() {
+    Loop& l = loop();
+    while (!l.ready.empty() || !l.reap.empty()) {
+        while (!l.ready.empty()) {
+            void* handle = l.ready.front();
+            l.ready.pop_front();
+            resume(handle);
+        }
+        // Destroyed only here: a task cannot free its own frame while suspending.
+        std::vector<void*> finished;
+        finished.swap(l.reap);
+        for (void* handle : finished) destroy(handle);
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    while (!l.timers.empty() && l.timers.front().due <= now) {
+        std::pop_heap(l.timers.begin(), l.timers.end(), std::greater<Timer>());
+        l.ready.push_back(l.timers.back().handle);
+        l.timers.pop_back();
+    }
+    if (!l.ready.empty() || (l.timers.empty() && l.waiting_fds == 0)) return;
+
+    int timeout = -1;
+    if (!l.timers.empty()) {
+        auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(l.timers.front().due - now).count();
+        timeout = static_cast<int>(std::max<long long>(1, wait));
+    }
+    if (l.waiting_fds == 0) {
+        // Timers only: there is nothing for epoll to report, just sleep.
+        usleep(static_cast<useconds_t>(timeout) * 1000);
+        return;
+    }
+    epoll_event events[64];
+    int count = epoll_wait(epoll_instance(), events, 64, timeout);
+    for (int i = 0; i < count; ++i) {
+        --l.waiting_fds;
+        l.ready.push_back(events[i].data.ptr);
+    }
+}
+
+} // namespace
+
+extern "C" void* __manit_frame_alloc(std::uint64_t size) {
+    std::uint64_t size_class = (size + granule - 1) / granule;
+    if (size_class * granule <= max_pooled && free_lists[size_class]) {
+        FreeFrame* frame = free_lists[size_class];
+        free_lists[size_class] = frame->next;
+        return frame;
+    }
+    auto* block = static_cast<char*>(std::malloc(header + size_class * granule));
+    if (!block) {
+        std::fprintf(stderr, "manit: out of memory allocating a task frame\n");
+        std::abort();
+    }
+    *reinterpret_cast<std::uint64_t*>(block) = size_class;
+    return block + header;
+}
+
+extern "C" void __manit_frame_free(void* frame) {
+    char* block = static_cast<char*>(frame) - header;
+    std::uint64_t size_class = *reinterpret_cast<std::uint64_t*>(block);
+    if (size_class * granule > max_pooled) {
+        std::free(block);
+        return;
+    }
+    auto* free_frame = static_cast<FreeFrame*>(frame);
+    free_frame->next = free_lists[size_class];
+    free_lists[size_class] = free_frame;
+}
+
+// Resumes handle from the event loop.
+extern "C" void __manit_schedule(void* handle) {
+    loop().ready.push_back(handle);
+}
+
+// Destroys a finished task that nobody awaits once it has suspended.
+extern "C" void __manit_destroy_later(void* handle) {
+    loop().reap.push_back(handle);
+}
+
+// Resumes handle after milliseconds have passed.
+extern "C" void __manit_sleep(void* handle, std::int32_t milliseconds) {
+    Loop& l = loop();
+    auto due = std::chrono::steady_clock::now() + std::chrono::milliseconds(std::max(0, milliseconds));
+    l.timers.push_back({due, l.timer_sequence++, handle});
+    std::push_heap(l.timers.begin(), l.timers.end(), std::greater<Timer>());
+}
+
+// Resumes handle once fd is readable (or has hung up).
+extern "C" void __manit_wait_readable(void* handle, std::int32_t fd) {
+    epoll_event event = {};
+    event.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+    event.data.ptr = handle;
+    int epoll_fd = epoll_instance();
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &event) != 0 && epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) {
+        std::perror("manit: epoll_ctl");
+        __manit_schedule(handle); // Resume rather than hang; the read reports the error
+        return;
+    }
+    ++loop().waiting_fds;
+}
+
+// Runs the event loop until *state becomes nonzero, or with a null state
+// until no work is left. A task that can no longer complete is fatal.
+extern "C" void __manit_run_until(const std::int32_t* state) {
+    while (state ? *state == 0 : has_work()) {
+        if (!has_work()) {
+            std::fprintf(stderr, "manit: awaited task can never complete\n");
+            std::abort();
+        }
+        run_once();
+    }
+}
@@ -0,0 +1,216 @@
+// manit_prof: runtime for programs compiled with `manitc --instrument=functions`.
+//
+// Every instrumented function calls __manit_prof_enter on entry and
+// __manit_prof_exit before each return. Each thread keeps its own counters and
+// shadow stack, so after a function's first call the hooks take no locks and
+// do no atomic read-modify-writes: one TLS lookup, one timestamp and a few
+// stores. Times are TSC cycles on x86 (steady_clock nanoseconds elsewhere),
+// converted to wall time when reporting.
+//
+// A report covering all threads is written at exit and each time the
+// process receives SIGUSR1.
+//
+// Environment:
+//   MANIT_PROF_OUT=path     Append reports to path instead of stderr
+//   MANIT_PROF_FORMAT=json  One JSON object per report (default: table)
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace {
+
+constexpr std::uint32_t max_functions = 4096; // Functions past this are not tracked
+constexpr std::uint32_t max_depth = 1024;     // Deeper frames count calls but not time
+
+// Layout matches %manit.prof_site emitted by the compiler.
+struct Site {
+    const char* name;
+    std::atomic<std::uint32_t> id; // 0 until the first call registers the function
+};
+
+// Written only by the owning thread; atomics let reports read them while it runs.
+struct Counters {
+    std::atomic<std::uint64_t> calls{0};
+    std::atomic<std::uint64_t> inclusive{0};
+    std::atomic<std::uint64_t> exclusive{0};
+};
+
+struct Frame {
+    std::uint32_t id;
+    std::uint64_t start;
+    std::uint64_t children; // Time spent in callees, subtracted for exclusive time
+};
+
+struct ThreadData {
+    Counters counters[max_functions];
+    std::uint32_t active[max_functions] = {}; // Live frames per function; recursion adds inclusive time once
+    Frame stack[max_depth];
+    std::uint32_t depth = 0;
+    ThreadData* next = nullptr;
+};
+
+std::atomic<std::uint32_t> next_id{1};
+std::atomic<const char*> names[max_functions];
+std::atomic<ThreadData*> all_threads{nullptr};
+thread_local ThreadData* current_thread = nullptr;
+
+std::uint64_t start_ticks;
+std::chrono::steady_clock::time_point start_time;
+int signal_pipe[2] = {-1, -1};
+
+inline std::uint64_t read_timer() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+inline void add(std::atomic<std::uint64_t>& counter, std::uint64_t value) {
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+// Threads are never unregistered: their counters stay in the report after they exit.
+ThreadData* thread_data() {
+    ThreadData* t = current_thread;
+    if (t) return t;
+    t = new ThreadData();
+    t->next = all_threads.load(std::memory_order_relaxed);
+    while (!all_threads.compare_exchange_weak(t->next, t, std::memory_order_release, std::memory_order_relaxed)) {}
+    current_thread = t;
+    return t;
+}
+
+std::uint32_t site_id(Site* site) {
+    std::uint32_t id = site->id.load(std::memory_order_acquire);
+    if (id) return id;
+    std::uint32_t fresh = next_id.fetch_add(1, std::memory_order_relaxed);
+    if (fresh >= max_functions) fresh = max_functions;
+    else names[fresh].store(site->name, std::memory_order_release);
+    // If another thread registered the site first, its id wins and ours stays unused.
+    std::uint32_t expected = 0;
+    return site->id.compare_exchange_strong(expected, fresh, std::memory_order_acq_rel) ? fresh : expected;
+}
+
+struct Row {
+    const char* name;
+    std::uint64_t calls, inclusive, exclusive;
+};
+
+void write_report() {
+    std::uint32_t count = std::min(next_id.load(std::memory_order_acquire), max_functions);
+    std::vector<Row> rows;
+    std::uint64_t total_exclusive = 0;
+    unsigned thread_count = 0;
+    for (ThreadData* t = all_threads.load(std::memory_order_acquire); t; t = t->next) ++thread_count;
+    for (std::uint32_t id = 1; id < count; ++id) {
+        Row row = {names[id].load(std::memory_order_acquire), 0, 0, 0};
+        for (ThreadData* t = all_threads.load(std::memory_order_acquire); t; t = t->next) {
+            row.calls += t->counters[id].calls.load(std::memory_order_relaxed);
+            row.inclusive += t->counters[id].inclusive.load(std::memory_order_relaxed);
+            row.exclusive += t->counters[id].exclusive.load(std::memory_order_relaxed);
+        }
+        if (!row.name || !row.calls) continue;
+        total_exclusive += row.exclusive;
+        rows.push_back(row);
+    }
+    std::sort(rows.begin(), rows.end(), [](const Row& a, const Row& b) { return a.exclusive > b.exclusive; });
+
+    double elapsed_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start_time).count();
+    double ticks_per_ns = elapsed_ns > 0 ? (read_timer() - start_ticks) / elapsed_ns : 1.0;
+    if (ticks_per_ns <= 0) ticks_per_ns = 1.0;
+    auto to_ms = [ticks_per_ns](std::uint64_t ticks) { return ticks / ticks_per_ns / 1e6; };
+
+    const char* path = std::getenv("MANIT_PROF_OUT");
+    FILE* out = path && *path ? std::fopen(path, "a") : stderr;
+    if (!out) out = stderr;
+    const char* format = std::getenv("MANIT_PROF_FORMAT");
+
+    if (format && std::strcmp(format, "json") == 0) {
+        std::fprintf(out, "{\"threads\": %u, \"ticks_per_ns\": %.4f, \"functions\": [", thread_count, ticks_per_ns);
+        for (size_t i = 0; i < rows.size(); ++i) {
+            const Row& r = rows[i];
+            std::fprintf(out, "%s{\"name\": \"%s\", \"calls\": %llu, \"inclusive_ticks\": %llu, \"exclusive_ticks\": %llu, "
+                              "\"inclusive_ms\": %.3f, \"exclusive_ms\": %.3f}",
+                         i ? ", " : "", r.name, static_cast<unsigned long long>(r.calls),
+                         static_cast<unsigned long long>(r.inclusive), static_cast<unsigned long long>(r.exclusive),
+                         to_ms(r.inclusive), to_ms(r.exclusive));
+        }
+        std::fprintf(out, "]}\n");
+    } else {
+        std::fprintf(out, "ManiT function profile (%u thread%s)\n", thread_count, thread_count == 1 ? "" : "s");
+        std::fprintf(out, "%-32s %12s %12s %12s %7s %12s\n", "Function", "Calls", "Incl (ms)", "Excl (ms)", "Excl %", "Avg (ns)");
+        for (const Row& r : rows) {
+            double share = total_exclusive ? 100.0 * r.exclusive / total_exclusive : 0.0;
+            double average_ns = r.inclusive / ticks_per_ns / r.calls;
+            std::fprintf(out, "%-32s %12llu %12.3f %12.3f %6.1f%% %12.1f\n", r.name,
+                         static_cast<unsigned long long>(r.calls), to_ms(r.inclusive), to_ms(r.exclusive), share, average_ns);
+        }
+    }
+    std::fflush(out);
+    if (out != stderr) std::fclose(out);
+}
+
+// The handler only writes to a pipe; the watcher thread does the reporting
+// outside signal context.
+void on_report_signal(int) {
+    char byte = 1;
+    ssize_t ignored = write(signal_pipe[1], &byte, 1);
+    (void)ignored;
+}
+
+void watch_report_signal() {
+    char byte;
+    while (read(signal_pipe[0], &byte, 1) == 1) write_report();
+}
+
+struct Startup {
+    Startup() {
+        start_ticks = read_timer();
+        start_time = std::chrono::steady_clock::now();
+        std::atexit(write_report);
+        if (pipe(signal_pipe) == 0) {
+            std::thread(watch_report_signal).detach();
+            std::signal(SIGUSR1, on_report_signal);
+        }
+    }
+} startup;
+
+} // namespace
+
+extern "C" void __manit_prof_enter(Site* site) {
+    std::uint32_t id = site_id(site);
+    if (id >= max_functions) return;
+    ThreadData* t = thread_data();
+    add(t->counters[id].calls, 1);
+    ++t->active[id];
+    if (t->depth < max_depth) t->stack[t->depth] = {id, read_timer(), 0};
+    ++t->depth;
+}
+
+extern "C" void __manit_prof_exit(Site* site) {
+    std::uint32_t id = site->id.load(std::memory_order_relaxed); // Registered by the matching enter
+    if (id == 0 || id >= max_functions) return;
+    ThreadData* t = current_thread;
+    if (!t || t->depth == 0) return;
+    --t->depth;
+    --t->active[id];
+    if (t->depth >= max_depth) return; // Frame was too deep to be timed
+    const Frame& frame = t->stack[t->depth];
+    std::uint64_t elapsed = read_timer() - frame.start;
+    add(t->counters[id].exclusive, elapsed > frame.children ? elapsed - frame.children : 0);
+    if (t->active[id] == 0) add(t->counters[id].inclusive, elapsed);
+    if (t->depth > 0) t->stack[t->depth - 1].children += elapsed;
+}
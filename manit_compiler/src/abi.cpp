@@ -0,0 +1,21 @@
+#include "abi.hpp"
+#include <llvm/IR/DataLayout.h>
+#include <llvm/IR/DerivedTypes.h>
+#include <algorithm>
+#include <cstdint>
+
+AggregateABI classify_aggregate(llvm::StructType* type, const llvm::DataLayout& layout) {
+    AggregateABI abi;
+    std::uint64_t size = layout.getTypeAllocSize(type);
+    if (size > 16) {
+        abi.in_memory = true;
+        return abi;
+    }
+    // The last eightbyte only covers the bytes that remain, as in clang:
+    // { i32, i32, i32 } is passed as i64 and i32.
+    for (std::uint64_t offset = 0; offset < size; offset += 8) {
+        std::uint64_t bytes = std::min<std::uint64_t>(8, size - offset);
+        abi.registers.push_back(llvm::IntegerType::get(type->getContext(), static_cast<unsigned>(8 * bytes)));
+    }
+    return abi;
+}
@@ -0,0 +1,25 @@
+#ifndef MANIT_ABI_HPP
+#define MANIT_ABI_HPP
+
+#include <vector>
+
+namespace llvm {
+    class DataLayout;
+    class StructType;
+    class Type;
+}
+
+// How a struct crosses a call boundary, following the x86-64 System V
+// classification. ManiT structs hold only integers and booleans, so every
+// eightbyte is class INTEGER and the rules reduce to: up to 16 bytes travel
+// in one or two integer registers, anything larger in memory (a hidden
+// `sret` pointer into the caller's frame for results, a `byval` copy for
+// arguments).
+struct AggregateABI {
+    bool in_memory = false;
+    std::vector<llvm::Type*> registers; // One integer per eightbyte; empty if in_memory or zero-sized
+};
+
+AggregateABI classify_aggregate(llvm::StructType* type, const llvm::DataLayout& layout);
+
+#endif // MANIT_ABI_HPP
@@ -9,7 +9,15 @@ std::string Program::to_string() const {
     return ss.str();
 }
 
-std::string Identifier::to_string() const { return value; }
+std::string Identifier::to_string() const { return name(); }
+
+std::string TypeAnnotation::to_string() const {
+    switch (kind) {
+        case Kind::Pointer: return "*" + element->to_string();
+        case Kind::Slice: return "[]" + element->to_string();
+        default: return symbol_name(name);
+    }
+}
 std::string IntegerLiteral::to_string() const { return token.literal; }
 std::string BooleanLiteral::to_string() const { return token.literal; }
 
@@ -23,6 +31,20 @@ std::string ArrayLiteral::to_string() const {
     return ss.str();
 }
 
+std::string StructLiteral::to_string() const {
+    std::stringstream ss;
+    ss << symbol_name(type_name) << " {";
+    for (size_t i = 0; i < fields.size(); ++i) {
+        ss << " " << fields[i].first->to_string() << ": " << fields[i].second->to_string() << (i < fields.size() - 1 ? "," : "");
+    }
+    ss << " }";
+    return ss.str();
+}
+
+std::string MemberExpression::to_string() const {
+    return "(" + left->to_string() + "." + field->to_string() + ")";
+}
+
 std::string PrefixExpression::to_string() const {
     std::stringstream ss;
     ss << "(" << op << right->to_string() << ")";
@@ -37,7 +59,7 @@ std::string InfixExpression::to_string() const {
 
 std::string AssignmentExpression::to_string() const {
     std::stringstream ss;
-    ss << "(" << name->to_string() << " = " << value->to_string() << ")";
+    ss << "(" << target->to_string() << " = " << value->to_string() << ")";
     return ss.str();
 }
 
@@ -47,8 +69,16 @@ std::string IndexExpression::to_string() const {
     return ss.str();
 }
 
+std::string SliceExpression::to_string() const {
+    std::stringstream ss;
+    ss << "(" << left->to_string() << "[" << (low ? low->to_string() : "") << ":" << (high ? high->to_string() : "") << "])";
+    return ss.str();
+}
+
 std::string LetStatement::to_string() const {
     std::stringstream ss;
+    if (is_public) ss << "pub ";
+    for (const auto& annotation : annotations) ss << annotation_to_string(annotation) << " ";
     ss << token.literal << " " << name->to_string();
     if (type) {
         ss << ": " << type->to_string();
@@ -63,6 +93,7 @@ std::string LetStatement::to_string() const {
 
 std::string VarStatement::to_string() const {
     std::stringstream ss;
+    for (const auto& annotation : annotations) ss << annotation_to_string(annotation) << " ";
     ss << token.literal << " " << name->to_string();
     if (type) {
         ss << ": " << type->to_string();
@@ -77,6 +108,7 @@ std::string VarStatement::to_string() const {
 
 std::string StructDefinitionStatement::to_string() const {
     std::stringstream ss;
+    if (is_public) ss << "pub ";
     ss << token.literal << " " << name->to_string() << " {";
     for (size_t i = 0; i < fields.size(); ++i) {
         ss << " " << fields[i].name->to_string() << ": " << fields[i].type->to_string();
@@ -88,6 +120,10 @@ std::string StructDefinitionStatement::to_string() const {
     return ss.str();
 }
 
+std::string ImportStatement::to_string() const {
+    return token.literal + " " + module_name->to_string() + ";";
+}
+
 std::string ReturnStatement::to_string() const {
     std::stringstream ss;
     ss << token.literal << " ";
@@ -122,13 +158,57 @@ std::string IfExpression::to_string() const {
     return ss.str();
 }
 
+std::string annotation_to_string(const Annotation& annotation) {
+    std::string text = "@" + symbol_name(annotation.name);
+    for (size_t i = 0; i < annotation.arguments.size(); ++i) text += (i == 0 ? "(" : ", ") + symbol_name(annotation.arguments[i]);
+    return annotation.arguments.empty() ? text : text + ")";
+}
+
+std::string MatchExpression::to_string() const {
+    std::stringstream ss;
+    for (const auto& annotation : annotations) ss << annotation_to_string(annotation) << " ";
+    ss << "match(" << subject->to_string() << ") {";
+    for (const auto& arm : arms) {
+        if (arm.patterns.empty()) ss << "else";
+        for (size_t i = 0; i < arm.patterns.size(); ++i) {
+            const MatchPattern& pattern = arm.patterns[i];
+            ss << (i == 0 ? "" : ", ") << pattern.low->to_string();
+            if (pattern.high) ss << (pattern.inclusive ? "..=" : "..") << pattern.high->to_string();
+        }
+        ss << " => {" << arm.body->to_string() << "} ";
+    }
+    ss << "}";
+    return ss.str();
+}
+
 std::string FunctionLiteral::to_string() const {
     std::stringstream ss;
-    ss << token.literal << "(";
+    for (const auto& annotation : annotations) ss << annotation_to_string(annotation) << " ";
+    ss << (is_async ? "async " : "") << token.literal;
+    for (size_t i = 0; i < type_parameters.size(); ++i) ss << (i == 0 ? "<" : ", ") << symbol_name(type_parameters[i]) << (i + 1 == type_parameters.size() ? ">" : "");
+    ss << "(";
     for (size_t i = 0; i < parameters.size(); ++i) {
-        ss << parameters[i]->to_string() << (i < parameters.size() - 1 ? ", " : "");
+        ss << parameters[i]->to_string();
+        if (i < parameter_types.size() && parameter_types[i]) ss << ": " << parameter_types[i]->to_string();
+        ss << (i < parameters.size() - 1 ? ", " : "");
+    }
+    ss << ") ";
+    if (return_type) ss << "-> " << return_type->to_string() << " ";
+    ss << body->to_string();
+    return ss.str();
+}
+
+std::string AwaitExpression::to_string() const {
+    return "(await " + task->to_string() + ")";
+}
+
+std::string BuiltinCall::to_string() const {
+    std::stringstream ss;
+    ss << "@" << symbol_name(name) << "(";
+    for (size_t i = 0; i < arguments.size(); ++i) {
+        ss << arguments[i]->to_string() << (i < arguments.size() - 1 ? ", " : "");
     }
-    ss << ") " << body->to_string();
+    ss << ")";
     return ss.str();
 }
 
@@ -165,4 +245,125 @@ std::string ForLoopExpression::to_string() const {
     }
     ss << ") { " << body->to_string() << " }";
     return ss.str();
+}
+
+void for_each_child(const Node& node, const std::function<void(const Node&)>& fn) {
+    auto visit = [&fn](const Node* child) { if (child) fn(*child); };
+    if (auto const* program = dynamic_cast<const Program*>(&node)) {
+        for (const auto& s : program->statements) visit(s.get());
+    }
+    else if (auto const* array_lit = dynamic_cast<const ArrayLiteral*>(&node)) {
+        for (const auto& e : array_lit->elements) visit(e.get());
+    }
+    else if (auto const* struct_lit = dynamic_cast<const StructLiteral*>(&node)) {
+        for (const auto& field : struct_lit->fields) {
+            visit(field.first.get());
+            visit(field.second.get());
+        }
+    }
+    else if (auto const* member_expr = dynamic_cast<const MemberExpression*>(&node)) {
+        visit(member_expr->left.get());
+        visit(member_expr->field.get());
+    }
+    else if (auto const* prefix_expr = dynamic_cast<const PrefixExpression*>(&node)) {
+        visit(prefix_expr->right.get());
+    }
+    else if (auto const* infix_expr = dynamic_cast<const InfixExpression*>(&node)) {
+        visit(infix_expr->left.get());
+        visit(infix_expr->right.get());
+    }
+    else if (auto const* assign_expr = dynamic_cast<const AssignmentExpression*>(&node)) {
+        visit(assign_expr->target.get());
+        visit(assign_expr->value.get());
+    }
+    else if (auto const* index_expr = dynamic_cast<const IndexExpression*>(&node)) {
+        visit(index_expr->left.get());
+        visit(index_expr->index.get());
+    }
+    else if (auto const* slice_expr = dynamic_cast<const SliceExpression*>(&node)) {
+        visit(slice_expr->left.get());
+        visit(slice_expr->low.get());
+        visit(slice_expr->high.get());
+    }
+    else if (auto const* type = dynamic_cast<const TypeAnnotation*>(&node)) {
+        visit(type->element.get());
+    }
+    else if (auto const* if_expr = dynamic_cast<const IfExpression*>(&node)) {
+        visit(if_expr->condition.get());
+        visit(if_expr->consequence.get());
+        visit(if_expr->alternative.get());
+    }
+    else if (auto const* match_expr = dynamic_cast<const MatchExpression*>(&node)) {
+        visit(match_expr->subject.get());
+        for (const auto& arm : match_expr->arms) {
+            for (const auto& pattern : arm.patterns) {
+                visit(pattern.low.get());
+                visit(pattern.high.get());
+            }
+            visit(arm.body.get());
+        }
+    }
+    else if (auto const* func_lit = dynamic_cast<const FunctionLiteral*>(&node)) {
+        for (size_t i = 0; i < func_lit->parameters.size(); ++i) {
+            visit(func_lit->parameters[i].get());
+            if (i < func_lit->parameter_types.size()) visit(func_lit->parameter_types[i].get());
+        }
+        visit(func_lit->return_type.get());
+        visit(func_lit->body.get());
+    }
+    else if (auto const* call_expr = dynamic_cast<const CallExpression*>(&node)) {
+        visit(call_expr->function.get());
+        for (const auto& a : call_expr->arguments) visit(a.get());
+    }
+    else if (auto const* await_expr = dynamic_cast<const AwaitExpression*>(&node)) {
+        visit(await_expr->task.get());
+    }
+    else if (auto const* builtin = dynamic_cast<const BuiltinCall*>(&node)) {
+        for (const auto& a : builtin->arguments) visit(a.get());
+    }
+    else if (auto const* while_expr = dynamic_cast<const WhileExpression*>(&node)) {
+        visit(while_expr->condition.get());
+        visit(while_expr->body.get());
+    }
+    else if (auto const* for_expr = dynamic_cast<const ForLoopExpression*>(&node)) {
+        visit(for_expr->initializer.get());
+        visit(for_expr->condition.get());
+        visit(for_expr->increment.get());
+        visit(for_expr->body.get());
+    }
+    else if (auto const* let_stmt = dynamic_cast<const LetStatement*>(&node)) {
+        visit(let_stmt->name.get());
+        visit(let_stmt->type.get());
+        visit(let_stmt->value.get());
+    }
+    else if (auto const* var_stmt = dynamic_cast<const VarStatement*>(&node)) {
+        visit(var_stmt->name.get());
+        visit(var_stmt->type.get());
+        visit(var_stmt->value.get());
+    }
+    else if (auto const* struct_def_stmt = dynamic_cast<const StructDefinitionStatement*>(&node)) {
+        visit(struct_def_stmt->name.get());
+        for (const auto& field : struct_def_stmt->fields) {
+            visit(field.name.get());
+            visit(field.type.get());
+        }
+    }
+    else if (auto const* import_stmt = dynamic_cast<const ImportStatement*>(&node)) {
+        visit(import_stmt->module_name.get());
+    }
+    else if (auto const* return_stmt = dynamic_cast<const ReturnStatement*>(&node)) {
+        visit(return_stmt->return_value.get());
+    }
+    else if (auto const* expr_stmt = dynamic_cast<const ExpressionStatement*>(&node)) {
+        visit(expr_stmt->expression.get());
+    }
+    else if (auto const* block = dynamic_cast<const BlockStatement*>(&node)) {
+        for (const auto& s : block->statements) visit(s.get());
+    }
+}
+
+std::size_t count_nodes(const Node& node) {
+    std::size_t count = 1;
+    for_each_child(node, [&count](const Node& child) { count += count_nodes(child); });
+    return count;
 }
\ No newline at end of file
@@ -5,6 +5,10 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
 
 // Forward declarations
 struct Statement;
@@ -15,11 +19,25 @@ struct Identifier;
 struct Node {
     virtual ~Node() = default;
     virtual std::string to_string() const = 0;
+    // Offset of the node's token in the source; see SourceMap.
+    virtual std::uint32_t source_offset() const { return 0; }
 };
 
 struct Expression : public Node {};
 struct Statement : public Node {};
 
+// Type written in a declaration: a name (`i32`, `bool`, a struct), a
+// pointer `*T` or a slice `[]T`.
+struct TypeAnnotation : public Node {
+    enum class Kind { Named, Pointer, Slice };
+    Token token; // The type name, '*' or '['
+    Kind kind = Kind::Named;
+    Symbol name = no_symbol;                 // Kind::Named
+    std::unique_ptr<TypeAnnotation> element; // Pointee or slice element
+    std::string to_string() const override;
+    std::uint32_t source_offset() const override { return token.offset; }
+};
+
 // Helper struct for struct fields
 struct StructField {
     std::unique_ptr<Identifier> name;
@@ -35,26 +53,50 @@ struct Program : public Node {
 // Expression Nodes
 struct Identifier : public Expression {
     Token token;
-    std::string value;
+    Symbol symbol = no_symbol;
+    const std::string& name() const { return symbol_name(symbol); }
     std::string to_string() const override;
+    std::uint32_t source_offset() const override { return token.offset; }
 };
 
 struct IntegerLiteral : public Expression {
     Token token;
     long long value;
     std::string to_string() const override;
+    std::uint32_t source_offset() const override { return token.offset; }
 };
 
 struct BooleanLiteral : public Expression {
     Token token;
     bool value;
     std::string to_string() const override;
+    std::uint32_t source_offset() const override { return token.offset; }
 };
 
 struct ArrayLiteral : public Expression {
     Token token;
     std::vector<std::unique_ptr<Expression>> elements;
     std::string to_string() const override;
+    std::uint32_t source_offset() const override { return token.offset; }
+};
+
+// `Name { field: value, ... }`. Fields may be given in any order; omitted
+// fields are zero.
+struct StructLiteral : public Expression {
+    Token token; // The struct name
+    Symbol type_name = no_symbol;
+    std::vector<std::pair<std::unique_ptr<Identifier>, std::unique_ptr<Expression>>> fields;
+    std::string to_string() const override;
+    std::uint32_t source_offset() const override { return token.offset; }
+};
+
+// `left.field`, on a struct or a pointer to one.
+struct MemberExpression : public Expression {
+    Token token; // The '.' token
+    std::unique_ptr<Expression> left;
+    std::unique_ptr<Identifier> field;
+    std::string to_string() const override;
+    std::uint32_t source_offset() const override { return token.offset; }
 };
 
 struct PrefixExpression : public Expression {
@@ -62,6 +104,16 @@ struct PrefixExpression : public Expression {
     std::string op;
     std::unique_ptr<Expression> right;
     std::string to_string() const override;
+    std::uint32_t source_offset() const override { return token.offset; }
+};
+
+// `await task`: suspends the enclosing async function until task completes,
+// then yields its result.
+struct AwaitExpression : public Expression {
+    Token token; // The 'await' token
+    std::unique_ptr<Expression> task;
+    std::string to_string() const override;
+    std::uint32_t source_offset() const override { return token.offset; }
 };
 
 struct InfixExpression : public Expression {
@@ -70,13 +122,15 @@ struct InfixExpression : public Expression {
     std::string op;
     std::unique_ptr<Expression> right;
     std::string to_string() const override;
+    std::uint32_t source_offset() const override { return token.offset; }
 };
 
 struct AssignmentExpression : public Expression {
     Token token;
-    std::unique_ptr<Identifier> name;
+    std::unique_ptr<Expression> target; // Identifier, IndexExpression, MemberExpression or `*pointer`
     std::unique_ptr<Expression> value;
     std::string to_string() const override;
+    std::uint32_t source_offset() const override { return token.offset; }
 };
 
 struct IndexExpression : public Expression {
@@ -84,6 +138,18 @@ struct IndexExpression : public Expression {
     std::unique_ptr<Expression> left;
     std::unique_ptr<Expression> index;
     std::string to_string() const override;
+    std::uint32_t source_offset() const override { return token.offset; }
+};
+
+// `left[low:high]`: a slice of an array or slice. Either bound may be
+// omitted and defaults to 0 or the length.
+struct SliceExpression : public Expression {
+    Token token; // The '[' token
+    std::unique_ptr<Expression> left;
+    std::unique_ptr<Expression> low;
+    std::unique_ptr<Expression> high;
+    std::string to_string() const override;
+    std::uint32_t source_offset() const override { return token.offset; }
 };
 
 struct IfExpression : public Expression {
@@ -92,13 +158,54 @@ struct IfExpression : public Expression {
     std::unique_ptr<BlockStatement> consequence;
     std::unique_ptr<BlockStatement> alternative;
     std::string to_string() const override;
+    std::uint32_t source_offset() const override { return token.offset; }
+};
+
+// `@name` or `@name(arguments)` before a function literal or a match.
+// Arguments are bare names.
+struct Annotation {
+    Symbol name = no_symbol; // Without the '@'
+    std::vector<Symbol> arguments;
+};
+
+// `low`, `low..high` (high excluded) or `low..=high`; the bounds are
+// constant expressions (see fold_constant()).
+struct MatchPattern {
+    std::unique_ptr<Expression> low;
+    std::unique_ptr<Expression> high; // Null for a single value
+    bool inclusive = false;           // `..=`
+};
+
+// `patterns => body`, or `else => body` for the default arm. An arm whose
+// body is a single expression gets a block holding just that expression.
+struct MatchArm {
+    std::vector<MatchPattern> patterns; // Empty for `else`
+    std::unique_ptr<BlockStatement> body;
+};
+
+// `match (subject) { arm, ... }` over an integer or bool. Like if, it yields
+// the value of the arm taken when every arm ends in an expression.
+struct MatchExpression : public Expression {
+    Token token;
+    std::vector<Annotation> annotations; // `@computed_goto match`
+    std::unique_ptr<Expression> subject;
+    std::vector<MatchArm> arms;
+    std::string to_string() const override;
+    std::uint32_t source_offset() const override { return token.offset; }
 };
 
 struct FunctionLiteral : public Expression {
     Token token;
+    std::vector<Symbol> type_parameters; // `fn<T, U>`: instantiated for each set of argument types it is called with
+    std::vector<Annotation> annotations; // `@inline fn`, `@cold @target_clones(avx2, default) fn`
     std::vector<std::unique_ptr<Identifier>> parameters;
+    std::vector<std::unique_ptr<TypeAnnotation>> parameter_types; // Parallel to parameters; null means i32
+    std::unique_ptr<TypeAnnotation> return_type; // `-> T`; null means i32
     std::unique_ptr<BlockStatement> body;
+    bool is_async = false; // `async fn`: a call starts a task and returns its handle
+    std::uint32_t end_offset = 0; // Just past the closing '}'
     std::string to_string() const override;
+    std::uint32_t source_offset() const override { return token.offset; }
 };
 
 struct CallExpression : public Expression {
@@ -106,6 +213,16 @@ struct CallExpression : public Expression {
     std::unique_ptr<Expression> function;
     std::vector<std::unique_ptr<Expression>> arguments;
     std::string to_string() const override;
+    std::uint32_t source_offset() const override { return token.offset; }
+};
+
+// `@name(arguments)`: a compiler builtin, lowered to LLVM intrinsics.
+struct BuiltinCall : public Expression {
+    Token token; // The `@name` token
+    Symbol name = no_symbol;
+    std::vector<std::unique_ptr<Expression>> arguments;
+    std::string to_string() const override;
+    std::uint32_t source_offset() const override { return token.offset; }
 };
 
 struct WhileExpression : public Expression {
@@ -113,6 +230,7 @@ struct WhileExpression : public Expression {
     std::unique_ptr<Expression> condition;
     std::unique_ptr<BlockStatement> body;
     std::string to_string() const override;
+    std::uint32_t source_offset() const override { return token.offset; }
 };
 
 struct ForLoopExpression : public Expression {
@@ -122,50 +240,76 @@ struct ForLoopExpression : public Expression {
     std::unique_ptr<Expression> increment;
     std::unique_ptr<BlockStatement> body;
     std::string to_string() const override;
+    std::uint32_t source_offset() const override { return token.offset; }
 };
 
 
 // Statement Nodes
 struct LetStatement : public Statement {
     Token token;
+    bool is_public = false; // Declared with `pub`: exported in the module interface
     std::unique_ptr<Identifier> name;
-    std::unique_ptr<Identifier> type; // Optional type annotation
+    std::unique_ptr<TypeAnnotation> type; // Optional type annotation
     std::unique_ptr<Expression> value;
+    std::vector<Annotation> annotations; // `@thread_local let`
     std::string to_string() const override;
+    std::uint32_t source_offset() const override { return token.offset; }
 };
 
 struct VarStatement : public Statement {
     Token token;
     std::unique_ptr<Identifier> name;
-    std::unique_ptr<Identifier> type; // Optional type annotation
+    std::unique_ptr<TypeAnnotation> type; // Optional type annotation
     std::unique_ptr<Expression> value;
+    std::vector<Annotation> annotations; // `@thread_local var`
     std::string to_string() const override;
+    std::uint32_t source_offset() const override { return token.offset; }
 };
 
 struct StructDefinitionStatement : public Statement {
     Token token; // The 'struct' token
+    bool is_public = false;
     std::unique_ptr<Identifier> name;
     std::vector<StructField> fields;
     std::string to_string() const override;
+    std::uint32_t source_offset() const override { return token.offset; }
+};
+
+struct ImportStatement : public Statement {
+    Token token; // The 'import' token
+    std::unique_ptr<Identifier> module_name;
+    std::string to_string() const override;
+    std::uint32_t source_offset() const override { return token.offset; }
 };
 
 struct ReturnStatement : public Statement {
     Token token;
     std::unique_ptr<Expression> return_value;
     std::string to_string() const override;
+    std::uint32_t source_offset() const override { return token.offset; }
 };
 
 struct ExpressionStatement : public Statement {
     Token token;
     std::unique_ptr<Expression> expression;
     std::string to_string() const override;
+    std::uint32_t source_offset() const override { return token.offset; }
 };
 
 struct BlockStatement : public Statement {
     Token token;
     std::vector<std::unique_ptr<Statement>> statements;
     std::string to_string() const override;
+    std::uint32_t source_offset() const override { return token.offset; }
 };
 
+// `@name(a, b)` as written in source.
+std::string annotation_to_string(const Annotation& annotation);
+
+// Traversal helpers
+// Calls fn on each direct, non-null child of node, in source order.
+void for_each_child(const Node& node, const std::function<void(const Node&)>& fn);
+// Number of nodes in the tree rooted at node (including node itself).
+std::size_t count_nodes(const Node& node);
 
 #endif // MANIT_AST_HPP
\ No newline at end of file
@@ -0,0 +1,131 @@
+#include "attributes.hpp"
+#include <llvm/Analysis/MemoryLocation.h>
+#include <llvm/Analysis/ValueTracking.h>
+#include <llvm/IR/InstIterator.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/ModRef.h>
+#include <optional>
+
+// Object pointer is based on. Codegen keeps every variable, parameters
+// included, in a stack slot, so a pointer loaded from a slot, or taken out of
+// a slice loaded from one, is traced through the values stored there. It
+// resolves only if the slot never escapes and all of them share an object.
+static const llvm::Value* pointer_origin(const llvm::Value* pointer, unsigned depth = 0) {
+    const llvm::Value* object = llvm::getUnderlyingObject(pointer);
+    const llvm::Value* loaded = object;
+    std::optional<unsigned> field; // The slice component the pointer came from
+    if (auto const* extract = llvm::dyn_cast<llvm::ExtractValueInst>(object)) {
+        if (extract->getNumIndices() != 1) return object;
+        field = extract->getIndices()[0];
+        loaded = extract->getAggregateOperand();
+    }
+    auto const* load = llvm::dyn_cast<llvm::LoadInst>(loaded);
+    auto const* slot = load ? llvm::dyn_cast<llvm::AllocaInst>(load->getPointerOperand()) : nullptr;
+    if (!slot || depth == 8) return object;
+    const llvm::Value* origin = nullptr;
+    for (const llvm::User* user : slot->users()) {
+        if (llvm::isa<llvm::LoadInst>(user)) continue;
+        auto const* store = llvm::dyn_cast<llvm::StoreInst>(user);
+        if (!store || store->getValueOperand() == slot) return object;
+        llvm::Value* stored = const_cast<llvm::Value*>(store->getValueOperand());
+        if (field) stored = llvm::FindInsertedValue(stored, *field);
+        const llvm::Value* stored_origin = stored ? pointer_origin(stored, depth + 1) : nullptr;
+        if (!stored_origin || (origin && stored_origin != origin)) return object;
+        origin = stored_origin;
+    }
+    return origin ? origin : object;
+}
+
+// Effects, as seen by callers, of accessing the object pointer is based on:
+// none for the function's own stack or a read-only global, argument memory
+// for an object passed in, and anything for a pointer of unknown origin.
+static llvm::MemoryEffects access_effects(const llvm::Value* pointer, llvm::ModRefInfo mod_ref) {
+    const llvm::Value* object = pointer_origin(pointer);
+    if (llvm::isa<llvm::AllocaInst>(object)) return llvm::MemoryEffects::none();
+    auto const* global = llvm::dyn_cast<llvm::GlobalVariable>(object);
+    if (global && global->isConstant() && mod_ref == llvm::ModRefInfo::Ref) return llvm::MemoryEffects::none();
+    if (llvm::isa<llvm::Argument>(object)) return llvm::MemoryEffects::argMemOnly(mod_ref);
+    return llvm::MemoryEffects(mod_ref);
+}
+
+// The callee's effects, with its argument memory mapped onto the objects
+// this call passes it.
+static llvm::MemoryEffects call_effects(const llvm::CallBase& call) {
+    llvm::MemoryEffects callee = call.getMemoryEffects();
+    llvm::MemoryEffects effects = callee.getWithoutLoc(llvm::IRMemLocation::ArgMem);
+    llvm::ModRefInfo arg_mod_ref = callee.getModRef(llvm::IRMemLocation::ArgMem);
+    for (unsigned i = 0; i < call.arg_size(); ++i) {
+        const llvm::Value* arg = call.getArgOperand(i);
+        if (!arg->getType()->isPointerTy()) continue;
+        // A byval argument is copied by the caller before the callee runs.
+        if (call.isByValArgument(i)) effects |= access_effects(arg, llvm::ModRefInfo::Ref);
+        if (!llvm::isNoModRef(arg_mod_ref)) effects |= access_effects(arg, arg_mod_ref);
+    }
+    return effects;
+}
+
+static llvm::MemoryEffects function_effects(const llvm::Function& function) {
+    llvm::MemoryEffects effects = llvm::MemoryEffects::none();
+    for (const llvm::Instruction& inst : llvm::instructions(function)) {
+        if (auto const* call = llvm::dyn_cast<llvm::CallBase>(&inst)) {
+            effects |= call_effects(*call);
+            continue;
+        }
+        if (!inst.mayReadOrWriteMemory()) continue;
+        llvm::ModRefInfo mod_ref = !inst.mayWriteToMemory() ? llvm::ModRefInfo::Ref
+                                 : inst.mayReadFromMemory() ? llvm::ModRefInfo::ModRef : llvm::ModRefInfo::Mod;
+        std::optional<llvm::MemoryLocation> location = llvm::MemoryLocation::getOrNone(&inst);
+        effects |= location ? access_effects(location->Ptr, mod_ref) : llvm::MemoryEffects(mod_ref); // Fences
+    }
+    return effects;
+}
+
+// True if every call in function is to an intrinsic or to another function
+// already known not to recurse; such a function cannot reach itself again.
+static bool calls_only_norecurse(const llvm::Function& function) {
+    for (const llvm::Instruction& inst : llvm::instructions(function)) {
+        auto const* call = llvm::dyn_cast<llvm::CallBase>(&inst);
+        if (!call) continue;
+        const llvm::Function* callee = call->getCalledFunction();
+        if (!callee || callee == &function) return false;
+        if (!callee->isIntrinsic() && !callee->doesNotRecurse()) return false;
+    }
+    return true;
+}
+
+static bool may_unwind(const llvm::Function& function) {
+    for (const llvm::Instruction& inst : llvm::instructions(function)) {
+        if (inst.mayThrow()) return true;
+    }
+    return false;
+}
+
+void infer_function_attributes(llvm::Module& module) {
+    // Every function starts from what it was declared with and only gains
+    // attributes, so each pass over the module can prove more callers until
+    // nothing changes. Functions in a recursive cycle keep their defaults.
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (llvm::Function& function : module) {
+            // A linkonce_odr instance may be replaced by another module's copy,
+            // and a coroutine's body runs on after its first return.
+            if (function.isDeclaration() || !function.hasExactDefinition() || function.isPresplitCoroutine()) continue;
+            llvm::MemoryEffects declared = function.getMemoryEffects();
+            llvm::MemoryEffects inferred = declared & function_effects(function);
+            if (inferred != declared) {
+                function.setMemoryEffects(inferred);
+                changed = true;
+            }
+            if (!function.doesNotThrow() && !may_unwind(function)) {
+                function.setDoesNotThrow();
+                changed = true;
+            }
+            if (!function.doesNotRecurse() && calls_only_norecurse(function)) {
+                function.setDoesNotRecurse();
+                changed = true;
+            }
+        }
+    }
+}
@@ -0,0 +1,16 @@
+#ifndef MANIT_ATTRIBUTES_HPP
+#define MANIT_ATTRIBUTES_HPP
+
+namespace llvm {
+    class Module;
+}
+
+// Infers nounwind, norecurse and memory effects for the functions defined in
+// module, from what their bodies and callees provably do. ManiT functions
+// reach memory only through their parameters and locals, so most leaf
+// helpers come out argmemonly or readnone. Running this before the pipeline
+// lets the first inliner and CSE passes, and the ThinLTO summary, see the
+// attributes instead of waiting for LLVM's own inference in the CGSCC pass.
+void infer_function_attributes(llvm::Module& module);
+
+#endif // MANIT_ATTRIBUTES_HPP
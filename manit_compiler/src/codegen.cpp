@@ -1,11 +1,164 @@
 #include "codegen.hpp"
+#include "optimizer.hpp"
+#include "instrumentation.hpp"
+#include "noalias.hpp"
+#include "attributes.hpp"
+#include "abi.hpp"
+#include "parser.hpp"
+#include "target.hpp"
+#include <llvm/Analysis/ModuleSummaryAnalysis.h>
+#include <llvm/Analysis/ProfileSummaryInfo.h>
+#include <llvm/BinaryFormat/Dwarf.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/IR/GlobalIFunc.h>
+#include <llvm/IR/Intrinsics.h>
+#include <llvm/IR/MDBuilder.h>
 #include <llvm/IR/Verifier.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
 #include <llvm/Support/raw_ostream.h>
+#include <llvm/Target/TargetMachine.h>
+#include <llvm/TargetParser/Host.h>
+#include <llvm/TargetParser/Triple.h>
+#include <llvm/Transforms/Utils/Cloning.h>
+#include <llvm/Transforms/Utils/Local.h>
+#include <algorithm>
+#include <limits>
+#include <optional>
+#include <set>
 
-CodeGenerator::CodeGenerator() {
+CodeGenerator::CodeGenerator(const CodeGenOptions& options) : options(options) {
     context = std::make_unique<llvm::LLVMContext>();
     module = std::make_unique<llvm::Module>("ManiT_Module", *context);
     builder = std::make_unique<llvm::IRBuilder<>>(*context);
+    promise_type = llvm::StructType::create(*context, {builder->getInt32Ty(), builder->getInt32Ty(), builder->getPtrTy()}, "manit.promise");
+    // Modules are compiled for the host. The triple and the target's real
+    // layout let the optimizer cost code for it, and modules be linked with
+    // C objects or bitcode. Without the target, the module cannot be
+    // compiled for it, so that fails the compile.
+    module->setTargetTriple(llvm::sys::getDefaultTargetTriple());
+    std::string error;
+    if (auto machine = create_target_machine(options, error)) module->setDataLayout(machine->createDataLayout());
+    else errors.push_back(error.empty() ? "Cannot create a target machine for " + llvm::sys::getDefaultTargetTriple() : error);
+    // Full LTO inputs are told apart from ThinLTO ones by a flag.
+    if (options.lto == LTOMode::Full) module->addModuleFlag(llvm::Module::Error, "ThinLTO", static_cast<std::uint32_t>(0));
+}
+
+// Maps a ManiT type name to its LLVM type; nullptr if unknown.
+llvm::Type* CodeGenerator::type_from_name(Symbol name) {
+    static const Symbol i32_symbol = intern("i32");
+    static const Symbol bool_symbol = intern("bool");
+    static const Symbol i64_symbol = intern("i64");
+    static const Symbol task_symbol = intern("task");
+    for (const auto& argument : type_arguments) {
+        if (argument.first == name) return argument.second;
+    }
+    if (name == i32_symbol) return builder->getInt32Ty();
+    if (name == bool_symbol) return builder->getInt1Ty();
+    if (name == i64_symbol) return builder->getInt64Ty();
+    if (name == task_symbol) return builder->getPtrTy(); // Handle of a started async function
+    return struct_types.lookup(name);
+}
+
+void CodeGenerator::bind_variable(Symbol name, llvm::AllocaInst* alloca) {
+    llvm::AllocaInst*& slot = named_values[name];
+    binding_log.emplace_back(name, slot);
+    slot = alloca;
+}
+
+// Storage of a variable: its alloca, or its global for a top-level binding.
+// Bindings made by an enclosing function stay in the table while a nested
+// function literal is generated, but are not visible from it.
+llvm::Value* CodeGenerator::lookup_variable(Symbol name) {
+    llvm::AllocaInst* alloca = named_values.lookup(name);
+    if (alloca && alloca->getFunction() == builder->GetInsertBlock()->getParent()) return alloca;
+    return global_variables.lookup(name);
+}
+
+// Type of the value held by the storage of a variable.
+static llvm::Type* storage_type(const llvm::Value* storage) {
+    if (auto const* alloca = llvm::dyn_cast<llvm::AllocaInst>(storage)) return alloca->getAllocatedType();
+    return llvm::cast<llvm::GlobalVariable>(storage)->getValueType();
+}
+
+// Type of the array a value is the storage of, or nullptr. Array expressions
+// evaluate to the array's own storage rather than to a loaded value.
+static llvm::ArrayType* array_storage(const llvm::Value* value) {
+    if (!llvm::isa<llvm::AllocaInst>(value) && !llvm::isa<llvm::GlobalVariable>(value)) return nullptr;
+    return llvm::dyn_cast<llvm::ArrayType>(storage_type(value));
+}
+
+// Binds name to an array value. Arrays are values, so only the alloca of a
+// fresh array literal is taken over; any other array, another variable's or
+// a global, is copied into the binding's own alloca.
+void CodeGenerator::bind_array(const Identifier& name, llvm::Value* array, const Expression& value, const Node& node) {
+    auto* alloca = llvm::dyn_cast<llvm::AllocaInst>(array);
+    if (!alloca || !dynamic_cast<const ArrayLiteral*>(&value)) {
+        llvm::ArrayType* type = array_storage(array);
+        alloca = create_entry_block_alloca(builder->GetInsertBlock()->getParent(), name.name(), type);
+        builder->CreateMemCpy(alloca, alloca->getAlign(), array, llvm::MaybeAlign(), module->getDataLayout().getTypeAllocSize(type));
+    }
+    alloca->setName(name.name());
+    bind_variable(name.symbol, alloca);
+    declare_debug_variable(alloca, name.name(), node);
+}
+
+void CodeGenerator::close_scope(size_t mark) {
+    while (binding_log.size() > mark) {
+        named_values[binding_log.back().first] = binding_log.back().second;
+        binding_log.pop_back();
+    }
+}
+
+void CodeGenerator::import_interface(const ModuleInterface& iface) {
+    // Name every struct before laying any out: fields may hold other structs.
+    std::vector<llvm::StructType*> imported(iface.structs.size());
+    for (size_t i = 0; i < iface.structs.size(); ++i) {
+        Symbol name = intern(iface.structs[i].name);
+        if (struct_types.lookup(name)) continue;
+        imported[i] = llvm::StructType::create(*context, iface.structs[i].name);
+        struct_types[name] = imported[i];
+    }
+    for (size_t i = 0; i < iface.structs.size(); ++i) {
+        const StructLayout& layout = iface.structs[i];
+        llvm::StructType* struct_type = imported[i];
+        if (!struct_type) continue;
+        std::vector<std::pair<Symbol, llvm::Type*>> fields;
+        for (const auto& field : layout.fields) {
+            if (llvm::Type* field_type = type_from_name(intern(field.second))) fields.emplace_back(intern(field.first), field_type);
+        }
+        define_struct(struct_type, fields);
+    }
+    for (const auto& signature : iface.functions) {
+        Symbol name = intern(signature.name);
+        if (functions.lookup(name)) continue;
+        CallSignature call_signature;
+        call_signature.params.resize(signature.param_types.size());
+        bool failed = false;
+        for (size_t i = 0; i < call_signature.params.size(); ++i) failed = failed || !parameter_type(signature.param_types[i], call_signature.params[i]);
+        call_signature.return_type = type_from_name(intern(signature.return_type));
+        if (!call_signature.return_type || failed) continue;
+        functions[name] = create_function(call_signature, llvm::Function::ExternalLinkage, signature.name);
+    }
+    for (const auto& constant : iface.constants) {
+        llvm::Type* type = type_from_name(intern(constant.type));
+        if (!type) continue;
+        constants[intern(constant.name)] = llvm::ConstantInt::get(type, constant.value, true);
+    }
+    // Generic functions are parsed here and instantiated like local ones.
+    for (const auto& generic : iface.generics) {
+        Symbol name = intern(generic.name);
+        if (functions.lookup(name) || generic_functions.lookup(name)) continue;
+        Lexer lexer("let " + generic.name + " = " + generic.source + ";");
+        Parser parser(lexer);
+        std::unique_ptr<Program> program = parser.parse_program();
+        auto const* let_stmt = program->statements.size() == 1 ? dynamic_cast<const LetStatement*>(program->statements[0].get()) : nullptr;
+        auto const* func_lit = let_stmt ? dynamic_cast<const FunctionLiteral*>(let_stmt->value.get()) : nullptr;
+        if (!func_lit || func_lit->type_parameters.empty()) continue;
+        generic_functions[name] = func_lit;
+        shared_generics[func_lit] = iface.module_name;
+        imported_generics[func_lit] = std::move(program);
+    }
 }
 
 llvm::AllocaInst* CodeGenerator::create_entry_block_alloca(llvm::Function* the_function, const std::string& var_name, llvm::Type* type) {
@@ -13,61 +166,1684 @@ llvm::AllocaInst* CodeGenerator::create_entry_block_alloca(llvm::Function* the_f
     return tmp_builder.CreateAlloca(type, nullptr, var_name);
 }
 
+// Parses a parameter type spelling as written in source and in interfaces:
+// `T`, `*T` or `[]T`, where T is i32, bool or a struct.
+bool CodeGenerator::parameter_type(const std::string& spelling, ParameterType& param) {
+    std::string element = spelling;
+    param.kind = ParameterType::Kind::Value;
+    if (spelling.compare(0, 1, "*") == 0) { param.kind = ParameterType::Kind::Pointer; element = spelling.substr(1); }
+    else if (spelling.compare(0, 2, "[]") == 0) { param.kind = ParameterType::Kind::Slice; element = spelling.substr(2); }
+    param.type = type_from_name(intern(element));
+    return param.type != nullptr;
+}
+
+bool CodeGenerator::function_signature(const FunctionLiteral& func_lit, CallSignature& signature) {
+    signature.params.resize(func_lit.parameters.size());
+    for (size_t i = 0; i < signature.params.size(); ++i) {
+        const TypeAnnotation* annotation = i < func_lit.parameter_types.size() ? func_lit.parameter_types[i].get() : nullptr;
+        if (!parameter_type(annotation ? annotation->to_string() : "i32", signature.params[i])) return false;
+    }
+    const TypeAnnotation* result = func_lit.return_type.get();
+    if (result && result->kind != TypeAnnotation::Kind::Named) return false;
+    signature.return_type = result ? type_from_name(result->name) : builder->getInt32Ty();
+    // An async function produces its i32 result through the task it returns.
+    if (func_lit.is_async) signature.return_type = signature.return_type == builder->getInt32Ty() ? type_from_name(intern("task")) : nullptr;
+    return signature.return_type != nullptr;
+}
+
+// The LLVM type that carries an aggregate passed in registers.
+static llvm::Type* register_type(const std::vector<llvm::Type*>& registers) {
+    if (registers.size() == 1) return registers[0];
+    return llvm::StructType::get(registers[0]->getContext(), registers);
+}
+
+static llvm::StructType* struct_parameter(const ParameterType& param) {
+    return param.kind == ParameterType::Kind::Value ? llvm::dyn_cast<llvm::StructType>(param.type) : nullptr;
+}
+
+// Creates a function with the given signature and records it for calls.
+// Struct parameters and results are lowered per classify_aggregate(); a
+// result passed in memory becomes a leading `sret` pointer. Pointer and slice
+// data arguments are never null: they only come from `&` and from arrays. A
+// pointer also covers its pointee.
+llvm::Function* CodeGenerator::create_function(const CallSignature& signature, llvm::Function::LinkageTypes linkage, const std::string& name) {
+    const llvm::DataLayout& layout = module->getDataLayout();
+    std::vector<llvm::Type*> arg_types;
+    llvm::Type* result_type = signature.return_type;
+    auto* result_struct = llvm::dyn_cast<llvm::StructType>(signature.return_type);
+    AggregateABI result_abi = result_struct ? classify_aggregate(result_struct, layout) : AggregateABI();
+    if (result_struct) {
+        if (result_abi.in_memory) arg_types.push_back(builder->getPtrTy());
+        result_type = result_abi.registers.empty() ? builder->getVoidTy() : register_type(result_abi.registers);
+    }
+    for (const auto& param : signature.params) {
+        if (llvm::StructType* param_struct = struct_parameter(param)) {
+            AggregateABI abi = classify_aggregate(param_struct, layout);
+            if (abi.in_memory) arg_types.push_back(builder->getPtrTy());
+            else arg_types.insert(arg_types.end(), abi.registers.begin(), abi.registers.end());
+        } else if (param.kind == ParameterType::Kind::Value) {
+            arg_types.push_back(param.type);
+        } else {
+            arg_types.push_back(builder->getPtrTy());
+            if (param.kind == ParameterType::Kind::Slice) arg_types.push_back(builder->getInt64Ty());
+        }
+    }
+    llvm::FunctionType* func_type = llvm::FunctionType::get(result_type, arg_types, false);
+    llvm::Function* function = llvm::Function::Create(func_type, linkage, name, module.get());
+
+    unsigned arg_no = 0;
+    if (result_struct && result_abi.in_memory) {
+        function->addParamAttr(0, llvm::Attribute::getWithStructRetType(*context, result_struct));
+        function->addParamAttr(0, llvm::Attribute::NoAlias);
+        function->addParamAttr(0, llvm::Attribute::getWithAlignment(*context, layout.getABITypeAlign(result_struct)));
+        arg_no = 1;
+    }
+    if (result_type->isIntegerTy(1)) function->addRetAttr(llvm::Attribute::ZExt);
+    for (const auto& param : signature.params) {
+        if (llvm::StructType* param_struct = struct_parameter(param)) {
+            AggregateABI abi = classify_aggregate(param_struct, layout);
+            if (!abi.in_memory) { arg_no += abi.registers.size(); continue; }
+            function->addParamAttr(arg_no, llvm::Attribute::getWithByValType(*context, param_struct));
+            function->addParamAttr(arg_no, llvm::Attribute::getWithAlignment(*context, layout.getABITypeAlign(param_struct)));
+        } else if (param.kind == ParameterType::Kind::Value) {
+            if (param.type->isIntegerTy(1)) function->addParamAttr(arg_no, llvm::Attribute::ZExt);
+        } else {
+            function->addParamAttr(arg_no, llvm::Attribute::NonNull);
+            function->addParamAttr(arg_no, llvm::Attribute::getWithAlignment(*context, layout.getABITypeAlign(param.type)));
+            if (param.kind == ParameterType::Kind::Pointer) function->addDereferenceableParamAttr(arg_no, layout.getTypeAllocSize(param.type));
+            if (param.kind == ParameterType::Kind::Slice) ++arg_no;
+        }
+        ++arg_no;
+    }
+    signatures[function] = signature;
+    return function;
+}
+
+// Adds the attributes asked for by the annotations of func_lit:
+//   @inline @noinline    alwaysinline, noinline
+//   @cold @hot           cold, hot
+//   @pure                reads but never writes memory
+//   @const               neither reads nor writes memory
+//   @target_clones(...)  one version per named target, see emit_target_clones()
+// @pure and @const also promise the function returns and does not unwind.
+// A result passed in memory is still written through the sret pointer, so
+// there they only narrow the function to argument memory. Unknown or
+// contradictory annotations, and @pure or @const on an async function, whose
+// frame lives on the heap, are reported and make it return false.
+// @target_clones is not available with --freestanding, as its resolver needs
+// libgcc's CPU detection.
+bool CodeGenerator::apply_annotations(const FunctionLiteral& func_lit, llvm::Function* function) {
+    static const Symbol inline_name = intern("inline"), noinline_name = intern("noinline");
+    static const Symbol cold_name = intern("cold"), hot_name = intern("hot");
+    static const Symbol pure_name = intern("pure"), const_name = intern("const");
+    static const Symbol target_clones_name = intern("target_clones"), default_name = intern("default");
+    std::set<Symbol> given;
+    std::vector<const CloneTarget*> clones;
+    bool clones_default = false;
+    for (const auto& annotation : func_lit.annotations) {
+        Symbol name = annotation.name;
+        if (name == target_clones_name) {
+            // Versions of async and generic functions would each need their own frame or instance.
+            const char* unsupported = func_lit.is_async ? "on an async function"
+                                    : !func_lit.type_parameters.empty() ? "on a generic function"
+                                    : function->getName() == "main" ? "on main"
+                                    : options.freestanding ? "with --freestanding" : nullptr;
+            if (unsupported) {
+                report_error(func_lit, std::string("@target_clones cannot be used ") + unsupported);
+                return false;
+            }
+            for (Symbol argument : annotation.arguments) {
+                if (argument == default_name) {
+                    clones_default = true;
+                    continue;
+                }
+                const CloneTarget* clone = find_clone_target(symbol_name(argument));
+                if (!clone) {
+                    report_error(func_lit, "unknown @target_clones target " + symbol_name(argument));
+                    return false;
+                }
+                if (std::find(clones.begin(), clones.end(), clone) != clones.end()) {
+                    report_error(func_lit, "@target_clones names " + symbol_name(argument) + " more than once");
+                    return false;
+                }
+                clones.push_back(clone);
+            }
+            if (!clones_default) {
+                report_error(func_lit, "@target_clones needs a default version: add default to its targets");
+                return false;
+            }
+        } else if (name != inline_name && name != noinline_name && name != cold_name && name != hot_name && name != pure_name && name != const_name) {
+            report_error(func_lit, "unknown function annotation " + annotation_to_string(annotation));
+            return false;
+        } else if (!annotation.arguments.empty()) {
+            report_error(func_lit, "@" + symbol_name(name) + " takes no arguments");
+            return false;
+        }
+        given.insert(name);
+    }
+    if (given.count(inline_name) && given.count(noinline_name)) {
+        report_error(func_lit, "@inline and @noinline contradict each other");
+        return false;
+    }
+    if (given.count(cold_name) && given.count(hot_name)) {
+        report_error(func_lit, "@cold and @hot contradict each other");
+        return false;
+    }
+    bool pure = given.count(pure_name) > 0, is_const = given.count(const_name) > 0;
+    if ((pure || is_const) && func_lit.is_async) {
+        report_error(func_lit, std::string(is_const ? "@const" : "@pure") + " cannot be used on an async function, whose frame lives on the heap");
+        return false;
+    }
+
+    if (given.count(inline_name)) function->addFnAttr(llvm::Attribute::AlwaysInline);
+    if (given.count(noinline_name)) function->addFnAttr(llvm::Attribute::NoInline);
+    if (given.count(cold_name)) function->addFnAttr(llvm::Attribute::Cold);
+    if (given.count(hot_name)) function->addFnAttr(llvm::Attribute::Hot);
+    if (pure || is_const) {
+        llvm::ModRefInfo access = is_const ? llvm::ModRefInfo::NoModRef : llvm::ModRefInfo::Ref;
+        function->setMemoryEffects(function->hasStructRetAttr() ? llvm::MemoryEffects::argMemOnly() : llvm::MemoryEffects(access));
+        function->setDoesNotThrow();
+        function->setWillReturn();
+    }
+    if (!clones.empty()) cloned_functions[function] = clones;
+    return true;
+}
+
+// Replaces each function annotated with @target_clones by an ifunc of the
+// same name. Its resolver runs once when the program is loaded and picks the
+// most preferred version the CPU supports: `name.<target>`, compiled with
+// that target's feature on top of the module's, or else `name.default`, the
+// original body. The CPU is probed through __cpu_indicator_init and
+// __cpu_model, which libgcc and compiler-rt both provide. ifuncs are an ELF
+// x86 feature; elsewhere only the default version is kept.
+void CodeGenerator::emit_target_clones() {
+    if (cloned_functions.empty() || !llvm::Triple(module->getTargetTriple()).isX86()) return;
+    llvm::Type* i32 = builder->getInt32Ty();
+    llvm::StructType* cpu_model_type = llvm::StructType::get(*context, {i32, i32, i32, llvm::ArrayType::get(i32, 1)});
+    llvm::Constant* cpu_model = module->getOrInsertGlobal("__cpu_model", cpu_model_type);
+    llvm::FunctionCallee cpu_init = module->getOrInsertFunction("__cpu_indicator_init", builder->getVoidTy());
+
+    for (auto& entry : cloned_functions) {
+        llvm::Function* function = entry.first;
+        std::vector<const CloneTarget*> targets = entry.second;
+        std::sort(targets.begin(), targets.end(), [](const CloneTarget* a, const CloneTarget* b) { return a->priority > b->priority; });
+        std::string name = function->getName().str();
+        std::string base_features = function->getFnAttribute("target-features").getValueAsString().str();
+
+        std::vector<llvm::Function*> versions;
+        for (const CloneTarget* target : targets) {
+            llvm::ValueToValueMapTy map;
+            llvm::Function* version = llvm::CloneFunction(function, map);
+            version->setName(name + "." + target->name);
+            version->setLinkage(llvm::Function::InternalLinkage);
+            version->addFnAttr("target-features", base_features.empty() ? target->feature : base_features + "," + target->feature);
+            versions.push_back(version);
+        }
+
+        // Every caller, recursive calls in the versions included, now goes through the ifunc.
+        llvm::Function* resolver = llvm::Function::Create(llvm::FunctionType::get(builder->getPtrTy(), false),
+                                                          llvm::Function::InternalLinkage, name + ".resolver", module.get());
+        llvm::GlobalIFunc* ifunc = llvm::GlobalIFunc::create(function->getFunctionType(), 0, function->getLinkage(), "", resolver, module.get());
+        function->replaceAllUsesWith(ifunc);
+        function->setName(name + ".default");
+        function->setLinkage(llvm::Function::InternalLinkage);
+        ifunc->setName(name);
+
+        llvm::IRBuilder<> resolver_builder(llvm::BasicBlock::Create(*context, "entry", resolver));
+        resolver_builder.CreateCall(cpu_init);
+        llvm::Value* features_address = resolver_builder.CreateConstInBoundsGEP2_32(cpu_model_type, cpu_model, 0, 3);
+        llvm::Value* features = resolver_builder.CreateLoad(i32, features_address, "cpu_features");
+        for (size_t i = 0; i < targets.size(); ++i) {
+            llvm::Constant* mask = resolver_builder.getInt32(1u << targets[i]->cpu_feature);
+            llvm::Value* supported = resolver_builder.CreateICmpEQ(resolver_builder.CreateAnd(features, mask), mask, targets[i]->name);
+            llvm::BasicBlock* use_bb = llvm::BasicBlock::Create(*context, std::string("use.") + targets[i]->name, resolver);
+            llvm::BasicBlock* next_bb = llvm::BasicBlock::Create(*context, "next", resolver);
+            resolver_builder.CreateCondBr(supported, use_bb, next_bb);
+            resolver_builder.SetInsertPoint(use_bb);
+            resolver_builder.CreateRet(versions[i]);
+            resolver_builder.SetInsertPoint(next_bb);
+        }
+        resolver_builder.CreateRet(function);
+    }
+}
+
+// Element type of an array, slice or pointer expression, as far as it can be
+// told from the expression itself; nullptr otherwise.
+llvm::Type* CodeGenerator::element_type(const Expression& expr) {
+    if (auto const* ident = dynamic_cast<const Identifier*>(&expr)) {
+        llvm::Value* storage = lookup_variable(ident->symbol);
+        if (!storage) return nullptr;
+        if (auto* array_type = llvm::dyn_cast<llvm::ArrayType>(storage_type(storage))) return array_type->getElementType();
+        auto it = element_types.find(storage);
+        return it != element_types.end() ? it->second : nullptr;
+    }
+    if (auto const* prefix_expr = dynamic_cast<const PrefixExpression*>(&expr)) {
+        if (prefix_expr->op != "&" || !prefix_expr->right) return nullptr;
+        if (auto const* ident = dynamic_cast<const Identifier*>(prefix_expr->right.get())) {
+            llvm::Value* storage = lookup_variable(ident->symbol);
+            if (!storage) return nullptr;
+            if (auto* array_type = llvm::dyn_cast<llvm::ArrayType>(storage_type(storage))) return array_type->getElementType();
+            return storage_type(storage);
+        }
+        if (auto const* index_expr = dynamic_cast<const IndexExpression*>(prefix_expr->right.get())) return element_type(*index_expr->left);
+        if (auto const* member_expr = dynamic_cast<const MemberExpression*>(prefix_expr->right.get())) return member_type(*member_expr);
+        return nullptr;
+    }
+    if (auto const* slice_expr = dynamic_cast<const SliceExpression*>(&expr)) return element_type(*slice_expr->left);
+    return nullptr;
+}
+
+// Evaluates an array or slice expression as its data pointer and i64 length.
+// Arrays are not copied: the slice points at the array's own storage.
+bool CodeGenerator::generate_slice_parts(const Expression& expr, llvm::Value** data, llvm::Value** length, llvm::Type** element) {
+    llvm::Value* value = generate_expression(expr);
+    if (!value) return false;
+    if (llvm::isa<llvm::AllocaInst>(value) || llvm::isa<llvm::GlobalVariable>(value)) {
+        llvm::ArrayType* array_type = array_storage(value);
+        if (!array_type) return false;
+        *data = value;
+        *length = builder->getInt64(array_type->getNumElements());
+        *element = array_type->getElementType();
+        return true;
+    }
+    if (!slice_type || value->getType() != slice_type) return false;
+    *element = element_type(expr);
+    if (!*element) return false;
+    *data = builder->CreateExtractValue(value, 0, "slice_data");
+    *length = builder->CreateExtractValue(value, 1, "slice_len");
+    return true;
+}
+
+llvm::Value* CodeGenerator::make_slice(llvm::Value* data, llvm::Value* length) {
+    if (!slice_type) slice_type = llvm::StructType::create(*context, {builder->getPtrTy(), builder->getInt64Ty()}, "manit.slice");
+    llvm::Value* slice = builder->CreateInsertValue(llvm::PoisonValue::get(slice_type), data, 0);
+    return builder->CreateInsertValue(slice, length, 1, "slice");
+}
+
+void CodeGenerator::define_struct(llvm::StructType* type, const std::vector<std::pair<Symbol, llvm::Type*>>& fields) {
+    std::vector<llvm::Type*> field_types;
+    std::vector<Symbol>& names = struct_fields[type];
+    for (const auto& field : fields) {
+        names.push_back(field.first);
+        field_types.push_back(field.second);
+    }
+    type->setBody(field_types);
+}
+
+int CodeGenerator::field_index(llvm::StructType* type, Symbol field) {
+    auto it = struct_fields.find(type);
+    if (it == struct_fields.end()) return -1;
+    auto found = std::find(it->second.begin(), it->second.end(), field);
+    return found != it->second.end() ? static_cast<int>(found - it->second.begin()) : -1;
+}
+
+// Type of the field named by member_expr, without generating code; nullptr if
+// its struct cannot be told from the expression.
+llvm::Type* CodeGenerator::member_type(const MemberExpression& member_expr) {
+    llvm::Type* base = nullptr;
+    if (auto const* ident = dynamic_cast<const Identifier*>(member_expr.left.get())) {
+        llvm::Value* storage = lookup_variable(ident->symbol);
+        base = storage && storage_type(storage)->isStructTy() ? storage_type(storage) : element_type(*ident);
+    } else if (auto const* inner = dynamic_cast<const MemberExpression*>(member_expr.left.get())) {
+        base = member_type(*inner);
+    }
+    auto* struct_type = llvm::dyn_cast_or_null<llvm::StructType>(base);
+    int index = struct_type ? field_index(struct_type, member_expr.field->symbol) : -1;
+    return index < 0 ? nullptr : struct_type->getElementType(index);
+}
+
+// Address of a struct that lives in memory: a struct variable, the target of
+// a pointer to a struct, or a struct field of either. nullptr for struct
+// values that are not in memory (literals, call results).
+llvm::Value* CodeGenerator::struct_address(const Expression& expr, llvm::StructType** type) {
+    if (auto const* ident = dynamic_cast<const Identifier*>(&expr)) {
+        llvm::Value* storage = lookup_variable(ident->symbol);
+        if (!storage) return nullptr;
+        if ((*type = llvm::dyn_cast<llvm::StructType>(storage_type(storage)))) return storage;
+        // Pointers to structs are dereferenced implicitly, as in `p.x`.
+        auto it = element_types.find(storage);
+        if (it == element_types.end() || !(*type = llvm::dyn_cast<llvm::StructType>(it->second))) return nullptr;
+        return builder->CreateLoad(builder->getPtrTy(), storage, ident->name());
+    }
+    if (auto const* member_expr = dynamic_cast<const MemberExpression*>(&expr)) {
+        if (!(*type = llvm::dyn_cast_or_null<llvm::StructType>(member_type(*member_expr)))) return nullptr;
+        llvm::Type* field_type = nullptr;
+        return member_pointer(*member_expr, &field_type);
+    }
+    if (auto const* prefix_expr = dynamic_cast<const PrefixExpression*>(&expr)) {
+        if (prefix_expr->op != "*" || !(*type = llvm::dyn_cast_or_null<llvm::StructType>(element_type(*prefix_expr->right)))) return nullptr;
+        return generate_expression(*prefix_expr->right);
+    }
+    return nullptr;
+}
+
+llvm::Value* CodeGenerator::member_pointer(const MemberExpression& member_expr, llvm::Type** field_type) {
+    llvm::StructType* struct_type = nullptr;
+    if (!member_type(member_expr)) return nullptr;
+    llvm::Value* base = struct_address(*member_expr.left, &struct_type);
+    if (!base) return nullptr;
+    int index = field_index(struct_type, member_expr.field->symbol);
+    *field_type = struct_type->getElementType(index);
+    return builder->CreateStructGEP(struct_type, base, index, member_expr.field->name() + ".addr");
+}
+
+// Struct type of a literal or a call that returns a struct: the expressions
+// generate_into() can build in place.
+llvm::StructType* CodeGenerator::struct_result_type(const Expression& expr) {
+    if (auto const* struct_lit = dynamic_cast<const StructLiteral*>(&expr)) return struct_types.lookup(struct_lit->type_name);
+    if (auto const* call_expr = dynamic_cast<const CallExpression*>(&expr)) {
+        auto const* ident = dynamic_cast<const Identifier*>(call_expr->function.get());
+        auto signature = ident ? signatures.find(functions.lookup(ident->symbol)) : signatures.end();
+        if (signature != signatures.end()) return llvm::dyn_cast<llvm::StructType>(signature->second.return_type);
+        const FunctionLiteral* generic = ident && !functions.lookup(ident->symbol) ? generic_functions.lookup(ident->symbol) : nullptr;
+        if (generic) return llvm::dyn_cast_or_null<llvm::StructType>(generic_result_type(*generic, *call_expr));
+    }
+    return nullptr;
+}
+
+// Builds the struct produced by expr directly in dest instead of producing
+// a value to be copied there. Only literals and calls returning structs
+// qualify (see struct_result_type); returns false for anything else.
+bool CodeGenerator::generate_into(const Expression& expr, llvm::Value* dest) {
+    if (auto const* struct_lit = dynamic_cast<const StructLiteral*>(&expr)) {
+        llvm::StructType* struct_type = struct_types.lookup(struct_lit->type_name);
+        if (!struct_type) return false;
+        if (struct_lit->fields.size() < struct_type->getNumElements()) builder->CreateStore(llvm::Constant::getNullValue(struct_type), dest);
+        for (const auto& field : struct_lit->fields) {
+            int index = field_index(struct_type, field.first->symbol);
+            llvm::Value* value = index < 0 ? nullptr : generate_expression(*field.second);
+            if (!value || value->getType() != struct_type->getElementType(index)) return false;
+            builder->CreateStore(value, builder->CreateStructGEP(struct_type, dest, index, field.first->name() + ".addr"));
+        }
+        return true;
+    }
+    auto const* call_expr = dynamic_cast<const CallExpression*>(&expr);
+    return call_expr && struct_result_type(expr) && generate_call(*call_expr, dest);
+}
+
+// Splits an aggregate into the integer registers that carry it, going
+// through a stack slot sized for the registers (which may be larger than
+// the struct, as for { i32, i32, i32 } in i64 + i32).
+std::vector<llvm::Value*> CodeGenerator::to_registers(llvm::Value* aggregate, const std::vector<llvm::Type*>& registers) {
+    std::vector<llvm::Value*> pieces;
+    if (registers.empty()) return pieces;
+    llvm::Type* coerced_type = register_type(registers);
+    llvm::AllocaInst* slot = create_entry_block_alloca(builder->GetInsertBlock()->getParent(), "coerce", coerced_type);
+    builder->CreateStore(aggregate, slot);
+    if (registers.size() == 1) return {builder->CreateLoad(registers[0], slot, "coerce.val")};
+    for (unsigned i = 0; i < registers.size(); ++i) {
+        pieces.push_back(builder->CreateLoad(registers[i], builder->CreateStructGEP(coerced_type, slot, i), "coerce.val"));
+    }
+    return pieces;
+}
+
+llvm::Value* CodeGenerator::from_registers(llvm::StructType* type, const std::vector<llvm::Value*>& pieces) {
+    if (pieces.empty()) return llvm::Constant::getNullValue(type);
+    std::vector<llvm::Type*> registers;
+    for (llvm::Value* piece : pieces) registers.push_back(piece->getType());
+    llvm::Type* coerced_type = register_type(registers);
+    llvm::AllocaInst* slot = create_entry_block_alloca(builder->GetInsertBlock()->getParent(), "coerce", coerced_type);
+    if (pieces.size() == 1) builder->CreateStore(pieces[0], slot);
+    for (unsigned i = 0; pieces.size() > 1 && i < pieces.size(); ++i) builder->CreateStore(pieces[i], builder->CreateStructGEP(coerced_type, slot, i));
+    return builder->CreateLoad(type, slot, "coerce.agg");
+}
+
+// Returns value (or the zero value when null) from the current function
+// according to its signature's result lowering.
+void CodeGenerator::generate_return(const Expression* value) {
+    if (coroutine) {
+        llvm::Value* result = value ? generate_expression(*value) : builder->getInt32(0);
+        if (!result) return;
+        if (result->getType()->isIntegerTy(1)) result = builder->CreateZExt(result, builder->getInt32Ty());
+        if (!result->getType()->isIntegerTy(32)) return;
+        builder->CreateStore(result, builder->CreateStructGEP(promise_type, coroutine->promise, 0, "result.addr"));
+        builder->CreateBr(coroutine->final_block);
+        return;
+    }
+    llvm::Function* the_function = builder->GetInsertBlock()->getParent();
+    auto signature = signatures.find(the_function);
+    llvm::Type* type = signature != signatures.end() ? signature->second.return_type : the_function->getReturnType();
+    auto* struct_type = llvm::dyn_cast<llvm::StructType>(type);
+    AggregateABI abi = struct_type ? classify_aggregate(struct_type, module->getDataLayout()) : AggregateABI();
+
+    if (struct_type && abi.in_memory) {
+        llvm::Value* dest = the_function->getArg(0);
+        if (!value) builder->CreateStore(llvm::Constant::getNullValue(struct_type), dest);
+        else if (!generate_into(*value, dest)) {
+            llvm::Value* result = generate_expression(*value);
+            if (!result || result->getType() != struct_type) return;
+            builder->CreateStore(result, dest);
+        }
+        builder->CreateRetVoid();
+        return;
+    }
+    llvm::Value* result = value ? generate_expression(*value) : llvm::Constant::getNullValue(type);
+    if (!result) return;
+    if (type->isIntegerTy(32) && result->getType()->isIntegerTy(1)) result = builder->CreateZExt(result, type);
+    if (result->getType() != type) return;
+    if (!struct_type) { builder->CreateRet(result); return; }
+    std::vector<llvm::Value*> pieces = to_registers(result, abi.registers);
+    if (pieces.empty()) { builder->CreateRetVoid(); return; }
+    llvm::Value* returned = pieces[0];
+    if (pieces.size() > 1) {
+        returned = llvm::PoisonValue::get(the_function->getReturnType());
+        for (unsigned i = 0; i < pieces.size(); ++i) returned = builder->CreateInsertValue(returned, pieces[i], i);
+    }
+    builder->CreateRet(returned);
+}
+
+// Lowers a call by name. A struct result is returned as an aggregate value,
+// or, when dest is given, stored there; a result passed in memory then goes
+// straight to dest through the sret pointer. Returns nullptr on failure.
+llvm::Value* CodeGenerator::generate_call(const CallExpression& call_expr, llvm::Value* dest) {
+    auto const* ident = dynamic_cast<const Identifier*>(call_expr.function.get()); if (!ident) return nullptr;
+    llvm::Function* callee_func = functions.lookup(ident->symbol);
+    if (!callee_func && generic_functions.lookup(ident->symbol)) callee_func = instantiate(ident->symbol, call_expr);
+    static const Symbol len_symbol = intern("len");
+    if (!callee_func && ident->symbol == len_symbol && call_expr.arguments.size() == 1) {
+        llvm::Value* data; llvm::Value* length; llvm::Type* element_type;
+        if (!generate_slice_parts(*call_expr.arguments[0], &data, &length, &element_type)) return nullptr;
+        return builder->CreateTrunc(length, builder->getInt32Ty(), "len");
+    }
+    auto signature = callee_func ? signatures.find(callee_func) : signatures.end();
+    if (signature == signatures.end() || signature->second.params.size() != call_expr.arguments.size()) return nullptr;
+    const llvm::DataLayout& layout = module->getDataLayout();
+    llvm::Function* the_function = builder->GetInsertBlock()->getParent();
+    auto* result_struct = llvm::dyn_cast<llvm::StructType>(signature->second.return_type);
+    AggregateABI result_abi = result_struct ? classify_aggregate(result_struct, layout) : AggregateABI();
+    std::vector<llvm::Value*> args_v;
+    llvm::Value* result_slot = nullptr;
+    if (result_struct && result_abi.in_memory) {
+        result_slot = dest ? dest : create_entry_block_alloca(the_function, "sret.tmp", result_struct);
+        args_v.push_back(result_slot);
+    }
+    for (size_t i = 0; i < call_expr.arguments.size(); ++i) {
+        const ParameterType& param = signature->second.params[i];
+        const Expression& argument = *call_expr.arguments[i];
+        if (param.kind == ParameterType::Kind::Slice) {
+            llvm::Value* data; llvm::Value* length; llvm::Type* element_type;
+            if (!generate_slice_parts(argument, &data, &length, &element_type) || element_type != param.type) return nullptr;
+            args_v.push_back(data); args_v.push_back(length);
+            continue;
+        }
+        if (llvm::StructType* struct_type = struct_parameter(param)) {
+            AggregateABI abi = classify_aggregate(struct_type, layout);
+            if (abi.in_memory) {
+                // The callee owns its byval copy; build the argument in it directly.
+                llvm::AllocaInst* copy = create_entry_block_alloca(the_function, "byval.tmp", struct_type);
+                if (!generate_into(argument, copy)) {
+                    llvm::Value* value = generate_expression(argument);
+                    if (!value || value->getType() != struct_type) return nullptr;
+                    builder->CreateStore(value, copy);
+                }
+                args_v.push_back(copy);
+                continue;
+            }
+            llvm::Value* value = generate_expression(argument);
+            if (!value || value->getType() != struct_type) return nullptr;
+            std::vector<llvm::Value*> pieces = to_registers(value, abi.registers);
+            args_v.insert(args_v.end(), pieces.begin(), pieces.end());
+            continue;
+        }
+        llvm::Value* value = generate_expression(argument); if (!value) return nullptr;
+        if (param.kind == ParameterType::Kind::Pointer ? (!value->getType()->isPointerTy() || element_type(argument) != param.type) : value->getType() != param.type) return nullptr;
+        args_v.push_back(value);
+    }
+    llvm::CallInst* call = builder->CreateCall(callee_func, args_v, callee_func->getReturnType()->isVoidTy() ? "" : "calltmp");
+    call->setAttributes(callee_func->getAttributes());
+    if (!result_struct) return call;
+
+    llvm::Value* result;
+    if (result_slot) {
+        if (result_slot == dest) return dest;
+        result = builder->CreateLoad(result_struct, result_slot, "sret.val");
+    } else {
+        std::vector<llvm::Value*> pieces;
+        if (result_abi.registers.size() == 1) pieces.push_back(call);
+        for (unsigned r = 0; result_abi.registers.size() > 1 && r < result_abi.registers.size(); ++r) pieces.push_back(builder->CreateExtractValue(call, r));
+        result = from_registers(result_struct, pieces);
+    }
+    if (!dest) return result;
+    builder->CreateStore(result, dest);
+    return dest;
+}
+
+// Static type of a value expression, without generating code: enough to
+// infer type arguments from call arguments. nullptr if it cannot be told.
+llvm::Type* CodeGenerator::value_type(const Expression& expr) {
+    static const Symbol len_symbol = intern("len");
+    if (dynamic_cast<const IntegerLiteral*>(&expr)) return builder->getInt32Ty();
+    if (dynamic_cast<const BooleanLiteral*>(&expr)) return builder->getInt1Ty();
+    if (dynamic_cast<const AwaitExpression*>(&expr)) return builder->getInt32Ty();
+    if (auto const* ident = dynamic_cast<const Identifier*>(&expr)) {
+        if (llvm::Value* storage = lookup_variable(ident->symbol)) return storage_type(storage)->isArrayTy() ? nullptr : storage_type(storage);
+        llvm::Constant* constant = constants.lookup(ident->symbol);
+        return constant ? constant->getType() : nullptr;
+    }
+    if (auto const* struct_lit = dynamic_cast<const StructLiteral*>(&expr)) return struct_types.lookup(struct_lit->type_name);
+    if (auto const* member_expr = dynamic_cast<const MemberExpression*>(&expr)) return member_type(*member_expr);
+    if (auto const* index_expr = dynamic_cast<const IndexExpression*>(&expr)) return element_type(*index_expr->left);
+    if (auto const* assign_expr = dynamic_cast<const AssignmentExpression*>(&expr)) return value_type(*assign_expr->value);
+    if (auto const* prefix_expr = dynamic_cast<const PrefixExpression*>(&expr)) {
+        if (prefix_expr->op == "!") return builder->getInt1Ty();
+        if (prefix_expr->op == "&") return builder->getPtrTy();
+        if (prefix_expr->op == "*") return element_type(*prefix_expr->right);
+        return value_type(*prefix_expr->right);
+    }
+    if (auto const* infix_expr = dynamic_cast<const InfixExpression*>(&expr)) {
+        const std::string& op = infix_expr->op;
+        if (op == "==" || op == "!=" || op == "<" || op == "<=" || op == ">" || op == ">=") return builder->getInt1Ty();
+        return value_type(*infix_expr->left);
+    }
+    if (auto const* call_expr = dynamic_cast<const CallExpression*>(&expr)) {
+        auto const* ident = dynamic_cast<const Identifier*>(call_expr->function.get());
+        if (!ident) return nullptr;
+        if (llvm::Function* callee = functions.lookup(ident->symbol)) {
+            auto signature = signatures.find(callee);
+            return signature != signatures.end() ? signature->second.return_type : nullptr;
+        }
+        if (const FunctionLiteral* generic = generic_functions.lookup(ident->symbol)) return generic_result_type(*generic, *call_expr);
+        return ident->symbol == len_symbol ? builder->getInt32Ty() : nullptr;
+    }
+    return nullptr;
+}
+
+// Binds the type parameters of generic from the arguments of call_expr: a
+// parameter declared `T` takes the argument's type, `*T` and `[]T` its
+// pointee or element type. Every type parameter must be bound, the same way
+// by each argument, to i32, i64, bool or a struct.
+bool CodeGenerator::infer_type_arguments(const FunctionLiteral& generic, const CallExpression& call_expr, std::vector<std::pair<Symbol, llvm::Type*>>& bindings) {
+    if (generic.parameters.size() != call_expr.arguments.size()) return false;
+    bindings.clear();
+    for (Symbol parameter : generic.type_parameters) bindings.emplace_back(parameter, nullptr);
+    for (size_t i = 0; i < generic.parameters.size(); ++i) {
+        const TypeAnnotation* annotation = i < generic.parameter_types.size() ? generic.parameter_types[i].get() : nullptr;
+        if (!annotation) continue;
+        const TypeAnnotation* named = annotation->kind == TypeAnnotation::Kind::Named ? annotation : annotation->element.get();
+        auto binding = std::find_if(bindings.begin(), bindings.end(), [named](const auto& b) { return b.first == named->name; });
+        if (named->kind != TypeAnnotation::Kind::Named || binding == bindings.end()) continue;
+        const Expression& argument = *call_expr.arguments[i];
+        llvm::Type* type = annotation->kind == TypeAnnotation::Kind::Named ? value_type(argument) : element_type(argument);
+        if (!type || (binding->second && binding->second != type)) return false;
+        binding->second = type;
+    }
+    for (const auto& binding : bindings) {
+        llvm::Type* type = binding.second;
+        if (!type) return false;
+        auto* struct_type = llvm::dyn_cast<llvm::StructType>(type);
+        bool nameable = struct_type ? struct_type->hasName() && struct_types.lookup(intern(struct_type->getName())) == struct_type
+                                    : type->isIntegerTy(1) || type->isIntegerTy(32) || type->isIntegerTy(64);
+        if (!nameable) return false;
+    }
+    return true;
+}
+
+// Result type of calling generic with the arguments of call_expr, without
+// instantiating it.
+llvm::Type* CodeGenerator::generic_result_type(const FunctionLiteral& generic, const CallExpression& call_expr) {
+    std::vector<std::pair<Symbol, llvm::Type*>> bindings;
+    if (!infer_type_arguments(generic, call_expr, bindings)) return nullptr;
+    std::swap(type_arguments, bindings);
+    CallSignature signature;
+    llvm::Type* result = function_signature(generic, signature) ? signature.return_type : nullptr;
+    std::swap(type_arguments, bindings);
+    return result;
+}
+
+// Spelling of a type argument in mangled names.
+static std::string type_argument_name(llvm::Type* type) {
+    if (auto* struct_type = llvm::dyn_cast<llvm::StructType>(type)) return struct_type->getName().str();
+    if (type->isIntegerTy(1)) return "bool";
+    return "i" + std::to_string(type->getIntegerBitWidth());
+}
+
+// Returns the instance of the generic function `name` for the argument types
+// of call_expr, generating it on first use. Instances are named
+// `name<T1,T2>`; calls with the same type arguments share one. Instances of
+// shared generics over builtin types are linkonce_odr, so the linker keeps
+// one copy across modules, and their names start with the defining module
+// (`module.name<T1,T2>`) as another module may have a generic of that name;
+// struct names are only unique within a module, so instances over structs
+// stay internal.
+llvm::Function* CodeGenerator::instantiate(Symbol name, const CallExpression& call_expr) {
+    const FunctionLiteral* generic = generic_functions.lookup(name);
+    std::vector<std::pair<Symbol, llvm::Type*>> bindings;
+    if (!generic || !infer_type_arguments(*generic, call_expr, bindings)) return nullptr;
+    auto defining_module = shared_generics.find(generic);
+    bool shared = defining_module != shared_generics.end();
+    std::string mangled = (shared && !defining_module->second.empty() ? defining_module->second + "." : "") + symbol_name(name) + "<";
+    for (size_t i = 0; i < bindings.size(); ++i) {
+        mangled += (i ? "," : "") + type_argument_name(bindings[i].second);
+        shared = shared && !bindings[i].second->isStructTy();
+    }
+    mangled += ">";
+    Symbol instance_symbol = intern(mangled);
+    if (llvm::Function* instance = functions.lookup(instance_symbol)) return instance;
+
+    CallSignature signature;
+    llvm::Function* instance = nullptr;
+    std::swap(type_arguments, bindings);
+    if (function_signature(*generic, signature)) {
+        instance = create_function(signature, shared ? llvm::Function::LinkOnceODRLinkage : llvm::Function::InternalLinkage, mangled);
+        functions[instance_symbol] = instance;
+        // Source offsets of an imported generic do not belong to this file.
+        std::unique_ptr<llvm::DIBuilder> saved_debug_builder;
+        if (imported_generics.count(generic)) saved_debug_builder = std::move(debug_builder);
+        declared_functions[generic] = instance;
+        generate_expression(*generic);
+        declared_functions.erase(generic);
+        if (saved_debug_builder) debug_builder = std::move(saved_debug_builder);
+    }
+    std::swap(type_arguments, bindings);
+    return instance;
+}
+
+enum class Builtin {
+    Popcount, Clz, Ctz, Bswap, Rotl, Rotr, Prefetch, NontemporalStore, Rdtsc, Likely, Unlikely,
+    // Integer arithmetic, lowered by generate_arithmetic_builtin()
+    AddSat, SubSat, MulSat, AddOverflow, SubOverflow, MulOverflow,
+    // Tasks, lowered by generate_task_builtin()
+    Sleep, WaitReadable, Spawn, BlockOn, Run,
+    // Atomics, lowered by generate_atomic_builtin()
+    AtomicLoad, AtomicStore, FetchAdd, FetchSub, FetchAnd, FetchOr, FetchXor, Exchange,
+    CompareExchange, CompareExchangeWeak, Fence,
+};
+
+struct BuiltinInfo {
+    const char* name;
+    Builtin kind;
+    size_t arity;
+};
+
+static const BuiltinInfo builtin_table[] = {
+    {"popcount", Builtin::Popcount, 1}, {"clz", Builtin::Clz, 1},   {"ctz", Builtin::Ctz, 1},
+    {"bswap", Builtin::Bswap, 1},       {"rotl", Builtin::Rotl, 2}, {"rotr", Builtin::Rotr, 2},
+    {"prefetch", Builtin::Prefetch, 3}, {"nt_store", Builtin::NontemporalStore, 2},
+    {"rdtsc", Builtin::Rdtsc, 0},       {"likely", Builtin::Likely, 1}, {"unlikely", Builtin::Unlikely, 1},
+    {"add_sat", Builtin::AddSat, 2},    {"sub_sat", Builtin::SubSat, 2}, {"mul_sat", Builtin::MulSat, 2},
+    {"add_overflow", Builtin::AddOverflow, 3}, {"sub_overflow", Builtin::SubOverflow, 3}, {"mul_overflow", Builtin::MulOverflow, 3},
+    {"sleep", Builtin::Sleep, 1}, {"wait_readable", Builtin::WaitReadable, 1}, {"spawn", Builtin::Spawn, 1},
+    {"block_on", Builtin::BlockOn, 1}, {"run", Builtin::Run, 0},
+    {"atomic_load", Builtin::AtomicLoad, 2}, {"atomic_store", Builtin::AtomicStore, 3},
+    {"fetch_add", Builtin::FetchAdd, 3},     {"fetch_sub", Builtin::FetchSub, 3},
+    {"fetch_and", Builtin::FetchAnd, 3},     {"fetch_or", Builtin::FetchOr, 3},
+    {"fetch_xor", Builtin::FetchXor, 3},     {"exchange", Builtin::Exchange, 3},
+    {"compare_exchange", Builtin::CompareExchange, 5}, {"compare_exchange_weak", Builtin::CompareExchangeWeak, 5},
+    {"fence", Builtin::Fence, 1},
+};
+
+static const BuiltinInfo* find_builtin(Symbol name) {
+    static const SymbolMap<const BuiltinInfo*> table = [] {
+        SymbolMap<const BuiltinInfo*> map;
+        for (const auto& info : builtin_table) map[intern(info.name)] = &info;
+        return map;
+    }();
+    return table.lookup(name);
+}
+
+// Lowers `@name(args)`:
+//   @popcount(x) @clz(x) @ctz(x) @bswap(x)  bit operations on i32 or i64;
+//                                           clz and ctz of 0 give the width
+//   @rotl(x, n) @rotr(x, n)                 rotate x by n modulo its width
+//   @prefetch(p, rw, locality)              rw 0 (read) or 1 (write) and
+//                                           locality 0..3 must be constants
+//   @nt_store(p, v)                         store v to *p, bypassing caches
+//   @rdtsc()                                cycle counter as i64
+//   @likely(c) @unlikely(c)                 c, expected true or false; see
+//                                           generate_condition()
+// Bit operations on constant arguments fold to a constant. @prefetch and
+// @nt_store produce 0. Integer arithmetic, atomics and tasks are listed at
+// generate_arithmetic_builtin(), generate_atomic_builtin() and
+// generate_task_builtin().
+llvm::Value* CodeGenerator::generate_builtin(const BuiltinCall& builtin) {
+    const BuiltinInfo* info = find_builtin(builtin.name);
+    if (!info) {
+        // Also `@inline(x) fn`: of the annotations only @target_clones takes arguments.
+        report_error(builtin, "unknown builtin @" + symbol_name(builtin.name));
+        return nullptr;
+    }
+    if (builtin.arguments.size() != info->arity) {
+        report_error(builtin, "@" + symbol_name(builtin.name) + " takes " + std::to_string(info->arity) + " argument" + (info->arity == 1 ? "" : "s"));
+        return nullptr;
+    }
+    if (info->kind >= Builtin::AtomicLoad) return generate_atomic_builtin(builtin);
+    if (info->kind >= Builtin::Sleep) return generate_task_builtin(builtin);
+    if (info->kind >= Builtin::AddSat) return generate_arithmetic_builtin(builtin);
+    if (info->kind == Builtin::Rdtsc) return builder->CreateIntrinsic(llvm::Intrinsic::readcyclecounter, {}, {}, nullptr, "rdtsc");
+    if (info->kind == Builtin::Likely || info->kind == Builtin::Unlikely) {
+        llvm::Value* condition = generate_expression(*builtin.arguments[0]);
+        if (!condition || !condition->getType()->isIntegerTy(1)) return nullptr;
+        return builder->CreateIntrinsic(llvm::Intrinsic::expect, {condition->getType()},
+                                        {condition, builder->getInt1(info->kind == Builtin::Likely)}, nullptr, "expected");
+    }
+    if (info->kind == Builtin::Prefetch) {
+        llvm::Value* pointer = generate_expression(*builtin.arguments[0]);
+        auto* rw = llvm::dyn_cast_or_null<llvm::ConstantInt>(generate_expression(*builtin.arguments[1]));
+        auto* locality = llvm::dyn_cast_or_null<llvm::ConstantInt>(generate_expression(*builtin.arguments[2]));
+        if (!pointer || !pointer->getType()->isPointerTy() || !rw || rw->getZExtValue() > 1 || !locality || locality->getZExtValue() > 3) return nullptr;
+        // The last operand selects the data (1) rather than the instruction cache.
+        builder->CreateIntrinsic(llvm::Intrinsic::prefetch, {pointer->getType()},
+                                 {pointer, builder->getInt32(rw->getZExtValue()), builder->getInt32(locality->getZExtValue()), builder->getInt32(1)});
+        return builder->getInt32(0);
+    }
+    if (info->kind == Builtin::NontemporalStore) {
+        llvm::Value* pointer = generate_expression(*builtin.arguments[0]);
+        llvm::Value* value = generate_expression(*builtin.arguments[1]);
+        if (!pointer || !value || !pointer->getType()->isPointerTy() || element_type(*builtin.arguments[0]) != value->getType()) return nullptr;
+        llvm::StoreInst* store = builder->CreateStore(value, pointer);
+        store->setMetadata(llvm::LLVMContext::MD_nontemporal, llvm::MDNode::get(*context, llvm::ConstantAsMetadata::get(builder->getInt32(1))));
+        return builder->getInt32(0);
+    }
+
+    llvm::Value* value = generate_expression(*builtin.arguments[0]);
+    if (!value || !(value->getType()->isIntegerTy(32) || value->getType()->isIntegerTy(64))) return nullptr;
+    llvm::Type* type = value->getType();
+    llvm::Value* amount = nullptr;
+    if (info->kind == Builtin::Rotl || info->kind == Builtin::Rotr) {
+        amount = generate_expression(*builtin.arguments[1]);
+        if (!amount || !amount->getType()->isIntegerTy() || amount->getType()->isIntegerTy(1)) return nullptr;
+        amount = builder->CreateZExtOrTrunc(amount, type);
+    }
+
+    auto* constant = llvm::dyn_cast<llvm::ConstantInt>(value);
+    auto* constant_amount = llvm::dyn_cast_or_null<llvm::ConstantInt>(amount);
+    if (constant && (!amount || constant_amount)) {
+        const llvm::APInt& x = constant->getValue();
+        unsigned width = x.getBitWidth();
+        unsigned shift = constant_amount ? static_cast<unsigned>(constant_amount->getValue().urem(width)) : 0;
+        switch (info->kind) {
+            case Builtin::Popcount: return llvm::ConstantInt::get(type, x.popcount());
+            case Builtin::Clz: return llvm::ConstantInt::get(type, x.countl_zero());
+            case Builtin::Ctz: return llvm::ConstantInt::get(type, x.countr_zero());
+            case Builtin::Bswap: return llvm::ConstantInt::get(*context, x.byteSwap());
+            case Builtin::Rotl: return llvm::ConstantInt::get(*context, x.rotl(shift));
+            case Builtin::Rotr: return llvm::ConstantInt::get(*context, x.rotr(shift));
+            default: break;
+        }
+    }
+    switch (info->kind) {
+        case Builtin::Popcount: return builder->CreateUnaryIntrinsic(llvm::Intrinsic::ctpop, value, nullptr, "popcount");
+        case Builtin::Clz: return builder->CreateBinaryIntrinsic(llvm::Intrinsic::ctlz, value, builder->getFalse(), nullptr, "clz");
+        case Builtin::Ctz: return builder->CreateBinaryIntrinsic(llvm::Intrinsic::cttz, value, builder->getFalse(), nullptr, "ctz");
+        case Builtin::Bswap: return builder->CreateUnaryIntrinsic(llvm::Intrinsic::bswap, value, nullptr, "bswap");
+        // A funnel shift of a value with itself is a rotate.
+        case Builtin::Rotl: return builder->CreateIntrinsic(llvm::Intrinsic::fshl, {type}, {value, value, amount}, nullptr, "rotl");
+        case Builtin::Rotr: return builder->CreateIntrinsic(llvm::Intrinsic::fshr, {type}, {value, value, amount}, nullptr, "rotr");
+        default: return nullptr;
+    }
+}
+
+// Weights given to the expected and the other successor of a branch on a
+// hinted condition; the same ratio Clang gives __builtin_expect.
+static const std::uint32_t likely_branch_weight = 2000;
+static const std::uint32_t unlikely_branch_weight = 1;
+
+// Generates the condition of an if, while or for. A condition written as
+// @likely(c) or @unlikely(c) is generated as c, and weights is set to the
+// branch weights the conditional branch on it should carry; otherwise
+// weights is null.
+llvm::Value* CodeGenerator::generate_condition(const Expression& condition, llvm::MDNode** weights) {
+    *weights = nullptr;
+    auto const* hint = dynamic_cast<const BuiltinCall*>(&condition);
+    const BuiltinInfo* info = hint ? find_builtin(hint->name) : nullptr;
+    if (!info || (info->kind != Builtin::Likely && info->kind != Builtin::Unlikely) || hint->arguments.size() != 1) {
+        return generate_expression(condition);
+    }
+    llvm::Value* value = generate_expression(*hint->arguments[0]);
+    if (!value || !value->getType()->isIntegerTy(1)) return nullptr;
+    llvm::MDBuilder md(*context);
+    *weights = info->kind == Builtin::Likely ? md.createBranchWeights(likely_branch_weight, unlikely_branch_weight)
+                                             : md.createBranchWeights(unlikely_branch_weight, likely_branch_weight);
+    return value;
+}
+
+OverflowMode CodeGenerator::overflow_mode() const {
+    if (options.overflow != OverflowMode::Default) return options.overflow;
+    return options.opt_level == 0 ? OverflowMode::Trap : OverflowMode::Undefined;
+}
+
+// Continues in a new block if failed is false, and traps otherwise; checks
+// are expected to pass.
+void CodeGenerator::emit_trap_if(llvm::Value* failed, const char* name) {
+    llvm::Function* function = builder->GetInsertBlock()->getParent();
+    llvm::BasicBlock* trap_bb = llvm::BasicBlock::Create(*context, name, function);
+    llvm::BasicBlock* cont_bb = llvm::BasicBlock::Create(*context, "checked", function);
+    llvm::MDBuilder md(*context);
+    builder->CreateCondBr(failed, trap_bb, cont_bb, md.createBranchWeights(unlikely_branch_weight, likely_branch_weight));
+    builder->SetInsertPoint(trap_bb);
+    builder->CreateIntrinsic(llvm::Intrinsic::trap, {}, {});
+    builder->CreateUnreachable();
+    builder->SetInsertPoint(cont_bb);
+}
+
+// Lowers left + right, left - right or left * right (opcode Add, Sub or Mul)
+// on integers of one type. The wrapping operators `+%`, `-%` and `*%` always
+// wrap; the others overflow as overflow_mode() says. Signed overflow is all
+// there is to check: ManiT integers are signed, so nuw is never implied.
+// Overflow between constants is an error unless the operation wraps.
+llvm::Value* CodeGenerator::generate_arithmetic(const Node& node, llvm::Instruction::BinaryOps opcode, bool wrapping, llvm::Value* left, llvm::Value* right) {
+    const char* name = opcode == llvm::Instruction::Add ? "addtmp" : opcode == llvm::Instruction::Sub ? "subtmp" : "multmp";
+    wrapping = wrapping || overflow_mode() == OverflowMode::Wrap;
+    auto* constant_left = llvm::dyn_cast<llvm::ConstantInt>(left);
+    auto* constant_right = llvm::dyn_cast<llvm::ConstantInt>(right);
+    if (constant_left && constant_right) {
+        const llvm::APInt& a = constant_left->getValue();
+        const llvm::APInt& b = constant_right->getValue();
+        bool overflow = false;
+        llvm::APInt result = opcode == llvm::Instruction::Add ? a.sadd_ov(b, overflow)
+                           : opcode == llvm::Instruction::Sub ? a.ssub_ov(b, overflow) : a.smul_ov(b, overflow);
+        if (overflow && !wrapping) {
+            report_error(node, "integer overflow in constant expression " + node.to_string() + "; use a wrapping operator (+% -% *%) if intended");
+            return nullptr;
+        }
+        return llvm::ConstantInt::get(*context, result);
+    }
+    if (wrapping) return builder->CreateBinOp(opcode, left, right, name);
+    if (overflow_mode() == OverflowMode::Undefined) {
+        auto* result = llvm::cast<llvm::BinaryOperator>(builder->CreateBinOp(opcode, left, right, name));
+        result->setHasNoSignedWrap(true);
+        return result;
+    }
+    llvm::Intrinsic::ID checked = opcode == llvm::Instruction::Add ? llvm::Intrinsic::sadd_with_overflow
+                                : opcode == llvm::Instruction::Sub ? llvm::Intrinsic::ssub_with_overflow : llvm::Intrinsic::smul_with_overflow;
+    llvm::Value* pair = builder->CreateBinaryIntrinsic(checked, left, right);
+    emit_trap_if(builder->CreateExtractValue(pair, 1, "overflow"), "overflow_trap");
+    return builder->CreateExtractValue(pair, 0, name);
+}
+
+// Lowers left / right. A zero divisor traps in every mode but Undefined, and
+// so does MIN / -1, the one quotient that overflows, unless arithmetic wraps
+// (it gives MIN then). With --overflow=undefined both are undefined behavior,
+// as for sdiv. Checks that a constant operand rules out are left out.
+llvm::Value* CodeGenerator::generate_division(const Node& node, llvm::Value* left, llvm::Value* right) {
+    auto* constant_left = llvm::dyn_cast<llvm::ConstantInt>(left);
+    auto* constant_right = llvm::dyn_cast<llvm::ConstantInt>(right);
+    OverflowMode mode = overflow_mode();
+    if (constant_right && constant_right->isZero()) {
+        report_error(node, "division by zero in " + node.to_string());
+        return nullptr;
+    }
+    if (constant_left && constant_right) {
+        bool overflow = false;
+        llvm::APInt result = constant_left->getValue().sdiv_ov(constant_right->getValue(), overflow);
+        if (overflow && mode != OverflowMode::Wrap) {
+            report_error(node, "integer overflow in constant expression " + node.to_string());
+            return nullptr;
+        }
+        return llvm::ConstantInt::get(*context, result);
+    }
+    if (mode == OverflowMode::Undefined) return builder->CreateSDiv(left, right, "divtmp");
+    llvm::Type* type = left->getType();
+    if (!constant_right) emit_trap_if(builder->CreateICmpEQ(right, llvm::ConstantInt::get(type, 0), "div_by_zero"), "div_trap");
+    bool may_overflow = (!constant_right || constant_right->isMinusOne()) && (!constant_left || constant_left->isMinValue(true));
+    if (may_overflow) {
+        llvm::Value* overflow = builder->CreateAnd(builder->CreateICmpEQ(left, llvm::ConstantInt::get(type, llvm::APInt::getSignedMinValue(type->getIntegerBitWidth()))),
+                                                   builder->CreateICmpEQ(right, llvm::ConstantInt::getSigned(type, -1)), "div_overflow");
+        // MIN / 1 is the wrapped quotient of MIN / -1.
+        if (mode == OverflowMode::Wrap) right = builder->CreateSelect(overflow, llvm::ConstantInt::get(type, 1), right);
+        else emit_trap_if(overflow, "overflow_trap");
+    }
+    return builder->CreateSDiv(left, right, "divtmp");
+}
+
+// Lowers the integer arithmetic builtins, on two i32 or two i64:
+//   @add_sat(a, b) @sub_sat(a, b) @mul_sat(a, b)  the result clamped to the
+//                                                 type's range
+//   @add_overflow(a, b, p) @sub_overflow(a, b, p) @mul_overflow(a, b, p)
+//                                                 store the wrapped result to
+//                                                 *p and return true if it
+//                                                 overflowed (the error)
+// Saturating operations on constants fold to a constant.
+llvm::Value* CodeGenerator::generate_arithmetic_builtin(const BuiltinCall& builtin) {
+    const Builtin kind = find_builtin(builtin.name)->kind;
+    llvm::Value* left = generate_expression(*builtin.arguments[0]);
+    llvm::Value* right = generate_expression(*builtin.arguments[1]);
+    if (!left || !right || left->getType() != right->getType()) return nullptr;
+    llvm::Type* type = left->getType();
+    if (!type->isIntegerTy(32) && !type->isIntegerTy(64)) return nullptr;
+    if (kind == Builtin::AddSat || kind == Builtin::SubSat || kind == Builtin::MulSat) {
+        auto* constant_left = llvm::dyn_cast<llvm::ConstantInt>(left);
+        auto* constant_right = llvm::dyn_cast<llvm::ConstantInt>(right);
+        if (constant_left && constant_right) {
+            const llvm::APInt& a = constant_left->getValue();
+            const llvm::APInt& b = constant_right->getValue();
+            return llvm::ConstantInt::get(*context, kind == Builtin::AddSat ? a.sadd_sat(b) : kind == Builtin::SubSat ? a.ssub_sat(b) : a.smul_sat(b));
+        }
+        if (kind == Builtin::AddSat) return builder->CreateBinaryIntrinsic(llvm::Intrinsic::sadd_sat, left, right, nullptr, "add_sat");
+        if (kind == Builtin::SubSat) return builder->CreateBinaryIntrinsic(llvm::Intrinsic::ssub_sat, left, right, nullptr, "sub_sat");
+        // A fixed-point multiply with no fraction bits is an integer multiply.
+        return builder->CreateIntrinsic(llvm::Intrinsic::smul_fix_sat, {type}, {left, right, builder->getInt32(0)}, nullptr, "mul_sat");
+    }
+    llvm::Value* pointer = generate_expression(*builtin.arguments[2]);
+    if (!pointer || !pointer->getType()->isPointerTy() || element_type(*builtin.arguments[2]) != type) return nullptr;
+    llvm::Intrinsic::ID checked = kind == Builtin::AddOverflow ? llvm::Intrinsic::sadd_with_overflow
+                                : kind == Builtin::SubOverflow ? llvm::Intrinsic::ssub_with_overflow : llvm::Intrinsic::smul_with_overflow;
+    llvm::Value* pair = builder->CreateBinaryIntrinsic(checked, left, right);
+    builder->CreateStore(builder->CreateExtractValue(pair, 0), pointer);
+    return builder->CreateExtractValue(pair, 1, "overflow");
+}
+
+void CodeGenerator::report_error(const Node& node, const std::string& message) {
+    std::string where = source_path;
+    if (source_map) {
+        SourceLocation loc = source_map->locate(node.source_offset());
+        where += ":" + std::to_string(loc.line) + ":" + std::to_string(loc.column);
+    }
+    errors.push_back(where.empty() ? message : where + ": " + message);
+}
+
+// Ranges of up to this many values become one switch case per value, which
+// keeps them eligible for jump tables; wider ones are compared explicitly.
+static const std::uint64_t max_range_cases = 64;
+// Largest dispatch table a @computed_goto match may need (highest minus
+// lowest pattern value, plus one).
+static const std::uint64_t max_dispatch_table = 4096;
+
+// Lowers a match to a switch on the subject, from which the backend builds a
+// jump table, bit tests or a tree of comparisons, whichever suits the case
+// values. Without an else arm the patterns must cover every value of the
+// subject's type, and no two patterns may overlap.
+//
+// With @computed_goto the arms are reached through a table of block
+// addresses and an indirectbr instead. The backend duplicates an indirect
+// branch into its predecessors as it does for C's computed goto, so each arm
+// of an interpreter loop ends with its own copy of the dispatch.
+//
+// Arms whose values differ in type are an error unless value_used is false,
+// as for a match statement, whose arms may end in any expression.
+llvm::Value* CodeGenerator::generate_match(const MatchExpression& match_expr, bool value_used) {
+    static const Symbol computed_goto_name = intern("computed_goto");
+    bool computed_goto = false;
+    for (const auto& annotation : match_expr.annotations) {
+        if (annotation.name != computed_goto_name || !annotation.arguments.empty()) {
+            report_error(match_expr, "unknown match annotation " + annotation_to_string(annotation));
+            return nullptr;
+        }
+        computed_goto = true;
+    }
+    if (computed_goto && coroutine) {
+        report_error(match_expr, "@computed_goto cannot be used in an async function");
+        return nullptr;
+    }
+    llvm::Value* subject = generate_expression(*match_expr.subject);
+    if (!subject) return nullptr;
+    auto* type = llvm::dyn_cast<llvm::IntegerType>(subject->getType());
+    if (!type) {
+        report_error(*match_expr.subject, "match needs an integer or bool value");
+        return nullptr;
+    }
+    const unsigned width = type->getBitWidth();
+    const bool is_bool = width == 1;
+    const long long type_min = is_bool ? 0 : width == 64 ? std::numeric_limits<long long>::min() : -(1LL << (width - 1));
+    const long long type_max = is_bool ? 1 : width == 64 ? std::numeric_limits<long long>::max() : (1LL << (width - 1)) - 1;
+    auto pattern_value = [&](const Expression& expr, long long& value) {
+        std::string value_type;
+        if (!fold_constant(expr, value_type, value)) {
+            report_error(expr, "match pattern is not a constant");
+            return false;
+        }
+        if ((value_type == "bool") != is_bool || value < type_min || value > type_max) {
+            report_error(expr, "match pattern " + expr.to_string() + " is not a value of type " + type_argument_name(type));
+            return false;
+        }
+        return true;
+    };
+
+    // Every pattern as an inclusive range, with the arm it selects.
+    struct Case {
+        long long low, high;
+        size_t arm;
+        const Expression* pattern;
+        std::uint64_t span() const { return std::uint64_t(high) - std::uint64_t(low); } // Values after low
+    };
+    std::vector<Case> cases;
+    const size_t no_arm = match_expr.arms.size();
+    size_t default_arm = no_arm;
+    for (size_t i = 0; i < match_expr.arms.size(); ++i) {
+        const MatchArm& arm = match_expr.arms[i];
+        if (arm.patterns.empty()) {
+            if (default_arm != no_arm) {
+                report_error(*arm.body, "match has more than one else arm");
+                return nullptr;
+            }
+            default_arm = i;
+        }
+        for (const auto& pattern : arm.patterns) {
+            Case c{0, 0, i, pattern.low.get()};
+            if (!pattern_value(*pattern.low, c.low)) return nullptr;
+            c.high = c.low;
+            if (pattern.high && !pattern_value(*pattern.high, c.high)) return nullptr;
+            if (pattern.high && !pattern.inclusive) --c.high;
+            if (c.high < c.low) {
+                report_error(*pattern.low, "match pattern is an empty range");
+                return nullptr;
+            }
+            cases.push_back(c);
+        }
+    }
+    std::sort(cases.begin(), cases.end(), [](const Case& a, const Case& b) { return a.low < b.low; });
+    for (size_t i = 1; i < cases.size(); ++i) {
+        if (cases[i].low <= cases[i - 1].high) {
+            report_error(*cases[i].pattern, "match pattern overlaps an earlier one");
+            return nullptr;
+        }
+    }
+    if (default_arm == no_arm) {
+        // The first value no pattern covers, if any.
+        std::optional<long long> missing = type_min;
+        for (const Case& c : cases) {
+            if (c.low != *missing) break;
+            if (c.high == type_max) { missing.reset(); break; }
+            missing = c.high + 1;
+        }
+        if (missing) {
+            report_error(match_expr, "match is not exhaustive: " + (is_bool ? std::string(*missing ? "true" : "false") : std::to_string(*missing)) + " is not covered; add an else arm");
+            return nullptr;
+        }
+    }
+
+    llvm::Function* the_function = builder->GetInsertBlock()->getParent();
+    std::vector<llvm::BasicBlock*> arm_blocks;
+    for (size_t i = 0; i < match_expr.arms.size(); ++i) arm_blocks.push_back(llvm::BasicBlock::Create(*context, "match_arm"));
+    llvm::BasicBlock* merge_bb = llvm::BasicBlock::Create(*context, "match_end");
+    // An exhaustive match without an else arm never gets past its patterns.
+    llvm::BasicBlock* default_bb = default_arm != no_arm ? arm_blocks[default_arm] : llvm::BasicBlock::Create(*context, "match_unreachable", the_function);
+    if (default_arm == no_arm) {
+        llvm::IRBuilder<>::InsertPointGuard guard(*builder);
+        builder->SetInsertPoint(default_bb);
+        builder->CreateUnreachable();
+    }
+
+    if (computed_goto && !cases.empty()) {
+        long long low = cases.front().low, high = cases.back().high;
+        if (std::uint64_t(high) - std::uint64_t(low) >= max_dispatch_table) {
+            report_error(match_expr, "@computed_goto match needs its patterns within " + std::to_string(max_dispatch_table) + " consecutive values");
+            return nullptr;
+        }
+        const size_t size = static_cast<size_t>(std::uint64_t(high) - std::uint64_t(low) + 1);
+        std::vector<llvm::Constant*> targets(size, llvm::BlockAddress::get(the_function, default_bb));
+        for (const Case& c : cases) {
+            for (std::uint64_t k = 0; k <= c.span(); ++k) targets[std::uint64_t(c.low) - std::uint64_t(low) + k] = llvm::BlockAddress::get(the_function, arm_blocks[c.arm]);
+        }
+        auto* table_type = llvm::ArrayType::get(builder->getPtrTy(), size);
+        auto* table = new llvm::GlobalVariable(*module, table_type, true, llvm::GlobalValue::PrivateLinkage,
+                                               llvm::ConstantArray::get(table_type, targets), the_function->getName() + ".dispatch");
+        table->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+        llvm::Value* index = builder->CreateSub(subject, llvm::ConstantInt::get(type, low, true), "dispatch_index");
+        if (size != std::uint64_t(type_max) - std::uint64_t(type_min) + 1) {
+            llvm::BasicBlock* dispatch_bb = llvm::BasicBlock::Create(*context, "match_dispatch", the_function);
+            builder->CreateCondBr(builder->CreateICmpULT(index, llvm::ConstantInt::get(type, size), "in_table"), dispatch_bb, default_bb);
+            builder->SetInsertPoint(dispatch_bb);
+        }
+        index = builder->CreateZExt(index, builder->getInt64Ty());
+        llvm::Value* slot = builder->CreateInBoundsGEP(table_type, table, {builder->getInt64(0), index}, "dispatch_slot");
+        llvm::Value* target = builder->CreateLoad(builder->getPtrTy(), slot, "dispatch_target");
+        llvm::IndirectBrInst* branch = builder->CreateIndirectBr(target, arm_blocks.size() + 1);
+        std::set<llvm::BasicBlock*> destinations(arm_blocks.begin(), arm_blocks.end());
+        destinations.insert(default_bb);
+        for (llvm::BasicBlock* destination : destinations) branch->addDestination(destination);
+    } else {
+        // Wide ranges are tested one after another on the switch's default path.
+        std::vector<const Case*> wide;
+        for (const Case& c : cases) {
+            if (c.span() >= max_range_cases) wide.push_back(&c);
+        }
+        llvm::BasicBlock* ranges_bb = wide.empty() ? default_bb : llvm::BasicBlock::Create(*context, "match_ranges", the_function);
+        llvm::SwitchInst* switch_inst = builder->CreateSwitch(subject, ranges_bb);
+        for (const Case& c : cases) {
+            if (c.span() >= max_range_cases) continue;
+            for (std::uint64_t k = 0; k <= c.span(); ++k) switch_inst->addCase(llvm::ConstantInt::get(type, std::uint64_t(c.low) + k), arm_blocks[c.arm]);
+        }
+        for (const Case* c : wide) {
+            builder->SetInsertPoint(ranges_bb);
+            llvm::Value* offset = builder->CreateSub(subject, llvm::ConstantInt::get(type, c->low, true));
+            llvm::Value* in_range = builder->CreateICmpULE(offset, llvm::ConstantInt::get(type, c->span()), "in_range");
+            ranges_bb = c == wide.back() ? default_bb : llvm::BasicBlock::Create(*context, "match_ranges", the_function);
+            builder->CreateCondBr(in_range, arm_blocks[c->arm], ranges_bb);
+        }
+    }
+
+    // As for if, the arms yield the value of a final expression statement.
+    struct ArmResult {
+        llvm::Value* value;
+        llvm::BasicBlock* block;
+        const Expression* expression;
+    };
+    std::vector<ArmResult> incoming; // Arms that reach the merge block
+    for (size_t i = 0; i < match_expr.arms.size(); ++i) {
+        the_function->insert(the_function->end(), arm_blocks[i]);
+        builder->SetInsertPoint(arm_blocks[i]);
+        const auto& statements = match_expr.arms[i].body->statements;
+        llvm::Value* value = nullptr;
+        const Expression* expression = nullptr;
+        for (size_t s = 0; s < statements.size(); ++s) {
+            auto const* last = s + 1 == statements.size() ? dynamic_cast<const ExpressionStatement*>(statements[s].get()) : nullptr;
+            if (last) { expression = last->expression.get(); value = generate_expression(*expression); }
+            else generate_statement(*statements[s]);
+        }
+        if (builder->GetInsertBlock()->getTerminator()) continue;
+        builder->CreateBr(merge_bb);
+        incoming.push_back({value, builder->GetInsertBlock(), expression});
+    }
+    the_function->insert(the_function->end(), merge_bb);
+    builder->SetInsertPoint(merge_bb);
+    auto type_name = [](llvm::Type* type) {
+        if (type->isIntegerTy() || llvm::isa<llvm::StructType>(type)) return type_argument_name(type);
+        std::string name;
+        llvm::raw_string_ostream stream(name);
+        type->print(stream);
+        return stream.str();
+    };
+    llvm::Type* phi_type = nullptr;
+    for (const auto& arm : incoming) {
+        if (!arm.value) continue;
+        if (phi_type && arm.value->getType() != phi_type) {
+            if (!value_used) return builder->getInt32(0);
+            report_error(*arm.expression, "match arms have different types (" + type_name(phi_type) + " and " + type_name(arm.value->getType()) + ")");
+            return nullptr;
+        }
+        phi_type = arm.value->getType();
+    }
+    if (!phi_type) return builder->getInt32(0);
+    llvm::PHINode* phi = builder->CreatePHI(phi_type, static_cast<unsigned>(incoming.size()), "matchtmp");
+    for (const auto& arm : incoming) phi->addIncoming(arm.value ? arm.value : llvm::Constant::getNullValue(phi_type), arm.block);
+    return phi;
+}
+
+// Memory orderings are written as bare names in the ordering arguments of
+// the atomic builtins.
+static bool atomic_ordering(const Expression& expr, llvm::AtomicOrdering& ordering) {
+    static const std::pair<Symbol, llvm::AtomicOrdering> names[] = {
+        {intern("relaxed"), llvm::AtomicOrdering::Monotonic},
+        {intern("acquire"), llvm::AtomicOrdering::Acquire},
+        {intern("release"), llvm::AtomicOrdering::Release},
+        {intern("acq_rel"), llvm::AtomicOrdering::AcquireRelease},
+        {intern("seq_cst"), llvm::AtomicOrdering::SequentiallyConsistent},
+    };
+    auto const* ident = dynamic_cast<const Identifier*>(&expr);
+    if (!ident) return false;
+    for (const auto& name : names) {
+        if (name.first == ident->symbol) { ordering = name.second; return true; }
+    }
+    return false;
+}
+
+// Lowers the atomic builtins. p points to an i32 or i64, the last
+// arguments are orderings (relaxed, acquire, release, acq_rel, seq_cst):
+//   @atomic_load(p, order)                   value of *p
+//   @atomic_store(p, v, order)               0
+//   @fetch_add(p, v, order), @fetch_sub, @fetch_and, @fetch_or,
+//   @fetch_xor, @exchange                    previous value of *p
+//   @compare_exchange(p, expected, desired, success, failure)
+//   @compare_exchange_weak(...)              true if *p held expected and
+//                                            was replaced; the weak form may
+//                                            fail spuriously
+//   @fence(order)                            0
+// Orderings the operation cannot have (a release load, an acquire store, a
+// relaxed fence, a failure ordering with release) are reported as errors.
+llvm::Value* CodeGenerator::generate_atomic_builtin(const BuiltinCall& builtin) {
+    const BuiltinInfo* info = find_builtin(builtin.name);
+    const Builtin kind = info->kind;
+    const std::string name = std::string("@") + info->name;
+    const auto& args = builtin.arguments;
+    const bool is_compare_exchange = kind == Builtin::CompareExchange || kind == Builtin::CompareExchangeWeak;
+    const Expression& order = *args[is_compare_exchange ? 3 : args.size() - 1];
+    llvm::AtomicOrdering ordering;
+    if (!atomic_ordering(order, ordering)) {
+        report_error(order, name + ": " + order.to_string() + " is not a memory ordering (relaxed, acquire, release, acq_rel or seq_cst)");
+        return nullptr;
+    }
+    if (kind == Builtin::Fence) {
+        if (ordering == llvm::AtomicOrdering::Monotonic) {
+            report_error(builtin, "@fence cannot be relaxed");
+            return nullptr;
+        }
+        builder->CreateFence(ordering);
+        return builder->getInt32(0);
+    }
+
+    llvm::Value* pointer = generate_expression(*args[0]);
+    if (!pointer) return nullptr;
+    llvm::Type* type = element_type(*args[0]);
+    if (!pointer->getType()->isPointerTy() || !type || !(type->isIntegerTy(32) || type->isIntegerTy(64))) {
+        report_error(*args[0], name + " needs a pointer to an i32 or i64");
+        return nullptr;
+    }
+    // Natural alignment, as an underaligned atomic becomes a libcall. The
+    // host's data layout already has it; LLVM's default layout, which a module
+    // keeps if the host target is unavailable, gives i64 only 4 bytes.
+    llvm::Align align(module->getDataLayout().getTypeStoreSize(type));
+    if (kind == Builtin::AtomicLoad) {
+        if (ordering == llvm::AtomicOrdering::Release || ordering == llvm::AtomicOrdering::AcquireRelease) {
+            report_error(order, "@atomic_load cannot have " + order.to_string() + " ordering");
+            return nullptr;
+        }
+        llvm::LoadInst* load = builder->CreateAlignedLoad(type, pointer, align, "atomic_load");
+        load->setAtomic(ordering);
+        return load;
+    }
+    llvm::Value* value = generate_expression(*args[1]);
+    if (!value) return nullptr;
+    if (value->getType() != type) {
+        report_error(*args[1], name + ": " + args[1]->to_string() + " is not a value of type " + type_argument_name(type));
+        return nullptr;
+    }
+    if (kind == Builtin::AtomicStore) {
+        if (ordering == llvm::AtomicOrdering::Acquire || ordering == llvm::AtomicOrdering::AcquireRelease) {
+            report_error(order, "@atomic_store cannot have " + order.to_string() + " ordering");
+            return nullptr;
+        }
+        llvm::StoreInst* store = builder->CreateAlignedStore(value, pointer, align);
+        store->setAtomic(ordering);
+        return builder->getInt32(0);
+    }
+    if (is_compare_exchange) {
+        llvm::Value* desired = generate_expression(*args[2]);
+        if (!desired) return nullptr;
+        if (desired->getType() != type) {
+            report_error(*args[2], name + ": " + args[2]->to_string() + " is not a value of type " + type_argument_name(type));
+            return nullptr;
+        }
+        llvm::AtomicOrdering failure;
+        if (!atomic_ordering(*args[4], failure)) {
+            report_error(*args[4], name + ": " + args[4]->to_string() + " is not a memory ordering (relaxed, acquire, release, acq_rel or seq_cst)");
+            return nullptr;
+        }
+        if (failure == llvm::AtomicOrdering::Release || failure == llvm::AtomicOrdering::AcquireRelease) {
+            report_error(*args[4], name + ": the failure ordering cannot be " + args[4]->to_string() + ", a failed exchange does not store");
+            return nullptr;
+        }
+        llvm::AtomicCmpXchgInst* cmpxchg = builder->CreateAtomicCmpXchg(pointer, value, desired, align, ordering, failure);
+        cmpxchg->setWeak(kind == Builtin::CompareExchangeWeak);
+        return builder->CreateExtractValue(cmpxchg, 1, "cas_ok");
+    }
+    llvm::AtomicRMWInst::BinOp op = llvm::AtomicRMWInst::Xchg;
+    switch (kind) {
+        case Builtin::FetchAdd: op = llvm::AtomicRMWInst::Add; break;
+        case Builtin::FetchSub: op = llvm::AtomicRMWInst::Sub; break;
+        case Builtin::FetchAnd: op = llvm::AtomicRMWInst::And; break;
+        case Builtin::FetchOr: op = llvm::AtomicRMWInst::Or; break;
+        case Builtin::FetchXor: op = llvm::AtomicRMWInst::Xor; break;
+        default: break;
+    }
+    return builder->CreateAtomicRMW(op, pointer, value, align, ordering);
+}
+
+// Declares a function of runtime/manit_async.cpp.
+static llvm::FunctionCallee async_runtime(llvm::Module& module, const char* name, llvm::Type* result, llvm::ArrayRef<llvm::Type*> params) {
+    return module.getOrInsertFunction(name, llvm::FunctionType::get(result, params, false));
+}
+
+// Turns the function being generated into a switched-resume coroutine that
+// starts running when called (until its first suspension) and returns its
+// handle. The frame comes from __manit_frame_alloc unless CoroElide moves it
+// into the caller, which llvm.coro.alloc then reports. Generated code after
+// this call is the task's body; end_coroutine() adds the final suspension.
+void CodeGenerator::begin_coroutine(llvm::Function* function, CoroutineState& state) {
+    function->addFnAttr(llvm::Attribute::PresplitCoroutine);
+    llvm::Type* ptr_type = builder->getPtrTy();
+    llvm::Constant* null_ptr = llvm::ConstantPointerNull::get(llvm::PointerType::get(*context, 0));
+    llvm::AllocaInst* promise = create_entry_block_alloca(function, "promise", promise_type);
+    unsigned promise_align = module->getDataLayout().getABITypeAlign(promise_type).value();
+    state.id = builder->CreateIntrinsic(llvm::Intrinsic::coro_id, {}, {builder->getInt32(promise_align), promise, null_ptr, null_ptr}, nullptr, "coro.id");
+    llvm::Value* needs_frame = builder->CreateIntrinsic(llvm::Intrinsic::coro_alloc, {}, {state.id}, nullptr, "coro.alloc");
+    llvm::BasicBlock* entry_bb = builder->GetInsertBlock();
+    llvm::BasicBlock* alloc_bb = llvm::BasicBlock::Create(*context, "coro.frame_alloc", function);
+    llvm::BasicBlock* begin_bb = llvm::BasicBlock::Create(*context, "coro.begin", function);
+    builder->CreateCondBr(needs_frame, alloc_bb, begin_bb);
+    builder->SetInsertPoint(alloc_bb);
+    llvm::Value* size = builder->CreateIntrinsic(llvm::Intrinsic::coro_size, {builder->getInt64Ty()}, {}, nullptr, "coro.size");
+    llvm::Value* memory = builder->CreateCall(async_runtime(*module, "__manit_frame_alloc", ptr_type, {builder->getInt64Ty()}), {size}, "frame.mem");
+    builder->CreateBr(begin_bb);
+    builder->SetInsertPoint(begin_bb);
+    llvm::PHINode* frame = builder->CreatePHI(ptr_type, 2, "frame");
+    frame->addIncoming(null_ptr, entry_bb);
+    frame->addIncoming(memory, alloc_bb);
+    state.handle = builder->CreateIntrinsic(llvm::Intrinsic::coro_begin, {}, {state.id, frame}, nullptr, "task");
+    // The promise is read by other tasks and the event loop through the
+    // handle, so it is also written through the handle: as far as LLVM knows
+    // the alloca itself is dead once the task suspends for the last time.
+    state.promise = task_promise(state.handle);
+    builder->CreateStore(llvm::Constant::getNullValue(promise_type), state.promise);
+    state.final_block = llvm::BasicBlock::Create(*context, "coro.final");
+    state.cleanup_block = llvm::BasicBlock::Create(*context, "coro.cleanup");
+    state.suspend_block = llvm::BasicBlock::Create(*context, "coro.suspend");
+    coroutine = &state;
+}
+
+// Completes the coroutine begun by begin_coroutine(). On completion the task
+// marks itself done, schedules the task awaiting it and suspends for the
+// last time; the frame is freed when the awaiting task (or, for a detached
+// task, the event loop) destroys it.
+void CodeGenerator::end_coroutine() {
+    CoroutineState& state = *coroutine;
+    llvm::Function* function = builder->GetInsertBlock()->getParent();
+    llvm::Type* ptr_type = builder->getPtrTy();
+
+    function->insert(function->end(), state.final_block);
+    builder->SetInsertPoint(state.final_block);
+    llvm::Value* state_ptr = builder->CreateStructGEP(promise_type, state.promise, 1, "state.addr");
+    llvm::Value* previous = builder->CreateLoad(builder->getInt32Ty(), state_ptr, "state");
+    builder->CreateStore(builder->getInt32(1), state_ptr);
+    llvm::Value* waiter = builder->CreateLoad(ptr_type, builder->CreateStructGEP(promise_type, state.promise, 2, "waiter.addr"), "waiter");
+    llvm::BasicBlock* wake_bb = llvm::BasicBlock::Create(*context, "coro.wake", function);
+    llvm::BasicBlock* woken_bb = llvm::BasicBlock::Create(*context, "coro.woken", function);
+    builder->CreateCondBr(builder->CreateIsNotNull(waiter), wake_bb, woken_bb);
+    builder->SetInsertPoint(wake_bb);
+    builder->CreateCall(async_runtime(*module, "__manit_schedule", builder->getVoidTy(), {ptr_type}), {waiter});
+    builder->CreateBr(woken_bb);
+    builder->SetInsertPoint(woken_bb);
+    llvm::BasicBlock* reap_bb = llvm::BasicBlock::Create(*context, "coro.reap", function);
+    llvm::BasicBlock* final_suspend_bb = llvm::BasicBlock::Create(*context, "coro.final_suspend", function);
+    builder->CreateCondBr(builder->CreateICmpEQ(previous, builder->getInt32(2), "detached"), reap_bb, final_suspend_bb);
+    builder->SetInsertPoint(reap_bb);
+    builder->CreateCall(async_runtime(*module, "__manit_destroy_later", builder->getVoidTy(), {ptr_type}), {state.handle});
+    builder->CreateBr(final_suspend_bb);
+    builder->SetInsertPoint(final_suspend_bb);
+    llvm::Value* suspended = builder->CreateIntrinsic(llvm::Intrinsic::coro_suspend, {}, {llvm::ConstantTokenNone::get(*context), builder->getTrue()}, nullptr, "final");
+    llvm::BasicBlock* resumed_bb = llvm::BasicBlock::Create(*context, "coro.resumed_after_final", function);
+    llvm::SwitchInst* dispatch = builder->CreateSwitch(suspended, state.suspend_block, 2);
+    dispatch->addCase(builder->getInt8(0), resumed_bb);
+    dispatch->addCase(builder->getInt8(1), state.cleanup_block);
+    builder->SetInsertPoint(resumed_bb);
+    builder->CreateUnreachable();
+
+    function->insert(function->end(), state.cleanup_block);
+    builder->SetInsertPoint(state.cleanup_block);
+    llvm::Value* memory = builder->CreateIntrinsic(llvm::Intrinsic::coro_free, {}, {state.id, state.handle}, nullptr, "frame.mem");
+    llvm::BasicBlock* free_bb = llvm::BasicBlock::Create(*context, "coro.frame_free", function);
+    builder->CreateCondBr(builder->CreateIsNotNull(memory), free_bb, state.suspend_block);
+    builder->SetInsertPoint(free_bb);
+    builder->CreateCall(async_runtime(*module, "__manit_frame_free", builder->getVoidTy(), {ptr_type}), {memory});
+    builder->CreateBr(state.suspend_block);
+
+    function->insert(function->end(), state.suspend_block);
+    builder->SetInsertPoint(state.suspend_block);
+    builder->CreateIntrinsic(llvm::Intrinsic::coro_end, {}, {state.handle, builder->getFalse(), llvm::ConstantTokenNone::get(*context)});
+    builder->CreateRet(state.handle);
+}
+
+// Suspends the current task. Code generated next runs when it is resumed.
+void CodeGenerator::suspend_coroutine() {
+    llvm::Function* function = builder->GetInsertBlock()->getParent();
+    llvm::Value* suspended = builder->CreateIntrinsic(llvm::Intrinsic::coro_suspend, {}, {llvm::ConstantTokenNone::get(*context), builder->getFalse()}, nullptr, "suspend");
+    llvm::BasicBlock* resume_bb = llvm::BasicBlock::Create(*context, "resume", function);
+    llvm::SwitchInst* dispatch = builder->CreateSwitch(suspended, coroutine->suspend_block, 2);
+    dispatch->addCase(builder->getInt8(0), resume_bb);
+    dispatch->addCase(builder->getInt8(1), coroutine->cleanup_block);
+    builder->SetInsertPoint(resume_bb);
+}
+
+llvm::Value* CodeGenerator::task_promise(llvm::Value* task) {
+    unsigned promise_align = module->getDataLayout().getABITypeAlign(promise_type).value();
+    return builder->CreateIntrinsic(llvm::Intrinsic::coro_promise, {}, {task, builder->getInt32(promise_align), builder->getFalse()}, nullptr, "promise");
+}
+
+// `await task`: waits (suspending unless the task is already done), takes
+// the result and destroys the task.
+llvm::Value* CodeGenerator::generate_await(const AwaitExpression& await_expr) {
+    if (!coroutine) return nullptr;
+    llvm::Value* task = generate_expression(*await_expr.task);
+    if (!task || !task->getType()->isPointerTy()) return nullptr;
+    llvm::Function* function = builder->GetInsertBlock()->getParent();
+    llvm::Value* promise = task_promise(task);
+    llvm::Value* state = builder->CreateLoad(builder->getInt32Ty(), builder->CreateStructGEP(promise_type, promise, 1, "state.addr"), "state");
+    llvm::BasicBlock* wait_bb = llvm::BasicBlock::Create(*context, "await.wait", function);
+    llvm::BasicBlock* ready_bb = llvm::BasicBlock::Create(*context, "await.ready", function);
+    builder->CreateCondBr(builder->CreateICmpEQ(state, builder->getInt32(1), "done"), ready_bb, wait_bb);
+    builder->SetInsertPoint(wait_bb);
+    builder->CreateStore(coroutine->handle, builder->CreateStructGEP(promise_type, promise, 2, "waiter.addr"));
+    suspend_coroutine();
+    builder->CreateBr(ready_bb);
+    builder->SetInsertPoint(ready_bb);
+    llvm::Value* result = builder->CreateLoad(builder->getInt32Ty(), builder->CreateStructGEP(promise_type, promise, 0, "result.addr"), "await");
+    builder->CreateIntrinsic(llvm::Intrinsic::coro_destroy, {}, {task});
+    return result;
+}
+
+// Lowers the task builtins (runtime/manit_async.cpp runs the event loop):
+//   @sleep(ms)          in an async function: resume after ms milliseconds
+//   @wait_readable(fd)  in an async function: resume once fd is readable
+//   @spawn(task)        let task run to completion unawaited
+//   @block_on(task)     run the event loop until task is done; its result
+//   @run()              run the event loop until no work is left
+// All but @block_on produce 0.
+llvm::Value* CodeGenerator::generate_task_builtin(const BuiltinCall& builtin) {
+    const Builtin kind = find_builtin(builtin.name)->kind;
+    llvm::Type* ptr_type = builder->getPtrTy();
+    if (kind == Builtin::Run) {
+        builder->CreateCall(async_runtime(*module, "__manit_run_until", builder->getVoidTy(), {ptr_type}), {llvm::ConstantPointerNull::get(llvm::PointerType::get(*context, 0))});
+        return builder->getInt32(0);
+    }
+    llvm::Value* operand = generate_expression(*builtin.arguments[0]);
+    if (!operand) return nullptr;
+    if (kind == Builtin::Sleep || kind == Builtin::WaitReadable) {
+        if (!coroutine || !operand->getType()->isIntegerTy(32)) return nullptr;
+        const char* hook = kind == Builtin::Sleep ? "__manit_sleep" : "__manit_wait_readable";
+        builder->CreateCall(async_runtime(*module, hook, builder->getVoidTy(), {ptr_type, builder->getInt32Ty()}), {coroutine->handle, operand});
+        suspend_coroutine();
+        return builder->getInt32(0);
+    }
+    if (!operand->getType()->isPointerTy()) return nullptr;
+    llvm::Value* promise = task_promise(operand);
+    llvm::Value* state_ptr = builder->CreateStructGEP(promise_type, promise, 1, "state.addr");
+    if (kind == Builtin::BlockOn) {
+        builder->CreateCall(async_runtime(*module, "__manit_run_until", builder->getVoidTy(), {ptr_type}), {state_ptr});
+        llvm::Value* result = builder->CreateLoad(builder->getInt32Ty(), builder->CreateStructGEP(promise_type, promise, 0, "result.addr"), "result");
+        builder->CreateIntrinsic(llvm::Intrinsic::coro_destroy, {}, {operand});
+        return result;
+    }
+    // @spawn: a finished task is destroyed now; otherwise it is marked
+    // detached (state 2) and destroys itself on completion.
+    llvm::Function* function = builder->GetInsertBlock()->getParent();
+    llvm::BasicBlock* done_bb = llvm::BasicBlock::Create(*context, "spawn.done", function);
+    llvm::BasicBlock* detach_bb = llvm::BasicBlock::Create(*context, "spawn.detach", function);
+    llvm::BasicBlock* merge_bb = llvm::BasicBlock::Create(*context, "spawn.cont", function);
+    llvm::Value* state = builder->CreateLoad(builder->getInt32Ty(), state_ptr, "state");
+    builder->CreateCondBr(builder->CreateICmpEQ(state, builder->getInt32(1), "done"), done_bb, detach_bb);
+    builder->SetInsertPoint(done_bb);
+    builder->CreateIntrinsic(llvm::Intrinsic::coro_destroy, {}, {operand});
+    builder->CreateBr(merge_bb);
+    builder->SetInsertPoint(detach_bb);
+    builder->CreateStore(builder->getInt32(2), state_ptr);
+    builder->CreateBr(merge_bb);
+    builder->SetInsertPoint(merge_bb);
+    return builder->getInt32(0);
+}
+
+void CodeGenerator::set_source(const std::string& path, const std::string& text) {
+    source_path = path;
+    source_map = std::make_unique<SourceMap>(text);
+}
+
+void CodeGenerator::emit_location(const Node& node) {
+    if (!debug_scope) return;
+    SourceLocation loc = source_map->locate(node.source_offset());
+    llvm::DILocation* current = builder->getCurrentDebugLocation().get();
+    if (current && current->getLine() == loc.line && current->getColumn() == loc.column && current->getScope() == debug_scope) return;
+    builder->SetCurrentDebugLocation(llvm::DILocation::get(*context, loc.line, loc.column, debug_scope));
+}
+
+llvm::DIType* CodeGenerator::debug_type(llvm::Type* type) {
+    if (type->isIntegerTy(1)) return debug_builder->createBasicType("bool", 8, llvm::dwarf::DW_ATE_boolean);
+    if (type->isIntegerTy(32)) return debug_builder->createBasicType("i32", 32, llvm::dwarf::DW_ATE_signed);
+    if (auto* array_type = llvm::dyn_cast<llvm::ArrayType>(type)) {
+        llvm::DIType* element = debug_type(array_type->getElementType());
+        if (!element) return nullptr;
+        uint64_t count = array_type->getNumElements();
+        llvm::Metadata* subscript = debug_builder->getOrCreateSubrange(0, static_cast<int64_t>(count));
+        return debug_builder->createArrayType(count * element->getSizeInBits(), 0, element, debug_builder->getOrCreateArray(subscript));
+    }
+    return nullptr;
+}
+
+// Attaches a subprogram to function and makes it the current debug scope.
+// Returns null (and leaves no scope) when debug info is off.
+llvm::DISubprogram* CodeGenerator::begin_debug_function(llvm::Function* function, const Node& node) {
+    debug_scope = nullptr;
+    builder->SetCurrentDebugLocation(llvm::DebugLoc());
+    if (!debug_builder) return nullptr;
+
+    // Line tables only need a subprogram per function, not its signature.
+    std::vector<llvm::Metadata*> signature;
+    if (options.debug_info == DebugInfoLevel::Full) {
+        signature.push_back(debug_type(function->getReturnType()));
+        for (auto& arg : function->args()) signature.push_back(debug_type(arg.getType()));
+    }
+    llvm::DISubroutineType* type = debug_builder->createSubroutineType(debug_builder->getOrCreateTypeArray(signature));
+    unsigned line = source_map->locate(node.source_offset()).line;
+    auto flags = llvm::DISubprogram::SPFlagDefinition;
+    if (function->hasLocalLinkage()) flags |= llvm::DISubprogram::SPFlagLocalToUnit;
+    if (options.opt_level > 0) flags |= llvm::DISubprogram::SPFlagOptimized;
+    llvm::DISubprogram* subprogram = debug_builder->createFunction(debug_file, function->getName(), function->getName(),
+                                                                   debug_file, line, type, line, llvm::DINode::FlagPrototyped, flags);
+    function->setSubprogram(subprogram);
+    debug_scope = subprogram;
+    emit_location(node);
+    return subprogram;
+}
+
+void CodeGenerator::declare_debug_variable(llvm::AllocaInst* alloca, const std::string& name, const Node& node, unsigned arg_no) {
+    if (!debug_scope || options.debug_info != DebugInfoLevel::Full) return;
+    llvm::DIType* type = debug_type(alloca->getAllocatedType());
+    if (!type) return;
+    unsigned line = source_map->locate(node.source_offset()).line;
+    llvm::DILocalVariable* variable = arg_no
+        ? debug_builder->createParameterVariable(debug_scope, name, arg_no, debug_file, line, type)
+        : debug_builder->createAutoVariable(debug_scope, name, debug_file, line, type);
+    debug_builder->insertDeclare(alloca, variable, debug_builder->createExpression(),
+                                 builder->getCurrentDebugLocation().get(), builder->GetInsertBlock());
+}
+
+llvm::Value* CodeGenerator::generate_element_pointer(const IndexExpression& index_expr, llvm::Type** element_type) {
+    llvm::Value* array_ptr = generate_expression(*index_expr.left);
+    if (!array_ptr) return nullptr;
+    llvm::Value* index_val = generate_expression(*index_expr.index);
+    if (!index_val) return nullptr;
+
+    // Slices and pointers index from their data pointer, like C arrays.
+    bool indirect = (slice_type && array_ptr->getType() == slice_type) || (array_ptr->getType()->isPointerTy() && !array_storage(array_ptr));
+    if (indirect) {
+        *element_type = this->element_type(*index_expr.left);
+        if (!*element_type || !index_val->getType()->isIntegerTy(32)) return nullptr;
+        llvm::Value* data = array_ptr->getType()->isPointerTy() ? array_ptr : builder->CreateExtractValue(array_ptr, 0, "slice_data");
+        return builder->CreateInBoundsGEP(*element_type, data, builder->CreateSExt(index_val, builder->getInt64Ty()), "element_ptr");
+    }
+    llvm::ArrayType* array_type = array_storage(array_ptr);
+    if (!array_type) return nullptr;
+    std::vector<llvm::Value*> indices = { builder->getInt32(0), index_val };
+    *element_type = array_type->getElementType();
+    return builder->CreateGEP(array_type, array_ptr, indices, "element_ptr");
+}
+
 void CodeGenerator::generate_statement(const Statement& stmt) {
+    emit_location(stmt);
     if (auto const* let_stmt = dynamic_cast<const LetStatement*>(&stmt)) {
+        // Top-level bindings with annotations are handled by generate().
+        for (const Annotation& annotation : let_stmt->annotations) report_error(stmt, annotation_to_string(annotation) + " only applies to a top-level let or var");
+        // Exported constants are folded here so every function (and importer) sees the same value.
+        std::string constant_type;
+        long long constant_value;
+        if (let_stmt->is_public && let_stmt->value && fold_constant(*let_stmt->value, constant_type, constant_value)) {
+            constants[let_stmt->name->symbol] = llvm::ConstantInt::get(type_from_name(intern(constant_type)), constant_value, true);
+            return;
+        }
+        // Generic functions are generated per instantiation, from their call sites.
+        auto const* func_lit = dynamic_cast<const FunctionLiteral*>(let_stmt->value.get());
+        if (func_lit && !func_lit->type_parameters.empty()) {
+            generic_functions[let_stmt->name->symbol] = func_lit;
+            return;
+        }
+        // A let-bound function is created under its binding name so its body can call itself.
+        if (dynamic_cast<const FunctionLiteral*>(let_stmt->value.get())) {
+            pending_function = let_stmt->name->symbol;
+        }
+        // Struct literals and struct-returning calls are built in the variable itself.
+        if (llvm::StructType* struct_type = struct_result_type(*let_stmt->value)) {
+            llvm::AllocaInst* alloca = create_entry_block_alloca(builder->GetInsertBlock()->getParent(), let_stmt->name->name(), struct_type);
+            if (!generate_into(*let_stmt->value, alloca)) return;
+            bind_variable(let_stmt->name->symbol, alloca);
+            declare_debug_variable(alloca, let_stmt->name->name(), *let_stmt);
+            return;
+        }
         llvm::Value* val = generate_expression(*let_stmt->value);
         if (!val) return;
         
         // --- BUG FIX: Corrected control flow from if/if/else to if/else if/else ---
         if (auto* func = llvm::dyn_cast<llvm::Function>(val)) {
-            func->setName(let_stmt->name->value);
+            func->setName(let_stmt->name->name());
+            if (let_stmt->is_public) func->setLinkage(llvm::Function::ExternalLinkage);
         }
-        else if (auto* alloca = llvm::dyn_cast<llvm::AllocaInst>(val)) {
-            alloca->setName(let_stmt->name->value);
-            named_values[let_stmt->name->value] = alloca;
+        else if (array_storage(val)) {
+            bind_array(*let_stmt->name, val, *let_stmt->value, *let_stmt);
         } else {
             llvm::Function* the_function = builder->GetInsertBlock()->getParent();
-            llvm::AllocaInst* scalar_alloca = create_entry_block_alloca(the_function, let_stmt->name->value, val->getType());
+            llvm::AllocaInst* scalar_alloca = create_entry_block_alloca(the_function, let_stmt->name->name(), val->getType());
             builder->CreateStore(val, scalar_alloca);
-            named_values[let_stmt->name->value] = scalar_alloca;
+            if (llvm::Type* element = element_type(*let_stmt->value)) element_types[scalar_alloca] = element;
+            bind_variable(let_stmt->name->symbol, scalar_alloca);
+            declare_debug_variable(scalar_alloca, let_stmt->name->name(), *let_stmt);
         }
     }
     else if (auto const* var_stmt = dynamic_cast<const VarStatement*>(&stmt)) {
+        for (const Annotation& annotation : var_stmt->annotations) report_error(stmt, annotation_to_string(annotation) + " only applies to a top-level let or var");
+        if (llvm::StructType* struct_type = struct_result_type(*var_stmt->value)) {
+            llvm::AllocaInst* alloca = create_entry_block_alloca(builder->GetInsertBlock()->getParent(), var_stmt->name->name(), struct_type);
+            if (!generate_into(*var_stmt->value, alloca)) return;
+            bind_variable(var_stmt->name->symbol, alloca);
+            declare_debug_variable(alloca, var_stmt->name->name(), *var_stmt);
+            return;
+        }
         llvm::Value* val = generate_expression(*var_stmt->value);
         if (!val) return;
+        if (array_storage(val)) {
+            bind_array(*var_stmt->name, val, *var_stmt->value, *var_stmt);
+            return;
+        }
         llvm::Function* the_function = builder->GetInsertBlock()->getParent();
-        llvm::AllocaInst* alloca = create_entry_block_alloca(the_function, var_stmt->name->value, val->getType());
+        llvm::AllocaInst* alloca = create_entry_block_alloca(the_function, var_stmt->name->name(), val->getType());
         builder->CreateStore(val, alloca);
-        named_values[var_stmt->name->value] = alloca;
+        if (llvm::Type* element = element_type(*var_stmt->value)) element_types[alloca] = element;
+        bind_variable(var_stmt->name->symbol, alloca);
+        declare_debug_variable(alloca, var_stmt->name->name(), *var_stmt);
     }
     else if (auto const* struct_def_stmt = dynamic_cast<const StructDefinitionStatement*>(&stmt)) {
-        const std::string& struct_name = struct_def_stmt->name->value;
-        if (struct_types.count(struct_name)) { return; }
-        llvm::StructType* struct_type = llvm::StructType::create(*context, struct_name);
+        Symbol struct_name = struct_def_stmt->name->symbol;
+        if (struct_types.lookup(struct_name)) { return; }
+        llvm::StructType* struct_type = llvm::StructType::create(*context, symbol_name(struct_name));
         struct_types[struct_name] = struct_type;
-        std::vector<llvm::Type*> field_types;
+        std::vector<std::pair<Symbol, llvm::Type*>> fields;
         for (const auto& field : struct_def_stmt->fields) {
-            if (field.type->value == "i32") {
-                field_types.push_back(builder->getInt32Ty());
+            if (llvm::Type* field_type = type_from_name(field.type->symbol)) {
+                fields.emplace_back(field.name->symbol, field_type);
             }
         }
-        struct_type->setBody(field_types);
+        define_struct(struct_type, fields);
     }
     else if (auto const* return_stmt = dynamic_cast<const ReturnStatement*>(&stmt)) {
-        if (return_stmt->return_value) {
-            llvm::Value* return_val = generate_expression(*return_stmt->return_value);
-            if (return_val) builder->CreateRet(return_val);
-        } else {
-            builder->CreateRetVoid();
-        }
+        generate_return(return_stmt->return_value.get());
     }
     else if (auto const* expr_stmt = dynamic_cast<const ExpressionStatement*>(&stmt)) {
-        generate_expression(*expr_stmt->expression);
+        if (auto const* match_expr = dynamic_cast<const MatchExpression*>(expr_stmt->expression.get())) generate_match(*match_expr, false);
+        else generate_expression(*expr_stmt->expression);
     }
 }
 
+// The i32 constant of a literal, negated if negate; nullptr, with an error,
+// if it does not fit (2147483648 only fits negated).
+llvm::Value* CodeGenerator::integer_literal(const IntegerLiteral& int_lit, bool negate) {
+    long long value = negate ? -int_lit.value : int_lit.value;
+    if (value > INT32_MAX || value < INT32_MIN) {
+        report_error(int_lit, "integer literal " + int_lit.token.literal + " does not fit in i32");
+        return nullptr;
+    }
+    return builder->getInt32(static_cast<std::uint32_t>(value));
+}
+
 llvm::Value* CodeGenerator::generate_expression(const Expression& expr) {
-    if (auto const* int_lit = dynamic_cast<const IntegerLiteral*>(&expr)) { return builder->getInt32(int_lit->value); }
+    // Line tables stay at statement granularity; full debug info also marks subexpressions.
+    if (options.debug_info == DebugInfoLevel::Full) emit_location(expr);
+    if (auto const* int_lit = dynamic_cast<const IntegerLiteral*>(&expr)) { return integer_literal(*int_lit, false); }
     else if (auto const* bool_lit = dynamic_cast<const BooleanLiteral*>(&expr)) { return builder->getInt1(bool_lit->value); }
     else if (auto const* array_lit = dynamic_cast<const ArrayLiteral*>(&expr)) {
         llvm::Function* the_function = builder->GetInsertBlock()->getParent();
@@ -91,49 +1867,122 @@ llvm::Value* CodeGenerator::generate_expression(const Expression& expr) {
         }
         return alloca;
     }
+    else if (auto const* struct_lit = dynamic_cast<const StructLiteral*>(&expr)) {
+        llvm::StructType* struct_type = struct_types.lookup(struct_lit->type_name);
+        if (!struct_type) return nullptr;
+        llvm::Value* aggregate = llvm::Constant::getNullValue(struct_type);
+        for (const auto& field : struct_lit->fields) {
+            int index = field_index(struct_type, field.first->symbol);
+            llvm::Value* value = index < 0 ? nullptr : generate_expression(*field.second);
+            if (!value || value->getType() != struct_type->getElementType(index)) return nullptr;
+            aggregate = builder->CreateInsertValue(aggregate, value, static_cast<unsigned>(index));
+        }
+        return aggregate;
+    }
+    else if (auto const* member_expr = dynamic_cast<const MemberExpression*>(&expr)) {
+        llvm::Type* field_type = nullptr;
+        if (llvm::Value* field_ptr = member_pointer(*member_expr, &field_type)) return builder->CreateLoad(field_type, field_ptr, member_expr->field->name());
+        // A struct that is only a value, such as a call result.
+        llvm::Value* aggregate = generate_expression(*member_expr->left);
+        auto* struct_type = aggregate ? llvm::dyn_cast<llvm::StructType>(aggregate->getType()) : nullptr;
+        int index = struct_type ? field_index(struct_type, member_expr->field->symbol) : -1;
+        if (index < 0) return nullptr;
+        return builder->CreateExtractValue(aggregate, static_cast<unsigned>(index), member_expr->field->name());
+    }
     else if (auto const* index_expr = dynamic_cast<const IndexExpression*>(&expr)) {
-        llvm::Value* array_ptr = generate_expression(*index_expr->left);
-        if (!array_ptr) return nullptr;
-        llvm::Value* index_val = generate_expression(*index_expr->index);
-        if (!index_val) return nullptr;
-        
-        llvm::Type* array_type = llvm::cast<llvm::AllocaInst>(array_ptr)->getAllocatedType();
-        std::vector<llvm::Value*> indices = { builder->getInt32(0), index_val };
-        llvm::Value* element_ptr = builder->CreateGEP(array_type, array_ptr, indices, "element_ptr");
-        llvm::Type* element_type = llvm::cast<llvm::ArrayType>(array_type)->getElementType();
+        llvm::Type* element_type = nullptr;
+        llvm::Value* element_ptr = generate_element_pointer(*index_expr, &element_type);
+        if (!element_ptr) return nullptr;
         return builder->CreateLoad(element_type, element_ptr, "array_idx_val");
     }
     else if (auto const* ident = dynamic_cast<const Identifier*>(&expr)) {
-        if (named_values.count(ident->value)) {
-            llvm::AllocaInst* alloca = named_values[ident->value];
-            llvm::Type* var_type = alloca->getAllocatedType();
-            if (var_type->isArrayTy()) { return alloca; }
-            else { return builder->CreateLoad(var_type, alloca, ident->value.c_str()); }
+        if (llvm::Value* storage = lookup_variable(ident->symbol)) {
+            llvm::Type* var_type = storage_type(storage);
+            if (var_type->isArrayTy()) { return storage; }
+            // A top-level let of a scalar is its value, so it folds into later constants.
+            auto* global = llvm::dyn_cast<llvm::GlobalVariable>(storage);
+            if (global && global->isConstant() && !var_type->isAggregateType()) { return global->getInitializer(); }
+            else { return builder->CreateLoad(var_type, storage, ident->name()); }
         }
-        return nullptr;
+        return constants.lookup(ident->symbol);
     }
     else if (auto const* assign_expr = dynamic_cast<const AssignmentExpression*>(&expr)) {
         llvm::Value* new_val = generate_expression(*assign_expr->value);
         if (!new_val) return nullptr;
-        if (named_values.find(assign_expr->name->value) == named_values.end()) return nullptr;
-        llvm::AllocaInst* variable_alloca = named_values[assign_expr->name->value];
-        builder->CreateStore(new_val, variable_alloca);
+        if (auto const* index_target = dynamic_cast<const IndexExpression*>(assign_expr->target.get())) {
+            llvm::Type* element_type = nullptr;
+            llvm::Value* element_ptr = generate_element_pointer(*index_target, &element_type);
+            if (!element_ptr || element_type != new_val->getType()) return nullptr;
+            builder->CreateStore(new_val, element_ptr);
+            return new_val;
+        }
+        if (auto const* member_target = dynamic_cast<const MemberExpression*>(assign_expr->target.get())) {
+            llvm::Type* field_type = nullptr;
+            llvm::Value* field_ptr = member_pointer(*member_target, &field_type);
+            if (!field_ptr || field_type != new_val->getType()) return nullptr;
+            builder->CreateStore(new_val, field_ptr);
+            return new_val;
+        }
+        if (auto const* deref = dynamic_cast<const PrefixExpression*>(assign_expr->target.get())) {
+            llvm::Value* pointer = generate_expression(*deref->right);
+            if (!pointer || !pointer->getType()->isPointerTy() || element_type(*deref->right) != new_val->getType()) return nullptr;
+            builder->CreateStore(new_val, pointer);
+            return new_val;
+        }
+        auto const* name = dynamic_cast<const Identifier*>(assign_expr->target.get());
+        llvm::Value* storage = name ? lookup_variable(name->symbol) : nullptr;
+        if (!storage) return nullptr;
+        builder->CreateStore(new_val, storage);
         return new_val;
     }
+    else if (auto const* slice_expr = dynamic_cast<const SliceExpression*>(&expr)) {
+        llvm::Value* data; llvm::Value* length; llvm::Type* element_type;
+        if (!generate_slice_parts(*slice_expr->left, &data, &length, &element_type)) return nullptr;
+        llvm::Value* low = slice_expr->low ? generate_expression(*slice_expr->low) : builder->getInt32(0);
+        llvm::Value* high = slice_expr->high ? generate_expression(*slice_expr->high) : nullptr;
+        if (!low || !low->getType()->isIntegerTy(32) || (slice_expr->high && (!high || !high->getType()->isIntegerTy(32)))) return nullptr;
+        low = builder->CreateSExt(low, builder->getInt64Ty());
+        high = high ? builder->CreateSExt(high, builder->getInt64Ty()) : length;
+        return make_slice(builder->CreateInBoundsGEP(element_type, data, low, "slice_data"), builder->CreateSub(high, low, "slice_len"));
+    }
     else if (auto const* prefix_expr = dynamic_cast<const PrefixExpression*>(&expr)) {
+        if (prefix_expr->op == "&") {
+            if (auto const* index_target = dynamic_cast<const IndexExpression*>(prefix_expr->right.get())) {
+                llvm::Type* element_type = nullptr;
+                return generate_element_pointer(*index_target, &element_type);
+            }
+            if (auto const* member_target = dynamic_cast<const MemberExpression*>(prefix_expr->right.get())) {
+                llvm::Type* field_type = nullptr;
+                return member_pointer(*member_target, &field_type);
+            }
+            auto const* ident = dynamic_cast<const Identifier*>(prefix_expr->right.get());
+            llvm::Value* storage = ident ? lookup_variable(ident->symbol) : nullptr;
+            if (!storage) return nullptr;
+            // The address of an array is that of its first element, not the array itself.
+            if (storage_type(storage)->isArrayTy()) return builder->CreateConstInBoundsGEP2_32(storage_type(storage), storage, 0, 0, ident->name() + ".addr");
+            return storage;
+        }
+        // A negative literal is a constant of its own: -2147483648 is in range.
+        auto const* int_lit = dynamic_cast<const IntegerLiteral*>(prefix_expr->right.get());
+        if (prefix_expr->op == "-" && int_lit) { return integer_literal(*int_lit, true); }
         llvm::Value* right = generate_expression(*prefix_expr->right);
         if (!right) return nullptr;
-        if (prefix_expr->op == "-") { return builder->CreateNeg(right, "negtmp"); }
+        if (prefix_expr->op == "-") { return generate_arithmetic(*prefix_expr, llvm::Instruction::Sub, false, llvm::ConstantInt::get(right->getType(), 0), right); }
+        if (prefix_expr->op == "*") {
+            llvm::Type* pointee = right->getType()->isPointerTy() ? element_type(*prefix_expr->right) : nullptr;
+            return pointee ? builder->CreateLoad(pointee, right, "deref") : nullptr;
+        }
         return nullptr;
     }
     else if (auto const* infix_expr = dynamic_cast<const InfixExpression*>(&expr)) {
         llvm::Value* left = generate_expression(*infix_expr->left);
         llvm::Value* right = generate_expression(*infix_expr->right);
-        if (!left || !right) return nullptr;
-        if (infix_expr->op == "+") { return builder->CreateAdd(left, right, "addtmp"); }
-        else if (infix_expr->op == "-") { return builder->CreateSub(left, right, "subtmp"); }
-        else if (infix_expr->op == "*") { return builder->CreateMul(left, right, "multmp"); }
-        else if (infix_expr->op == "/") { return builder->CreateSDiv(left, right, "divtmp"); }
+        if (!left || !right || left->getType() != right->getType()) return nullptr;
+        const std::string& op = infix_expr->op;
+        if (op == "+" || op == "+%") { return generate_arithmetic(*infix_expr, llvm::Instruction::Add, op == "+%", left, right); }
+        else if (op == "-" || op == "-%") { return generate_arithmetic(*infix_expr, llvm::Instruction::Sub, op == "-%", left, right); }
+        else if (op == "*" || op == "*%") { return generate_arithmetic(*infix_expr, llvm::Instruction::Mul, op == "*%", left, right); }
+        else if (op == "/") { return generate_division(*infix_expr, left, right); }
         else if (infix_expr->op == "==") { return builder->CreateICmpEQ(left, right, "eqtmp"); }
         else if (infix_expr->op == "!=") { return builder->CreateICmpNE(left, right, "neqtmp"); }
         else if (infix_expr->op == "<") { return builder->CreateICmpSLT(left, right, "lttmp"); }
@@ -143,49 +1992,102 @@ llvm::Value* CodeGenerator::generate_expression(const Expression& expr) {
         return nullptr;
     }
     else if (auto const* if_expr = dynamic_cast<const IfExpression*>(&expr)) {
-        llvm::Value* cond_v = generate_expression(*if_expr->condition); if (!cond_v) return nullptr;
+        llvm::MDNode* weights; llvm::Value* cond_v = generate_condition(*if_expr->condition, &weights); if (!cond_v) return nullptr;
         llvm::Function* the_function = builder->GetInsertBlock()->getParent();
         llvm::BasicBlock* then_bb = llvm::BasicBlock::Create(*context, "then", the_function);
         llvm::BasicBlock* else_bb = llvm::BasicBlock::Create(*context, "else");
         llvm::BasicBlock* merge_bb = llvm::BasicBlock::Create(*context, "ifcont");
-        if (if_expr->alternative) { builder->CreateCondBr(cond_v, then_bb, else_bb); } else { builder->CreateCondBr(cond_v, then_bb, merge_bb); }
+        llvm::BasicBlock* cond_bb = builder->GetInsertBlock();
+        if (if_expr->alternative) { builder->CreateCondBr(cond_v, then_bb, else_bb, weights); } else { builder->CreateCondBr(cond_v, then_bb, merge_bb, weights); }
         builder->SetInsertPoint(then_bb);
         llvm::Value* then_val = nullptr;
         if (!if_expr->consequence->statements.empty()) { if (auto* last_stmt_as_expr = dynamic_cast<ExpressionStatement*>(if_expr->consequence->statements.back().get())) { for (size_t i = 0; i < if_expr->consequence->statements.size() - 1; ++i) generate_statement(*if_expr->consequence->statements[i]); then_val = generate_expression(*last_stmt_as_expr->expression); } else { for (const auto& stmt : if_expr->consequence->statements) generate_statement(*stmt); } }
-        if (!builder->GetInsertBlock()->getTerminator()) builder->CreateBr(merge_bb);
+        bool then_reaches_merge = !builder->GetInsertBlock()->getTerminator();
+        if (then_reaches_merge) builder->CreateBr(merge_bb);
         llvm::BasicBlock* then_end_bb = builder->GetInsertBlock();
         llvm::Value* else_val = nullptr;
-        llvm::BasicBlock* else_end_bb = else_bb;
+        // Without an else branch the condition block itself flows into the merge.
+        llvm::BasicBlock* else_end_bb = cond_bb;
+        bool else_reaches_merge = true;
         if (if_expr->alternative) {
             the_function->insert(the_function->end(), else_bb);
             builder->SetInsertPoint(else_bb);
             if (!if_expr->alternative->statements.empty()) { if (auto* last_stmt_as_expr = dynamic_cast<ExpressionStatement*>(if_expr->alternative->statements.back().get())) { for (size_t i = 0; i < if_expr->alternative->statements.size() - 1; ++i) generate_statement(*if_expr->alternative->statements[i]); else_val = generate_expression(*last_stmt_as_expr->expression); } else { for (const auto& stmt : if_expr->alternative->statements) generate_statement(*stmt); } }
-            if (!builder->GetInsertBlock()->getTerminator()) builder->CreateBr(merge_bb);
+            else_reaches_merge = !builder->GetInsertBlock()->getTerminator();
+            if (else_reaches_merge) builder->CreateBr(merge_bb);
             else_end_bb = builder->GetInsertBlock();
         }
         the_function->insert(the_function->end(), merge_bb);
         builder->SetInsertPoint(merge_bb);
-        if (then_val || else_val) { llvm::PHINode* pn = builder->CreatePHI(builder->getInt32Ty(), 2, "iftmp"); pn->addIncoming(then_val ? then_val : builder->getInt32(0), then_end_bb); pn->addIncoming(else_val ? else_val : builder->getInt32(0), else_end_bb); return pn; }
+        // Branches that return do not reach the merge block and contribute no incoming value.
+        if (!then_reaches_merge) then_val = nullptr;
+        if (!else_reaches_merge) else_val = nullptr;
+        llvm::Type* phi_type = then_val ? then_val->getType() : (else_val ? else_val->getType() : nullptr);
+        if (phi_type && (!then_val || !else_val || then_val->getType() == else_val->getType())) {
+            llvm::PHINode* pn = builder->CreatePHI(phi_type, 2, "iftmp");
+            if (then_reaches_merge) pn->addIncoming(then_val ? then_val : llvm::Constant::getNullValue(phi_type), then_end_bb);
+            if (else_reaches_merge) pn->addIncoming(else_val ? else_val : llvm::Constant::getNullValue(phi_type), else_end_bb);
+            return pn;
+        }
         return builder->getInt32(0);
     }
+    else if (auto const* match_expr = dynamic_cast<const MatchExpression*>(&expr)) {
+        return generate_match(*match_expr, true);
+    }
     else if (auto const* func_lit = dynamic_cast<const FunctionLiteral*>(&expr)) {
-        llvm::BasicBlock* original_block = builder->GetInsertBlock(); auto old_named_values = named_values;
-        std::vector<llvm::Type*> param_types(func_lit->parameters.size(), builder->getInt32Ty());
-        llvm::FunctionType* func_type = llvm::FunctionType::get(builder->getInt32Ty(), param_types, false);
-        llvm::Function* the_function = llvm::Function::Create(func_type, llvm::Function::InternalLinkage, "user_fn", module.get());
+        CallSignature signature; if (!function_signature(*func_lit, signature)) return nullptr;
+        const std::vector<ParameterType>& params = signature.params;
+        Symbol func_symbol = pending_function; pending_function = no_symbol;
+        std::string func_name = func_symbol ? symbol_name(func_symbol) : "user_fn";
+        auto declared = declared_functions.find(func_lit);
+        if (declared == declared_functions.end() && !func_lit->type_parameters.empty()) return nullptr; // Only through instantiate()
+        llvm::Function* the_function = declared != declared_functions.end() ? declared->second : create_function(signature, llvm::Function::InternalLinkage, func_name);
+        if (!apply_annotations(*func_lit, the_function)) return nullptr;
+        // The enclosing function's state is saved only once nothing can fail.
+        llvm::BasicBlock* original_block = builder->GetInsertBlock(); size_t scope_mark = open_scope();
+        llvm::DIScope* original_scope = debug_scope; llvm::DebugLoc original_location = builder->getCurrentDebugLocation();
+        CoroutineState coroutine_state; CoroutineState* original_coroutine = coroutine; coroutine = nullptr;
+        if (func_symbol && !functions.lookup(func_symbol)) functions[func_symbol] = the_function;
         llvm::BasicBlock* func_entry_block = llvm::BasicBlock::Create(*context, "entry", the_function); builder->SetInsertPoint(func_entry_block);
-        named_values.clear(); size_t i = 0;
-        for (auto& arg : the_function->args()) { const std::string& param_name = func_lit->parameters[i++]->value; arg.setName(param_name); llvm::AllocaInst* alloca = create_entry_block_alloca(the_function, param_name, builder->getInt32Ty()); builder->CreateStore(&arg, alloca); named_values[param_name] = alloca; }
+        begin_debug_function(the_function, *func_lit);
+        if (func_lit->is_async) begin_coroutine(the_function, coroutine_state);
+        auto arg = the_function->arg_begin();
+        if (the_function->hasStructRetAttr()) (arg++)->setName("sret");
+        for (size_t i = 0; i < params.size(); ++i) {
+            const Identifier& param = *func_lit->parameters[i];
+            if (llvm::StructType* struct_type = struct_parameter(params[i])) {
+                AggregateABI abi = classify_aggregate(struct_type, module->getDataLayout());
+                llvm::Value* value;
+                if (abi.in_memory) { arg->setName(param.name() + ".byval"); value = builder->CreateLoad(struct_type, &*arg++, param.name()); }
+                else {
+                    std::vector<llvm::Value*> pieces;
+                    for (size_t r = 0; r < abi.registers.size(); ++r) { arg->setName(param.name() + ".coerce"); pieces.push_back(&*arg++); }
+                    value = from_registers(struct_type, pieces);
+                }
+                llvm::AllocaInst* alloca = create_entry_block_alloca(the_function, param.name(), struct_type); builder->CreateStore(value, alloca);
+                bind_variable(param.symbol, alloca); declare_debug_variable(alloca, param.name(), param, static_cast<unsigned>(i + 1));
+                continue;
+            }
+            llvm::Value* value = &*arg++; value->setName(param.name());
+            if (params[i].kind == ParameterType::Kind::Slice) { llvm::Value* length = &*arg++; value->setName(param.name() + ".data"); length->setName(param.name() + ".len"); value = make_slice(value, length); }
+            llvm::AllocaInst* alloca = create_entry_block_alloca(the_function, param.name(), value->getType()); builder->CreateStore(value, alloca);
+            if (params[i].kind != ParameterType::Kind::Value) element_types[alloca] = params[i].type;
+            bind_variable(param.symbol, alloca); declare_debug_variable(alloca, param.name(), param, static_cast<unsigned>(i + 1));
+        }
         for (const auto& stmt : func_lit->body->statements) generate_statement(*stmt);
-        if (!builder->GetInsertBlock()->getTerminator()) builder->CreateRet(builder->getInt32(0));
-        llvm::verifyFunction(*the_function); builder->SetInsertPoint(original_block); named_values = old_named_values; return the_function;
+        if (!builder->GetInsertBlock()->getTerminator()) generate_return(nullptr);
+        if (func_lit->is_async) end_coroutine();
+        llvm::verifyFunction(*the_function); builder->SetInsertPoint(original_block); close_scope(scope_mark);
+        coroutine = original_coroutine; debug_scope = original_scope; builder->SetCurrentDebugLocation(original_location); return the_function;
     }
     else if (auto const* call_expr = dynamic_cast<const CallExpression*>(&expr)) {
-        auto const* ident = dynamic_cast<const Identifier*>(call_expr->function.get()); if (!ident) return nullptr;
-        llvm::Function* callee_func = module->getFunction(ident->value); if (!callee_func) return nullptr; if (callee_func->arg_size() != call_expr->arguments.size()) return nullptr;
-        std::vector<llvm::Value*> args_v;
-        for (const auto& arg : call_expr->arguments) { args_v.push_back(generate_expression(*arg)); if (!args_v.back()) return nullptr; }
-        return builder->CreateCall(callee_func, args_v, "calltmp");
+        return generate_call(*call_expr, nullptr);
+    }
+    else if (auto const* builtin = dynamic_cast<const BuiltinCall*>(&expr)) {
+        return generate_builtin(*builtin);
+    }
+    else if (auto const* await_expr = dynamic_cast<const AwaitExpression*>(&expr)) {
+        return generate_await(*await_expr);
     }
     else if (auto const* while_expr = dynamic_cast<const WhileExpression*>(&expr)) {
         llvm::Function* the_function = builder->GetInsertBlock()->getParent();
@@ -193,14 +2095,14 @@ llvm::Value* CodeGenerator::generate_expression(const Expression& expr) {
         llvm::BasicBlock* loop_body_bb = llvm::BasicBlock::Create(*context, "loop_body", the_function);
         llvm::BasicBlock* loop_exit_bb = llvm::BasicBlock::Create(*context, "loop_exit", the_function);
         builder->CreateBr(loop_header_bb); builder->SetInsertPoint(loop_header_bb);
-        llvm::Value* cond_v = generate_expression(*while_expr->condition); if (!cond_v) return nullptr;
-        builder->CreateCondBr(cond_v, loop_body_bb, loop_exit_bb);
+        llvm::MDNode* weights; llvm::Value* cond_v = generate_condition(*while_expr->condition, &weights); if (!cond_v) return nullptr;
+        builder->CreateCondBr(cond_v, loop_body_bb, loop_exit_bb, weights);
         builder->SetInsertPoint(loop_body_bb); for (const auto& stmt : while_expr->body->statements) generate_statement(*stmt);
         if (!builder->GetInsertBlock()->getTerminator()) builder->CreateBr(loop_header_bb);
         builder->SetInsertPoint(loop_exit_bb); return llvm::Constant::getNullValue(builder->getInt32Ty());
     }
     else if (auto const* for_expr = dynamic_cast<const ForLoopExpression*>(&expr)) {
-        auto old_named_values = named_values;
+        size_t scope_mark = open_scope();
         if (for_expr->initializer) generate_statement(*for_expr->initializer);
         llvm::Function* the_function = builder->GetInsertBlock()->getParent();
         llvm::BasicBlock* loop_header_bb = llvm::BasicBlock::Create(*context, "loop_header", the_function);
@@ -209,9 +2111,10 @@ llvm::Value* CodeGenerator::generate_expression(const Expression& expr) {
         llvm::BasicBlock* loop_exit_bb = llvm::BasicBlock::Create(*context, "loop_exit", the_function);
         builder->CreateBr(loop_header_bb);
         builder->SetInsertPoint(loop_header_bb);
-        llvm::Value* cond_v; if (for_expr->condition) { cond_v = generate_expression(*for_expr->condition); } else { cond_v = builder->getInt1(true); }
+        llvm::MDNode* weights = nullptr;
+        llvm::Value* cond_v; if (for_expr->condition) { cond_v = generate_condition(*for_expr->condition, &weights); } else { cond_v = builder->getInt1(true); }
         if (!cond_v) return nullptr;
-        builder->CreateCondBr(cond_v, loop_body_bb, loop_exit_bb);
+        builder->CreateCondBr(cond_v, loop_body_bb, loop_exit_bb, weights);
         builder->SetInsertPoint(loop_body_bb);
         if (for_expr->body) { 
             for (const auto& stmt : for_expr->body->statements) {
@@ -223,41 +2126,504 @@ llvm::Value* CodeGenerator::generate_expression(const Expression& expr) {
         if (for_expr->increment) generate_expression(*for_expr->increment);
         if (!builder->GetInsertBlock()->getTerminator()) builder->CreateBr(loop_header_bb);
         builder->SetInsertPoint(loop_exit_bb);
-        named_values = old_named_values;
+        close_scope(scope_mark);
         return llvm::Constant::getNullValue(builder->getInt32Ty());
     }
     return nullptr;
 }
 
 
+// Adds the name of every function called anywhere inside node to callees.
+static void collect_callees(const Node& node, std::set<Symbol>& callees) {
+    if (auto const* call_expr = dynamic_cast<const CallExpression*>(&node)) {
+        if (auto const* ident = dynamic_cast<const Identifier*>(call_expr->function.get())) callees.insert(ident->symbol);
+    }
+    for_each_child(node, [&callees](const Node& child) { collect_callees(child, callees); });
+}
+
+// Adds every variable, function and struct type that node names to used,
+// and the names it binds itself (parameters, type parameters, let and var)
+// to bound.
+static void collect_names(const Node& node, std::set<Symbol>& used, std::set<Symbol>& bound) {
+    std::vector<const Node*> skipped;
+    if (auto const* ident = dynamic_cast<const Identifier*>(&node)) used.insert(ident->symbol);
+    else if (auto const* type = dynamic_cast<const TypeAnnotation*>(&node)) used.insert(type->name);
+    else if (auto const* let_stmt = dynamic_cast<const LetStatement*>(&node)) bound.insert(let_stmt->name->symbol);
+    else if (auto const* var_stmt = dynamic_cast<const VarStatement*>(&node)) bound.insert(var_stmt->name->symbol);
+    else if (auto const* member_expr = dynamic_cast<const MemberExpression*>(&node)) skipped.push_back(member_expr->field.get());
+    else if (auto const* func_lit = dynamic_cast<const FunctionLiteral*>(&node)) {
+        for (const auto& param : func_lit->parameters) bound.insert(param->symbol);
+        bound.insert(func_lit->type_parameters.begin(), func_lit->type_parameters.end());
+    } else if (auto const* struct_lit = dynamic_cast<const StructLiteral*>(&node)) {
+        used.insert(struct_lit->type_name);
+        for (const auto& field : struct_lit->fields) skipped.push_back(field.first.get());
+    }
+    for_each_child(node, [&](const Node& child) {
+        if (std::find(skipped.begin(), skipped.end(), &child) == skipped.end()) collect_names(child, used, bound);
+    });
+}
+
+static const FunctionLiteral* top_level_function(const Statement& stmt, const LetStatement** let_out = nullptr) {
+    auto const* let_stmt = dynamic_cast<const LetStatement*>(&stmt);
+    if (!let_stmt) return nullptr;
+    if (let_out) *let_out = let_stmt;
+    return dynamic_cast<const FunctionLiteral*>(let_stmt->value.get());
+}
+
+// True if stmt, at the top level of a program, is code that runs when the
+// program starts rather than a declaration.
+static bool is_top_level_code(const Statement& stmt) {
+    const LetStatement* let_stmt = nullptr;
+    if (top_level_function(stmt, &let_stmt)) return false;
+    if (let_stmt) {
+        // An exported constant only becomes part of the module's interface.
+        std::string constant_type;
+        long long constant_value;
+        return !(let_stmt->is_public && let_stmt->value && fold_constant(*let_stmt->value, constant_type, constant_value));
+    }
+    return !dynamic_cast<const StructDefinitionStatement*>(&stmt) && !dynamic_cast<const ImportStatement*>(&stmt);
+}
+
+// Gives every function and variable a section of its own, named after it,
+// so a linker run with --gc-sections can drop what the entry never reaches.
+static void assign_sections(llvm::Module& module) {
+    for (llvm::Function& function : module) {
+        if (!function.isDeclaration() && !function.hasSection()) function.setSection(".text." + function.getName().str());
+    }
+    for (llvm::GlobalVariable& variable : module.globals()) {
+        if (variable.isDeclaration() || variable.hasSection() || !variable.hasName()) continue;
+        bool is_zero = variable.getInitializer()->isNullValue();
+        const char* prefix = variable.isThreadLocal() ? (is_zero ? ".tbss." : ".tdata.")
+                           : variable.isConstant() ? ".rodata." : is_zero ? ".bss." : ".data.";
+        variable.setSection(prefix + variable.getName().str());
+    }
+}
+
+// True if function can return, once branches on constants are folded and
+// the blocks that leaves unreachable removed (`while (true)` generates an
+// exit block with a return).
+static bool may_return(llvm::Function& function) {
+    for (llvm::BasicBlock& block : function) llvm::ConstantFoldTerminator(&block);
+    llvm::removeUnreachableBlocks(function);
+    return std::any_of(function.begin(), function.end(),
+                       [](const llvm::BasicBlock& block) { return llvm::isa<llvm::ReturnInst>(block.getTerminator()); });
+}
+
+// A top-level let or var that binds a variable, rather than a function or an
+// exported constant.
+struct TopLevelBinding {
+    const Identifier* name;
+    const Expression* value;
+    const std::vector<Annotation>* annotations;
+    bool is_var;
+};
+
+static std::optional<TopLevelBinding> top_level_binding(const Statement& stmt) {
+    if (!is_top_level_code(stmt)) return std::nullopt;
+    if (auto const* let_stmt = dynamic_cast<const LetStatement*>(&stmt)) {
+        if (let_stmt->value) return TopLevelBinding{let_stmt->name.get(), let_stmt->value.get(), &let_stmt->annotations, false};
+    } else if (auto const* var_stmt = dynamic_cast<const VarStatement*>(&stmt)) {
+        if (var_stmt->value) return TopLevelBinding{var_stmt->name.get(), var_stmt->value.get(), &var_stmt->annotations, true};
+    }
+    return std::nullopt;
+}
+
+// True if expr is made only of literals, names and arithmetic, so generating
+// it calls nothing; whether it is constant is up to evaluate_constant().
+static bool may_fold(const Expression& expr) {
+    if (dynamic_cast<const IntegerLiteral*>(&expr) || dynamic_cast<const BooleanLiteral*>(&expr) || dynamic_cast<const Identifier*>(&expr)) return true;
+    if (auto const* prefix_expr = dynamic_cast<const PrefixExpression*>(&expr)) return prefix_expr->op == "-" && may_fold(*prefix_expr->right);
+    if (auto const* infix_expr = dynamic_cast<const InfixExpression*>(&expr)) return may_fold(*infix_expr->left) && may_fold(*infix_expr->right);
+    if (auto const* struct_lit = dynamic_cast<const StructLiteral*>(&expr)) {
+        return std::all_of(struct_lit->fields.begin(), struct_lit->fields.end(), [](const auto& field) { return may_fold(*field.second); });
+    }
+    if (auto const* array_lit = dynamic_cast<const ArrayLiteral*>(&expr)) {
+        return std::all_of(array_lit->elements.begin(), array_lit->elements.end(), [](const auto& element) { return may_fold(*element); });
+    }
+    return false;
+}
+
+// Variable that an assignment target or the operand of `&` is part of: `x`,
+// `x[i]`, `x.f` and nestings of them.
+static const Identifier* root_variable(const Expression& expr) {
+    if (auto const* ident = dynamic_cast<const Identifier*>(&expr)) return ident;
+    if (auto const* index_expr = dynamic_cast<const IndexExpression*>(&expr)) return root_variable(*index_expr->left);
+    if (auto const* member_expr = dynamic_cast<const MemberExpression*>(&expr)) return root_variable(*member_expr->left);
+    return nullptr;
+}
+
+// Variables that a program may write to, found in one walk: those it
+// assigns to or takes the address of, and those it uses other than to read
+// an element or a field, since an array or struct used so can be written
+// through a slice or a copy passed on. Locals of the same name count too;
+// only names are known here.
+struct WrittenNames {
+    std::set<Symbol> assigned;
+    std::set<Symbol> escaped;
+
+    bool may_write(Symbol name, bool is_aggregate) const {
+        return assigned.count(name) || (is_aggregate && escaped.count(name));
+    }
+};
+
+static void collect_written(const Node& node, WrittenNames& written) {
+    if (auto const* assign_expr = dynamic_cast<const AssignmentExpression*>(&node)) {
+        if (const Identifier* target = root_variable(*assign_expr->target)) written.assigned.insert(target->symbol);
+    }
+    auto const* prefix_expr = dynamic_cast<const PrefixExpression*>(&node);
+    if (prefix_expr && prefix_expr->op == "&") {
+        if (const Identifier* operand = root_variable(*prefix_expr->right)) written.assigned.insert(operand->symbol);
+    }
+    if (auto const* ident = dynamic_cast<const Identifier*>(&node)) written.escaped.insert(ident->symbol);
+    // Names that are not uses of a variable, and reads of an element or field.
+    std::vector<const Node*> skipped;
+    if (auto const* let_stmt = dynamic_cast<const LetStatement*>(&node)) skipped.push_back(let_stmt->name.get());
+    if (auto const* var_stmt = dynamic_cast<const VarStatement*>(&node)) skipped.push_back(var_stmt->name.get());
+    if (auto const* member_expr = dynamic_cast<const MemberExpression*>(&node)) {
+        skipped.push_back(member_expr->field.get());
+        if (dynamic_cast<const Identifier*>(member_expr->left.get())) skipped.push_back(member_expr->left.get());
+    }
+    if (auto const* index_expr = dynamic_cast<const IndexExpression*>(&node); index_expr && dynamic_cast<const Identifier*>(index_expr->left.get())) {
+        skipped.push_back(index_expr->left.get());
+    }
+    for_each_child(node, [&](const Node& child) {
+        if (std::find(skipped.begin(), skipped.end(), &child) == skipped.end()) collect_written(child, written);
+    });
+}
+
+// True for pointers, slices and task handles, and aggregates holding one.
+// Globals never hold these: a function's locals are then reachable only
+// through its own stack and the pointers it passes, which is what
+// infer_noalias_parameters() relies on.
+static bool holds_pointer(llvm::Type* type) {
+    if (type->isPointerTy()) return true;
+    if (auto* array_type = llvm::dyn_cast<llvm::ArrayType>(type)) return holds_pointer(array_type->getElementType());
+    if (auto* struct_type = llvm::dyn_cast<llvm::StructType>(type)) {
+        return std::any_of(struct_type->element_begin(), struct_type->element_end(), holds_pointer);
+    }
+    return false;
+}
+
+// Value of a top-level initializer if it is known at compile time, else
+// nullptr. The IRBuilder folds operations on constants, so the expression
+// is generated into a scratch function and is constant exactly when nothing
+// had to be emitted there. Array literals are generated as stores to a
+// temporary, so they are folded element by element instead.
+llvm::Constant* CodeGenerator::evaluate_constant(const Expression& expr) {
+    if (!may_fold(expr)) return nullptr;
+    if (auto const* array_lit = dynamic_cast<const ArrayLiteral*>(&expr)) {
+        std::vector<llvm::Constant*> elements;
+        for (const auto& element : array_lit->elements) {
+            llvm::Constant* value = evaluate_constant(*element);
+            if (!value || !value->getType()->isIntegerTy(32)) return nullptr;
+            elements.push_back(value);
+        }
+        return llvm::ConstantArray::get(llvm::ArrayType::get(builder->getInt32Ty(), elements.size()), elements);
+    }
+    llvm::IRBuilderBase::InsertPointGuard guard(*builder);
+    llvm::Function* scratch = llvm::Function::Create(llvm::FunctionType::get(builder->getVoidTy(), false),
+                                                     llvm::Function::PrivateLinkage, "manit.evaluate", module.get());
+    builder->SetInsertPoint(llvm::BasicBlock::Create(*context, "entry", scratch));
+    // An expression in error is not constant; it is reported once, when it
+    // is generated for the top-level code.
+    size_t error_count = errors.size();
+    llvm::Value* value = generate_expression(expr);
+    bool folded = scratch->size() == 1 && scratch->getEntryBlock().empty() && errors.size() == error_count;
+    errors.resize(error_count);
+    auto* constant = folded ? llvm::dyn_cast_or_null<llvm::Constant>(value) : nullptr;
+    scratch->eraseFromParent();
+    return constant;
+}
+
+// Defines the global of a top-level binding, internal to the module: in
+// .rodata if is_constant, otherwise in .data, or .bss when zero. Globals set
+// by the top-level code (initializer nullptr) start out zero.
+llvm::GlobalVariable* CodeGenerator::define_global(const Statement& stmt, llvm::Type* type, llvm::Constant* initializer, bool is_constant) {
+    static const Symbol thread_local_symbol = intern("thread_local");
+    std::optional<TopLevelBinding> binding = top_level_binding(stmt);
+    if (global_variables.lookup(binding->name->symbol)) report_error(stmt, "'" + binding->name->name() + "' is already defined at the top level");
+    auto* global = new llvm::GlobalVariable(*module, type, is_constant, llvm::GlobalValue::InternalLinkage,
+                                            initializer ? initializer : llvm::Constant::getNullValue(type), binding->name->name());
+    for (const Annotation& annotation : *binding->annotations) {
+        if (annotation.name == thread_local_symbol) global->setThreadLocal(true);
+    }
+    global_variables[binding->name->symbol] = global;
+    if (debug_builder && options.debug_info == DebugInfoLevel::Full) {
+        if (llvm::DIType* debug_variable_type = debug_type(type)) {
+            unsigned line = source_map->locate(stmt.source_offset()).line;
+            global->addDebugInfo(debug_builder->createGlobalVariableExpression(debug_file, binding->name->name(), "", debug_file, line,
+                                                                               debug_variable_type, true));
+        }
+    }
+    return global;
+}
+
+// Stores the value of a top-level binding that is only known at run time
+// into its global; part of the top-level code.
+void CodeGenerator::initialize_global(const Statement& stmt, llvm::GlobalVariable* global) {
+    emit_location(stmt);
+    const Expression& value = *top_level_binding(stmt)->value;
+    llvm::Type* type = global->getValueType();
+    if (type->isStructTy()) {
+        generate_into(value, global);
+        return;
+    }
+    llvm::Value* val = generate_expression(value);
+    if (!val) return;
+    if (array_storage(val) == type) {
+        uint64_t size = module->getDataLayout().getTypeAllocSize(type);
+        builder->CreateMemCpy(global, global->getAlign(), val, llvm::MaybeAlign(), size);
+    } else if (val->getType() == type) {
+        builder->CreateStore(val, global);
+    }
+}
+
+// Importers generate the body of a `pub` generic from its source, so it may
+// only refer to what the module interface exports: `pub` functions, `pub`
+// generics, `pub` constants and `pub` structs.
+void CodeGenerator::check_exported_generics(const Program& program) {
+    std::set<Symbol> private_names;
+    for (const auto& stmt : program.statements) {
+        const LetStatement* let_stmt = nullptr;
+        if (top_level_function(*stmt, &let_stmt)) {
+            if (!let_stmt->is_public) private_names.insert(let_stmt->name->symbol);
+        } else if (let_stmt || dynamic_cast<const VarStatement*>(stmt.get())) {
+            if (std::optional<TopLevelBinding> binding = top_level_binding(*stmt)) private_names.insert(binding->name->symbol);
+        } else if (auto const* struct_def_stmt = dynamic_cast<const StructDefinitionStatement*>(stmt.get())) {
+            if (!struct_def_stmt->is_public) private_names.insert(struct_def_stmt->name->symbol);
+        }
+    }
+    for (const auto& stmt : program.statements) {
+        const LetStatement* let_stmt = nullptr;
+        auto const* func_lit = top_level_function(*stmt, &let_stmt);
+        if (!func_lit || !let_stmt->is_public || func_lit->type_parameters.empty()) continue;
+        std::set<Symbol> used, bound;
+        collect_names(*func_lit, used, bound);
+        for (Symbol name : used) {
+            if (!private_names.count(name) || bound.count(name)) continue;
+            report_error(*stmt, "pub generic function '" + let_stmt->name->name() + "' uses '" + symbol_name(name) +
+                                "', which the module does not export; modules that import it could not generate its body");
+        }
+    }
+}
+
 void CodeGenerator::generate(const Program& program) {
+    if (options.debug_info != DebugInfoLevel::None && source_map) {
+        debug_builder = std::make_unique<llvm::DIBuilder>(*module);
+        llvm::SmallString<256> directory;
+        if (llvm::sys::path::is_absolute(source_path) || llvm::sys::fs::current_path(directory)) directory = "";
+        debug_file = debug_builder->createFile(source_path, directory);
+        // DWARF has no language code for ManiT; C has the closest semantics for debuggers.
+        debug_builder->createCompileUnit(llvm::dwarf::DW_LANG_C, debug_file, "manitc", options.opt_level > 0, "", 0, "",
+                                         options.debug_info == DebugInfoLevel::Full ? llvm::DICompileUnit::FullDebug
+                                                                                    : llvm::DICompileUnit::LineTablesOnly);
+        module->addModuleFlag(llvm::Module::Warning, "Debug Info Version", llvm::DEBUG_METADATA_VERSION);
+        module->addModuleFlag(llvm::Module::Max, "Dwarf Version", 4);
+    }
+
+    // Struct types come first since globals and parameters may use them.
+    for (const auto& stmt : program.statements) {
+        if (dynamic_cast<const StructDefinitionStatement*>(stmt.get())) generate_statement(*stmt);
+    }
+
+    // Pre-pass: classify the top level and collect every function definition
+    // by name, so calls can refer to functions defined later in the file.
+    // A freestanding program starts at its entry symbol instead of main.
+    // Top-level let and var bindings become globals; those with a value known
+    // at compile time are declarations, fully defined here.
+    static const Symbol thread_local_symbol = intern("thread_local");
+    const Symbol entry_symbol = intern(options.freestanding ? options.entry_symbol : "main");
+    std::map<Symbol, const LetStatement*> definitions;
+    std::set<const Statement*> static_globals;
+    std::vector<const Statement*> run_time_globals;
+    bool user_defined_entry = false;
+    bool has_exports = false;
+    bool has_top_level_code = false;
+    WrittenNames written;
+    collect_written(program, written);
+    for (const auto& stmt : program.statements) {
+        const LetStatement* let_stmt = nullptr;
+        if (auto const* func_lit = top_level_function(*stmt, &let_stmt)) {
+            definitions.emplace(let_stmt->name->symbol, let_stmt);
+            if (!func_lit->type_parameters.empty() && !generic_functions.lookup(let_stmt->name->symbol)) {
+                generic_functions[let_stmt->name->symbol] = func_lit;
+                if (let_stmt->is_public) shared_generics[func_lit] = module_name_for_path(source_path);
+            }
+            user_defined_entry = user_defined_entry || let_stmt->name->symbol == entry_symbol;
+            has_exports = has_exports || let_stmt->is_public;
+        } else if (let_stmt) {
+            has_exports = has_exports || let_stmt->is_public;
+            // Exported constants fold into the initializers that use them.
+            if (!is_top_level_code(*stmt)) generate_statement(*stmt);
+        } else if (auto const* struct_def_stmt = dynamic_cast<const StructDefinitionStatement*>(stmt.get())) {
+            has_exports = has_exports || struct_def_stmt->is_public;
+        }
+        if (std::optional<TopLevelBinding> binding = top_level_binding(*stmt)) {
+            bool is_thread_local = false;
+            for (const Annotation& annotation : *binding->annotations) {
+                if (annotation.name == thread_local_symbol && annotation.arguments.empty()) is_thread_local = true;
+                else report_error(*stmt, "unknown annotation " + annotation_to_string(annotation) + " on a let or var");
+            }
+            // A let that nothing writes is read-only, and a constant for the optimizer.
+            llvm::Constant* initializer = evaluate_constant(*binding->value);
+            if (initializer && !holds_pointer(initializer->getType())) {
+                bool is_constant = !binding->is_var && !written.may_write(binding->name->symbol, initializer->getType()->isAggregateType());
+                define_global(*stmt, initializer->getType(), initializer, is_constant);
+                static_globals.insert(stmt.get());
+                continue;
+            }
+            if (!binding->annotations->empty()) {
+                // Every thread starts with the initializer; no code runs per thread.
+                if (is_thread_local) report_error(*stmt, "@thread_local '" + binding->name->name() + "' needs a value known at compile time");
+                static_globals.insert(stmt.get());
+                continue;
+            }
+            run_time_globals.push_back(stmt.get());
+        }
+        has_top_level_code = has_top_level_code || is_top_level_code(*stmt);
+    }
+    check_exported_generics(program);
+    // A library module (only declarations, at least one of them exported) has
+    // no top-level code to run and gets no synthesized main. Neither does a
+    // freestanding program, and with a main of its own a program's top-level
+    // code is dropped; nothing would set their run-time globals.
+    const bool is_library = options.freestanding || (!user_defined_entry && has_exports && !has_top_level_code);
+    for (const auto& stmt : program.statements) {
+        if (!(options.freestanding || user_defined_entry) || !is_top_level_code(*stmt) || static_globals.count(stmt.get())) continue;
+        if (std::optional<TopLevelBinding> binding = top_level_binding(*stmt)) {
+            report_error(*stmt, "the value of '" + binding->name->name() + "' is not known at compile time, and no top-level code runs to set it");
+        } else if (options.freestanding) {
+            report_error(*stmt, "a freestanding program has no top-level code; it starts at its entry function '" + options.entry_symbol + "'");
+        }
+    }
+
+    // Walk the call graph from the entry point: the user's main (or the
+    // freestanding entry) if there is one, otherwise the top-level code.
+    // Exports are entry points too for libraries and with --keep-exported.
+    std::set<Symbol> reachable;
+    std::vector<Symbol> worklist;
+    auto mark = [&](Symbol name) {
+        if (definitions.count(name) && reachable.insert(name).second) worklist.push_back(name);
+    };
+    if (user_defined_entry) {
+        mark(entry_symbol);
+    } else {
+        std::set<Symbol> callees;
+        for (const auto& stmt : program.statements) {
+            if (!top_level_function(*stmt)) collect_callees(*stmt, callees);
+        }
+        for (Symbol name : callees) mark(name);
+    }
+    if (is_library || options.keep_exported) {
+        for (const auto& entry : definitions) {
+            if (entry.second->is_public) mark(entry.first);
+        }
+    }
+    while (!worklist.empty()) {
+        Symbol name = worklist.back();
+        worklist.pop_back();
+        std::set<Symbol> callees;
+        collect_callees(*definitions[name]->value, callees);
+        for (Symbol callee : callees) mark(callee);
+    }
+
+    // Declare reachable functions up front; their bodies are filled in when
+    // the defining let statement is reached.
+    for (const auto& stmt : program.statements) {
+        const LetStatement* let_stmt = nullptr;
+        auto const* func_lit = top_level_function(*stmt, &let_stmt);
+        Symbol symbol = func_lit ? let_stmt->name->symbol : no_symbol;
+        CallSignature signature;
+        if (!func_lit || !func_lit->type_parameters.empty() || definitions[symbol] != let_stmt || !reachable.count(symbol) || !function_signature(*func_lit, signature)) continue;
+        auto linkage = (let_stmt->is_public || symbol == entry_symbol) ? llvm::Function::ExternalLinkage : llvm::Function::InternalLinkage;
+        llvm::Function* function = create_function(signature, linkage, let_stmt->name->name());
+        declared_functions[func_lit] = function;
+        functions[symbol] = function;
+    }
+
+    // The remaining globals start out zero and are set by the top-level code,
+    // in program order. A binding whose type cannot be told before its value
+    // is generated, or that holds a pointer, stays local to the top-level code.
+    std::map<const Statement*, llvm::GlobalVariable*> initialized_globals;
+    for (const Statement* stmt : run_time_globals) {
+        const Expression& value = *top_level_binding(*stmt)->value;
+        llvm::Type* type = value_type(value);
+        if (auto const* array_lit = dynamic_cast<const ArrayLiteral*>(&value)) type = llvm::ArrayType::get(builder->getInt32Ty(), array_lit->elements.size());
+        if (type && type->isSized() && !holds_pointer(type)) initialized_globals[stmt] = define_global(*stmt, type, nullptr, false);
+    }
+
+    // The top-level code still needs a function to be generated into; it is
+    // only kept as main when the program does not define its own.
     llvm::FunctionType* func_type = llvm::FunctionType::get(builder->getInt32Ty(), false);
-    llvm::Function* main_func = llvm::Function::Create(func_type, llvm::Function::ExternalLinkage, "main", module.get());
+    llvm::Function* main_func = llvm::Function::Create(func_type, llvm::Function::ExternalLinkage,
+                                                       user_defined_entry ? "manit.top_level" : "main", module.get());
     llvm::BasicBlock* entry = llvm::BasicBlock::Create(*context, "entry", main_func);
     builder->SetInsertPoint(entry);
+    if (!user_defined_entry && !is_library) begin_debug_function(main_func, program);
 
     for (const auto& stmt : program.statements) {
-        generate_statement(*stmt);
+        const LetStatement* let_stmt = nullptr;
+        if (top_level_function(*stmt, &let_stmt) && !reachable.count(let_stmt->name->symbol)) continue;
+        if (static_globals.count(stmt.get())) continue;
+        auto global = initialized_globals.find(stmt.get());
+        if (global != initialized_globals.end()) initialize_global(*stmt, global->second);
+        else generate_statement(*stmt);
     }
 
     if (!builder->GetInsertBlock()->getTerminator()) {
         builder->CreateRet(builder->getInt32(0));
     }
 
-    bool user_defined_main = false;
-    for (const auto& stmt : program.statements) {
-        if (auto const* let_stmt = dynamic_cast<const LetStatement*>(stmt.get())) {
-            if (let_stmt->name->value == "main") {
-                user_defined_main = true;
-                break;
-            }
+    if (user_defined_entry || is_library) {
+        main_func->eraseFromParent();
+    }
+    // Nothing calls a freestanding entry, so there is no return address to
+    // return to, and the stack it starts on need not be aligned for calls.
+    llvm::Function* freestanding_entry = options.freestanding ? functions.lookup(entry_symbol) : nullptr;
+    if (freestanding_entry && !freestanding_entry->isDeclaration()) {
+        if (may_return(*freestanding_entry)) {
+            report_error(*definitions[entry_symbol], "the entry function '" + options.entry_symbol + "' of a freestanding program must not return");
         }
+        freestanding_entry->addFnAttr(llvm::Attribute::NoReturn);
+        freestanding_entry->addFnAttr("stackrealign");
     }
-
-    if (user_defined_main) {
-        main_func->eraseFromParent();
+    infer_noalias_parameters(*module);
+    if (options.instrument_functions) instrument_functions(*module);
+    infer_function_attributes(*module);
+    // The CPU and features apply to every function, as the backend and the
+    // optimizer's cost model read them from there.
+    for (llvm::Function& function : *module) {
+        if (function.isDeclaration()) continue;
+        if (!options.target_cpu.empty()) function.addFnAttr("target-cpu", options.target_cpu);
+        if (!options.target_features.empty()) function.addFnAttr("target-features", options.target_features);
+        // Without a C library, calls must not be synthesized from loop idioms
+        // (memcpy, memset and memmove are still expected, as in C). Interrupt
+        // handlers may run on the same stack, below its pointer, so nothing
+        // may be kept in the red zone there.
+        if (options.freestanding) {
+            function.addFnAttr("no-builtins");
+            function.addFnAttr(llvm::Attribute::NoRedZone);
+        }
     }
+    emit_target_clones();
+    if (options.freestanding) assign_sections(*module);
+    if (debug_builder) debug_builder->finalize();
+}
+
+bool CodeGenerator::verify(llvm::raw_ostream& os) {
+    return !llvm::verifyModule(*module, &os);
+}
+
+void CodeGenerator::optimize() {
+    optimize_module(*module, options);
+}
+
+void CodeGenerator::print(llvm::raw_ostream& os) const {
+    module->print(os, nullptr);
+}
 
-    llvm::verifyModule(*module, &llvm::errs());
-    module->print(llvm::outs(), nullptr);
+void CodeGenerator::write_bitcode(llvm::raw_ostream& os) const {
+    llvm::ProfileSummaryInfo profile_summary(*module);
+    llvm::ModuleSummaryIndex index = llvm::buildModuleSummaryIndex(*module, nullptr, &profile_summary);
+    llvm::WriteBitcodeToFile(*module, os, false, &index, options.lto == LTOMode::Thin);
 }
\ No newline at end of file
@@ -2,43 +2,254 @@
 #define MANIT_CODEGEN_HPP
 
 #include "ast.hpp"
+#include "interface.hpp"
+#include "source_map.hpp"
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/Module.h>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/Value.h>
+#include <llvm/IR/DIBuilder.h>
 #include <memory>
 #include <map>
+#include <set>
+#include <utility>
+#include <vector>
 #include <string>
 
+enum class DebugInfoLevel {
+    None,           // -g0
+    LineTablesOnly, // -g1: functions and line tables, no types or variables
+    Full,           // -g: adds parameter and local variable descriptions
+};
+
+enum class LTOMode {
+    None,
+    Full, // -flto=full: modules are merged and optimized as one at link time
+    Thin, // -flto=thin: modules stay separate and import what they inline
+};
+
+// What signed integer overflow in + - * and unary minus does.
+enum class OverflowMode {
+    Default,   // Trap at -O0, Undefined when optimizing
+    Trap,      // --overflow=trap: the program traps
+    Undefined, // --overflow=undefined: operations are nsw, as in C
+    Wrap,      // --overflow=wrap: two's complement wrapping, as `+%` does
+};
+
+// Options that control IR generation and the optimization pipeline.
+struct CodeGenOptions {
+    unsigned opt_level = 0;             // -O0 .. -O3
+    bool profile_generate = false;      // --profile-generate[=path]: insert IR profile counters
+    std::string profile_generate_path;  // Raw profile written at exit (default: default_%m.profraw)
+    std::string profile_use_path;       // --profile-use=file: indexed profile from llvm-profdata
+    bool keep_exported = false;         // --keep-exported: generate `pub` functions main never calls
+    DebugInfoLevel debug_info = DebugInfoLevel::None;
+    bool instrument_functions = false;  // --instrument=functions: call counts and timers via runtime/manit_prof.cpp
+    LTOMode lto = LTOMode::None;        // -flto=full|thin: pre-link pipeline and bitcode output (lto.hpp)
+    std::string target_cpu;             // --target-cpu=name; empty for the target's baseline (target.hpp)
+    std::string target_features;        // --target-features=+a,-b
+    bool freestanding = false;          // --freestanding: no C library or hosted main (see generate())
+    std::string entry_symbol = "_start"; // --entry=name: where a freestanding program starts
+    OverflowMode overflow = OverflowMode::Default;
+};
+
+// ManiT type of a function parameter. A slice is passed as two LLVM
+// arguments, its data pointer and an i64 length.
+struct ParameterType {
+    enum class Kind { Value, Pointer, Slice };
+    Kind kind = Kind::Value;
+    llvm::Type* type = nullptr; // The value type, or the pointee or slice element
+};
+
+// ManiT-level signature of a function that can be called by name. Struct
+// parameters and results are lowered per classify_aggregate() (abi.hpp).
+struct CallSignature {
+    std::vector<ParameterType> params;
+    llvm::Type* return_type = nullptr; // i32, bool or a struct
+};
+
+// The async function being generated; see CodeGenerator::begin_coroutine().
+struct CoroutineState {
+    llvm::Value* id = nullptr;                 // llvm.coro.id token
+    llvm::Value* handle = nullptr;             // This task's frame
+    llvm::Value* promise = nullptr;            // %manit.promise: result, state, waiting task
+    llvm::BasicBlock* final_block = nullptr;   // Returns store the result and branch here
+    llvm::BasicBlock* cleanup_block = nullptr; // Frees the frame when the task is destroyed
+    llvm::BasicBlock* suspend_block = nullptr; // Returns the handle to whoever started or resumed the task
+};
+
+struct CloneTarget;
+
 // Forward declarations for LLVM classes
 namespace llvm {
+    class raw_ostream;
     class AllocaInst;
     class Function;
     class Type;
     class StructType;
+    class Constant;
+    class GlobalVariable;
+    class MDNode;
 }
 
 class CodeGenerator {
 public:
-    CodeGenerator();
+    explicit CodeGenerator(const CodeGenOptions& options = CodeGenOptions());
+    // Declares the exports of an imported module; call before generate().
+    void import_interface(const ModuleInterface& iface);
+    // Names the source file and its text for debug info; call before generate().
+    void set_source(const std::string& path, const std::string& text);
+    // Lowers the program to LLVM IR.
     void generate(const Program& program);
+    // Runs the IR verifier, writing diagnostics to os; returns false if the module is malformed.
+    bool verify(llvm::raw_ostream& os);
+    // Runs the optimization pipeline selected by the options.
+    void optimize();
+    // Writes the module as textual IR.
+    void print(llvm::raw_ostream& os) const;
+    // Writes the module as bitcode with its module summary, for -flto.
+    void write_bitcode(llvm::raw_ostream& os) const;
+
+    const llvm::Module& get_module() const { return *module; }
+    // Errors found by generate(), as "path:line:column: message".
+    const std::vector<std::string>& get_errors() const { return errors; }
 
 private:
+    CodeGenOptions options;
     std::unique_ptr<llvm::LLVMContext> context;
     std::unique_ptr<llvm::Module> module;
     std::unique_ptr<llvm::IRBuilder<>> builder;
 
-    // Symbol table for variable allocations
-    std::map<std::string, llvm::AllocaInst*> named_values;
+    // Local variables by symbol. Each binding logs the one it shadows so a
+    // scope is closed by unwinding the log to the mark taken when it opened.
+    SymbolMap<llvm::AllocaInst*> named_values;
+    std::vector<std::pair<Symbol, llvm::AllocaInst*>> binding_log;
+    // Top-level let and var bindings, visible from every function (see generate())
+    SymbolMap<llvm::GlobalVariable*> global_variables;
     // Type table for struct definitions
-    std::map<std::string, llvm::StructType*> struct_types;
+    SymbolMap<llvm::StructType*> struct_types;
+    // Compile-time constants: `pub let` values and imported constants
+    SymbolMap<llvm::Constant*> constants;
+    // Named functions: top-level definitions and imported declarations.
+    // Instances of generic functions are entered under their mangled name
+    // (see instantiate()), which makes this the specialization cache too.
+    SymbolMap<llvm::Function*> functions;
+    // Generic functions by name, and the ones whose instances may be shared
+    // with other modules (`pub` or imported), with the module defining them
+    SymbolMap<const FunctionLiteral*> generic_functions;
+    std::map<const FunctionLiteral*, std::string> shared_generics;
+    // Imported generic functions, with the program parsed from their source
+    std::map<const FunctionLiteral*, std::unique_ptr<Program>> imported_generics;
+    // Type parameters of the generic function being instantiated
+    std::vector<std::pair<Symbol, llvm::Type*>> type_arguments;
+    // Binding name for the function literal about to be lowered by a let statement
+    Symbol pending_function = no_symbol;
+    // Top-level functions declared by the pre-pass in generate(), by definition
+    std::map<const FunctionLiteral*, llvm::Function*> declared_functions;
+    // ManiT signature of every function that can be called by name
+    std::map<const llvm::Function*, CallSignature> signatures;
+    // Field names of each struct type, in layout order
+    std::map<const llvm::StructType*, std::vector<Symbol>> struct_fields;
+    // Pointee or element type of variables holding a pointer or a slice
+    std::map<const llvm::Value*, llvm::Type*> element_types;
+    // { ptr, i64 }: the in-register form of a slice
+    llvm::StructType* slice_type = nullptr;
+    // { i32 result, i32 state, ptr waiter }: the promise of every async task
+    llvm::StructType* promise_type = nullptr;
+    // Set while the body of an async function is generated
+    CoroutineState* coroutine = nullptr;
+    // Functions annotated with @target_clones and the targets they name
+    std::map<llvm::Function*, std::vector<const CloneTarget*>> cloned_functions;
+
+    // Source errors, such as a match that is not exhaustive
+    std::vector<std::string> errors;
+
+    // Debug info; debug_builder is null unless enabled and a source was set
+    std::string source_path;
+    std::unique_ptr<SourceMap> source_map;
+    std::unique_ptr<llvm::DIBuilder> debug_builder;
+    llvm::DIFile* debug_file = nullptr;
+    llvm::DIScope* debug_scope = nullptr; // Subprogram of the function being generated
 
     // Visitor methods
     llvm::Value* generate_expression(const Expression& expr);
+    llvm::Value* integer_literal(const IntegerLiteral& int_lit, bool negate);
     void generate_statement(const Statement& stmt);
 
     // Helper methods
+    llvm::Type* type_from_name(Symbol name);
+    void bind_variable(Symbol name, llvm::AllocaInst* alloca);
+    void bind_array(const Identifier& name, llvm::Value* array, const Expression& value, const Node& node);
+    llvm::Value* lookup_variable(Symbol name);
+    size_t open_scope() const { return binding_log.size(); }
+    void close_scope(size_t mark);
     llvm::AllocaInst* create_entry_block_alloca(llvm::Function* the_function, const std::string& var_name, llvm::Type* type);
+    llvm::Value* generate_element_pointer(const IndexExpression& index_expr, llvm::Type** element_type);
+
+    // Pointers and slices
+    bool parameter_type(const std::string& spelling, ParameterType& param);
+    bool function_signature(const FunctionLiteral& func_lit, CallSignature& signature);
+    llvm::Function* create_function(const CallSignature& signature, llvm::Function::LinkageTypes linkage, const std::string& name);
+    bool apply_annotations(const FunctionLiteral& func_lit, llvm::Function* function);
+    void emit_target_clones();
+    llvm::Type* element_type(const Expression& expr);
+    bool generate_slice_parts(const Expression& expr, llvm::Value** data, llvm::Value** length, llvm::Type** element);
+    llvm::Value* make_slice(llvm::Value* data, llvm::Value* length);
+
+    // Structs and calls
+    void define_struct(llvm::StructType* type, const std::vector<std::pair<Symbol, llvm::Type*>>& fields);
+    int field_index(llvm::StructType* type, Symbol field);
+    llvm::Value* struct_address(const Expression& expr, llvm::StructType** type);
+    llvm::Type* member_type(const MemberExpression& member_expr);
+    llvm::Value* member_pointer(const MemberExpression& member_expr, llvm::Type** field_type);
+    llvm::StructType* struct_result_type(const Expression& expr);
+    bool generate_into(const Expression& expr, llvm::Value* dest);
+    llvm::Value* generate_call(const CallExpression& call_expr, llvm::Value* dest);
+    void generate_return(const Expression* value);
+
+    // Top-level bindings as globals
+    llvm::Constant* evaluate_constant(const Expression& expr);
+    void check_exported_generics(const Program& program);
+    llvm::GlobalVariable* define_global(const Statement& stmt, llvm::Type* type, llvm::Constant* initializer, bool is_constant);
+    void initialize_global(const Statement& stmt, llvm::GlobalVariable* global);
+
+    // Generic functions
+    llvm::Type* value_type(const Expression& expr);
+    bool infer_type_arguments(const FunctionLiteral& generic, const CallExpression& call_expr, std::vector<std::pair<Symbol, llvm::Type*>>& bindings);
+    llvm::Type* generic_result_type(const FunctionLiteral& generic, const CallExpression& call_expr);
+    llvm::Function* instantiate(Symbol name, const CallExpression& call_expr);
+    std::vector<llvm::Value*> to_registers(llvm::Value* aggregate, const std::vector<llvm::Type*>& registers);
+    llvm::Value* from_registers(llvm::StructType* type, const std::vector<llvm::Value*>& pieces);
+
+    // Builtins (`@name(...)`)
+    llvm::Value* generate_builtin(const BuiltinCall& builtin);
+    llvm::Value* generate_atomic_builtin(const BuiltinCall& builtin);
+    llvm::Value* generate_condition(const Expression& condition, llvm::MDNode** weights);
+
+    // Integer arithmetic under --overflow, and the overflow builtins
+    OverflowMode overflow_mode() const;
+    void emit_trap_if(llvm::Value* failed, const char* name);
+    llvm::Value* generate_arithmetic(const Node& node, llvm::Instruction::BinaryOps opcode, bool wrapping, llvm::Value* left, llvm::Value* right);
+    llvm::Value* generate_division(const Node& node, llvm::Value* left, llvm::Value* right);
+    llvm::Value* generate_arithmetic_builtin(const BuiltinCall& builtin);
+
+    // match expressions (switch, or a dispatch table with @computed_goto)
+    llvm::Value* generate_match(const MatchExpression& match_expr, bool value_used);
+    void report_error(const Node& node, const std::string& message);
+
+    // Async functions (LLVM switched-resume coroutines, runtime/manit_async.cpp)
+    void begin_coroutine(llvm::Function* function, CoroutineState& state);
+    void end_coroutine();
+    void suspend_coroutine();
+    llvm::Value* task_promise(llvm::Value* task);
+    llvm::Value* generate_await(const AwaitExpression& await_expr);
+    llvm::Value* generate_task_builtin(const BuiltinCall& builtin);
+
+    // Debug info helpers; all are no-ops when debug info is off
+    void emit_location(const Node& node);
+    llvm::DISubprogram* begin_debug_function(llvm::Function* function, const Node& node);
+    void declare_debug_variable(llvm::AllocaInst* alloca, const std::string& name, const Node& node, unsigned arg_no = 0);
+    llvm::DIType* debug_type(llvm::Type* type);
 };
 
 #endif // MANIT_CODEGEN_HPP
\ No newline at end of file
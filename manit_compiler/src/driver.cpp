@@ -0,0 +1,547 @@
+#include "driver.hpp"
+#include "interface.hpp"
+#include "lexer.hpp"
+#include "lto.hpp"
+#include "parser.hpp"
+#include "target.hpp"
+#include "thread_pool.hpp"
+#include "timing.hpp"
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/raw_ostream.h>
+
+void print_usage(std::ostream& os, const char* argv0) {
+    os << "Usage: " << argv0 << " [options] <filename.manit>...\n"
+       << "Options:\n"
+       << "  -O0, -O1, -O2, -O3          Optimization level (default: -O0)\n"
+       << "  -g, -g1, -g0                Full debug info, line tables only, or none (default: -g0)\n"
+       << "  -o path                     Output file for a single input (default: stdout)\n"
+       << "  --out-dir=dir               Directory for <name>.ll outputs when compiling several files\n"
+       << "  -j N                        Compile up to N files in parallel (default: one per CPU)\n"
+       << "  --server=socket             Stay resident and serve compile requests on a Unix socket\n"
+       << "  --working-directory=dir     Resolve relative paths against dir\n"
+       << "  -I dir                      Search dir for the interfaces (<module>.mti) of imported modules\n"
+       << "  --emit-interface            Write <name>.mti describing the module's `pub` declarations\n"
+       << "                              (implies --keep-exported)\n"
+       << "  --keep-exported             Generate `pub` functions even if main never calls them\n"
+       << "  --instrument=functions      Count calls and time every function; link with libmanit_prof\n"
+       << "                              (report at exit or on SIGUSR1, see runtime/manit_prof.cpp)\n"
+       << "  --profile-generate[=path]   Instrument the program to write a raw profile at exit\n"
+       << "                              (link the emitted IR with `clang -fprofile-generate`)\n"
+       << "  --profile-use=file          Optimize using an indexed profile (llvm-profdata merge)\n"
+       << "  -flto[=full|thin]           Write bitcode for link-time optimization (<name>.bc); given\n"
+       << "                              bitcode, objects and archives instead of sources, link them\n"
+       << "                              into the executable -o path (ThinLTO backends run on -j threads)\n"
+       << "  --linker=program            Compiler driver that performs the final -flto link (default: c++)\n"
+       << "  --target-cpu=name           Generate code for CPU name (`native`: the host CPU and its features)\n"
+       << "  --target-features=+a,-b     Enable or disable target features on top of the CPU's\n"
+       << "  --overflow=trap|undefined|wrap\n"
+       << "                              Signed overflow of + - * / traps, is undefined (nsw) or wraps\n"
+       << "                              (default: trap at -O0, else undefined); division by zero\n"
+       << "                              traps unless it is undefined\n"
+       << "  --freestanding              No C library, runtime init or hosted main: the program starts\n"
+       << "                              at its entry function, and each function and variable gets its\n"
+       << "                              own section; an -flto link uses -nostdlib -static\n"
+       << "  --entry=name                Entry function of a freestanding program (default: _start);\n"
+       << "                              it must not return, and realigns the stack it starts on\n"
+       << "  --linker-script=path        Link with this linker script (-flto links)\n"
+       << "  --gc-sections               Drop sections the entry point never reaches (-flto links)\n"
+       << "  --time-report[=table|json]  Report per-phase time, peak RSS and counts on stderr\n"
+       << "  --time-report-out=path      Write the time report to a file instead of stderr\n";
+}
+
+static bool starts_with(const std::string& s, const std::string& prefix) {
+    return s.compare(0, prefix.size(), prefix) == 0;
+}
+
+// Parses a decimal number that fits in an unsigned; no sign, no spaces.
+static bool parse_unsigned(const std::string& text, unsigned& value) {
+    if (text.empty() || text.find_first_not_of("0123456789") != std::string::npos) return false;
+    unsigned long long result = 0;
+    for (char digit : text) {
+        result = result * 10 + static_cast<unsigned>(digit - '0');
+        if (result > std::numeric_limits<unsigned>::max()) return false;
+    }
+    value = static_cast<unsigned>(result);
+    return true;
+}
+
+bool parse_command_line(const std::vector<std::string>& args, DriverOptions& options, std::ostream& err) {
+    for (size_t i = 0; i < args.size(); ++i) {
+        const std::string& arg = args[i];
+        auto value_after = [&arg](const std::string& prefix) { return arg.substr(prefix.size()); };
+        if (arg == "-O0" || arg == "-O1" || arg == "-O2" || arg == "-O3") {
+            options.codegen.opt_level = arg[2] - '0';
+        } else if (arg == "-g" || arg == "-g2") {
+            options.codegen.debug_info = DebugInfoLevel::Full;
+        } else if (arg == "-g1" || arg == "-gline-tables-only") {
+            options.codegen.debug_info = DebugInfoLevel::LineTablesOnly;
+        } else if (arg == "-g0") {
+            options.codegen.debug_info = DebugInfoLevel::None;
+        } else if (arg == "-o" || arg == "-j" || arg == "-I") {
+            if (i + 1 >= args.size()) {
+                err << "Error: Option '" << arg << "' requires a value" << std::endl;
+                return false;
+            }
+            const std::string& value = args[++i];
+            if (arg == "-o") {
+                options.output_path = value;
+            } else if (arg == "-I") {
+                options.import_paths.push_back(value);
+            } else if (!parse_unsigned(value, options.jobs)) {
+                err << "Error: Invalid job count '" << value << "'" << std::endl;
+                return false;
+            }
+        } else if (starts_with(arg, "-j") && arg.size() > 2) {
+            if (!parse_unsigned(value_after("-j"), options.jobs)) {
+                err << "Error: Invalid job count '" << value_after("-j") << "'" << std::endl;
+                return false;
+            }
+        } else if (starts_with(arg, "-I") && arg.size() > 2) {
+            options.import_paths.push_back(value_after("-I"));
+        } else if (arg == "--emit-interface") {
+            options.emit_interface = true;
+            // Importers link against every function the summary lists.
+            options.codegen.keep_exported = true;
+        } else if (arg == "--keep-exported") {
+            options.codegen.keep_exported = true;
+        } else if (starts_with(arg, "--out-dir=")) {
+            options.output_dir = value_after("--out-dir=");
+        } else if (starts_with(arg, "--server=")) {
+            options.server_socket = value_after("--server=");
+        } else if (starts_with(arg, "--working-directory=")) {
+            options.working_directory = value_after("--working-directory=");
+        } else if (arg == "--instrument=functions") {
+            options.codegen.instrument_functions = true;
+        } else if (arg == "--profile-generate") {
+            options.codegen.profile_generate = true;
+        } else if (starts_with(arg, "--profile-generate=")) {
+            options.codegen.profile_generate = true;
+            options.codegen.profile_generate_path = value_after("--profile-generate=");
+        } else if (starts_with(arg, "--profile-use=")) {
+            options.codegen.profile_use_path = value_after("--profile-use=");
+        } else if (arg == "-flto" || arg == "-flto=full") {
+            options.codegen.lto = LTOMode::Full;
+        } else if (arg == "-flto=thin") {
+            options.codegen.lto = LTOMode::Thin;
+        } else if (starts_with(arg, "--linker=")) {
+            options.linker = value_after("--linker=");
+        } else if (starts_with(arg, "--target-cpu=")) {
+            options.codegen.target_cpu = value_after("--target-cpu=");
+        } else if (starts_with(arg, "--target-features=")) {
+            options.codegen.target_features = value_after("--target-features=");
+        } else if (arg == "--overflow=trap") {
+            options.codegen.overflow = OverflowMode::Trap;
+        } else if (arg == "--overflow=undefined") {
+            options.codegen.overflow = OverflowMode::Undefined;
+        } else if (arg == "--overflow=wrap") {
+            options.codegen.overflow = OverflowMode::Wrap;
+        } else if (arg == "--freestanding") {
+            options.codegen.freestanding = true;
+        } else if (starts_with(arg, "--entry=")) {
+            options.codegen.entry_symbol = value_after("--entry=");
+        } else if (starts_with(arg, "--linker-script=")) {
+            options.linker_script = value_after("--linker-script=");
+        } else if (arg == "--gc-sections") {
+            options.gc_sections = true;
+        } else if (arg == "--time-report" || arg == "--time-report=table") {
+            options.report_format = ReportFormat::Table;
+        } else if (arg == "--time-report=json") {
+            options.report_format = ReportFormat::Json;
+        } else if (starts_with(arg, "--time-report-out=")) {
+            options.report_path = value_after("--time-report-out=");
+        } else if (!arg.empty() && arg[0] == '-' && arg != "-") {
+            err << "Error: Unknown option '" << arg << "'" << std::endl;
+            return false;
+        } else {
+            options.inputs.push_back(arg);
+        }
+    }
+
+    if (options.codegen.profile_generate && !options.codegen.profile_use_path.empty()) {
+        err << "Error: --profile-generate and --profile-use cannot be combined." << std::endl;
+        return false;
+    }
+    // Both write their reports from hosted runtime code that runs at exit.
+    if (options.codegen.freestanding && (options.codegen.instrument_functions || options.codegen.profile_generate)) {
+        err << "Error: --instrument=functions and --profile-generate need the hosted runtime; they cannot be used with --freestanding." << std::endl;
+        return false;
+    }
+    if (options.codegen.entry_symbol.empty()) {
+        err << "Error: --entry needs a function name." << std::endl;
+        return false;
+    }
+    resolve_native_target(options.codegen);
+    std::string target_error;
+    if (!check_target_options(options.codegen, target_error)) {
+        err << "Error: " << target_error << std::endl;
+        return false;
+    }
+    if (!options.output_path.empty() && options.inputs.size() > 1 && !is_lto_link(options)) {
+        err << "Error: -o cannot be used with multiple input files; use --out-dir instead." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+static std::string resolve_path(const std::string& path, const DriverOptions& options) {
+    if (options.working_directory.empty() || path.empty() || path[0] == '/' || path == "-") return path;
+    return options.working_directory + "/" + path;
+}
+
+static std::string derived_output_path(const std::string& input_path, const DriverOptions& options, const std::string& new_extension) {
+    std::string stem = input_path;
+    const std::string extension = ".manit";
+    if (stem.size() > extension.size() && stem.compare(stem.size() - extension.size(), extension.size(), extension) == 0) {
+        stem.erase(stem.size() - extension.size());
+    }
+    if (options.output_dir.empty()) return stem + new_extension;
+    size_t slash = stem.find_last_of('/');
+    std::string name = slash == std::string::npos ? stem : stem.substr(slash + 1);
+    return options.output_dir + "/" + name + new_extension;
+}
+
+static bool is_source_file(const std::string& path) {
+    const std::string extension = ".manit";
+    return path.size() > extension.size() && path.compare(path.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+bool is_lto_link(const DriverOptions& options) {
+    return options.codegen.lto != LTOMode::None && !std::all_of(options.inputs.begin(), options.inputs.end(), is_source_file);
+}
+
+std::string batch_output_path(const std::string& input_path, const DriverOptions& options) {
+    return derived_output_path(input_path, options, options.codegen.lto != LTOMode::None ? ".bc" : ".ll");
+}
+
+std::string interface_output_path(const std::string& input_path, const DriverOptions& options) {
+    return derived_output_path(input_path, options, ".mti");
+}
+
+static std::string directory_of(const std::string& path) {
+    size_t slash = path.find_last_of('/');
+    if (slash == std::string::npos) return ".";
+    return slash == 0 ? "/" : path.substr(0, slash);
+}
+
+// Loads the interface of every module that program imports. <module>.mti is
+// looked up next to the importing source, then in --out-dir, then in each -I
+// directory.
+static bool load_imports(const Program& program, const std::string& source_path, const DriverOptions& options,
+                         std::vector<ModuleInterface>& imports, std::ostream& diagnostics) {
+    std::vector<std::string> search_dirs = { directory_of(source_path) };
+    if (!options.output_dir.empty()) search_dirs.push_back(resolve_path(options.output_dir, options));
+    for (const auto& dir : options.import_paths) search_dirs.push_back(resolve_path(dir, options));
+
+    for (const auto& stmt : program.statements) {
+        auto const* import_stmt = dynamic_cast<const ImportStatement*>(stmt.get());
+        if (!import_stmt) continue;
+        const std::string& name = import_stmt->module_name->name();
+        if (std::any_of(imports.begin(), imports.end(), [&name](const ModuleInterface& i) { return i.module_name == name; })) continue;
+
+        std::string found;
+        for (const auto& dir : search_dirs) {
+            std::string candidate = dir + "/" + name + ".mti";
+            if (std::ifstream(candidate).good()) { found = candidate; break; }
+        }
+        if (found.empty()) {
+            diagnostics << "Error: Cannot find interface '" << name << ".mti' for import '" << name
+                        << "' (compile " << name << ".manit with --emit-interface, or add its directory with -I)" << std::endl;
+            return false;
+        }
+
+        ModuleInterface iface;
+        std::string error;
+        if (!read_interface(found, iface, error)) {
+            diagnostics << "Error: Invalid interface " << error << std::endl;
+            return false;
+        }
+        imports.push_back(std::move(iface));
+    }
+    return true;
+}
+
+// Module names imported by a source file, found with a token scan so batch
+// scheduling does not need a full parse.
+static std::vector<std::string> scan_imports(const std::string& source_path) {
+    std::vector<std::string> names;
+    std::ifstream file(source_path);
+    if (!file.is_open()) return names;
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    Lexer lexer(buffer.str());
+    for (Token tok = lexer.next_token(); tok.type != TokenType::END_OF_FILE; tok = lexer.next_token()) {
+        if (tok.type != TokenType::IMPORT) continue;
+        tok = lexer.next_token();
+        if (tok.type == TokenType::IDENTIFIER) names.push_back(symbol_name(tok.symbol));
+    }
+    return names;
+}
+
+CompileResult compile_file(const std::string& input_path, const std::string& output_path, const DriverOptions& options) {
+    CompileResult result;
+    std::stringstream diagnostics;
+    auto fail = [&](const std::string& message) {
+        diagnostics << message << std::endl;
+        result.exit_code = 1;
+        result.diagnostics = diagnostics.str();
+        return result;
+    };
+
+    const std::string source_path = resolve_path(input_path, options);
+    const CodeGenOptions& codegen_options = options.codegen;
+    CodeGenOptions resolved_options = codegen_options;
+    if (!codegen_options.profile_use_path.empty()) {
+        resolved_options.profile_use_path = resolve_path(codegen_options.profile_use_path, options);
+        if (!std::ifstream(resolved_options.profile_use_path).good()) {
+            return fail("Error: Could not open profile '" + codegen_options.profile_use_path + "'");
+        }
+    }
+
+    std::ifstream file(source_path);
+    if (!file.is_open()) {
+        return fail("Error: Could not open file '" + input_path + "'");
+    }
+
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    std::string source_code = buffer.str();
+
+    if (source_code.empty()) {
+        diagnostics << "Warning: Input file '" << input_path << "' is empty." << std::endl;
+    }
+
+    TimeReport report;
+    const bool reporting = options.report_format != ReportFormat::None;
+
+    // The parser pulls tokens lazily, so lexing is timed on its own with a
+    // separate pass over the source when a report is requested.
+    if (reporting) {
+        report.begin_phase("lex");
+        Lexer counting_lexer(source_code);
+        std::uint64_t token_count = 0;
+        while (counting_lexer.next_token().type != TokenType::END_OF_FILE) ++token_count;
+        report.end_phase();
+        report.add_count("bytes", source_code.size());
+        report.add_count("tokens", token_count);
+    }
+
+    if (reporting) report.begin_phase("parse");
+    Lexer l(source_code);
+    Parser p(l);
+    auto program = p.parse_program();
+    if (reporting) {
+        report.end_phase();
+        if (program) report.add_count("ast_nodes", count_nodes(*program));
+    }
+
+    if (!program) {
+        return fail("Error: Parsing failed. Please check the source code for syntax errors.");
+    }
+
+    if (reporting) report.begin_phase("imports");
+    std::vector<ModuleInterface> imports;
+    bool imports_loaded = load_imports(*program, source_path, options, imports, diagnostics);
+    if (reporting) { report.end_phase(); report.add_count("imports", imports.size()); }
+    if (!imports_loaded) {
+        result.exit_code = 1;
+        result.diagnostics = diagnostics.str();
+        return result;
+    }
+
+    CodeGenerator codegen(resolved_options);
+    for (const auto& iface : imports) codegen.import_interface(iface);
+    codegen.set_source(input_path, source_code);
+    auto add_module_counts = [&]() {
+        std::uint64_t functions = 0;
+        for (const auto& f : codegen.get_module()) if (!f.isDeclaration()) ++functions;
+        report.add_count("functions", functions);
+        report.add_count("ir_instructions", codegen.get_module().getInstructionCount());
+    };
+
+    if (reporting) report.begin_phase("codegen");
+    codegen.generate(*program);
+    if (reporting) { report.end_phase(); add_module_counts(); }
+    const std::vector<std::string>& errors = codegen.get_errors();
+    if (!errors.empty()) {
+        for (size_t i = 0; i + 1 < errors.size(); ++i) diagnostics << "Error: " << errors[i] << std::endl;
+        return fail("Error: " + errors.back());
+    }
+
+    if (reporting) report.begin_phase("verify");
+    std::string verifier_output;
+    llvm::raw_string_ostream verifier_stream(verifier_output);
+    bool valid = codegen.verify(verifier_stream);
+    verifier_stream.flush();
+    diagnostics << verifier_output;
+    if (reporting) report.end_phase();
+
+    // Only well-formed IR is handed to the pass pipeline.
+    if (valid) {
+        if (reporting) report.begin_phase("optimize");
+        codegen.optimize();
+        if (reporting) { report.end_phase(); add_module_counts(); }
+    }
+
+    if (reporting) report.begin_phase("emit");
+    const bool bitcode = codegen_options.lto != LTOMode::None;
+    if (bitcode && !valid) {
+        return fail("Error: Not writing bitcode for an invalid module.");
+    }
+    if (output_path == "-") {
+        if (bitcode) codegen.write_bitcode(llvm::outs());
+        else codegen.print(llvm::outs());
+        llvm::outs().flush();
+    } else {
+        std::error_code ec;
+        llvm::raw_fd_ostream out(resolve_path(output_path, options), ec, bitcode ? llvm::sys::fs::OF_None : llvm::sys::fs::OF_Text);
+        if (ec) {
+            return fail("Error: Could not open output file '" + output_path + "': " + ec.message());
+        }
+        if (bitcode) codegen.write_bitcode(out);
+        else codegen.print(out);
+    }
+    if (reporting) report.end_phase();
+
+    // Dependents rebuild when the summary changes, so it is written only for
+    // modules that compiled cleanly, and only if its contents differ.
+    if (options.emit_interface && valid) {
+        bool changed = false;
+        std::string error;
+        ModuleInterface iface = collect_interface(*program, module_name_for_path(input_path), source_code);
+        if (!write_interface_if_changed(resolve_path(interface_output_path(input_path, options), options), iface, changed, error)) {
+            return fail("Error: Could not write interface: " + error);
+        }
+    }
+
+    if (reporting) {
+        std::stringstream rendered;
+        if (options.report_format == ReportFormat::Json) {
+            report.print_json(rendered, input_path);
+        } else {
+            rendered << input_path << ":\n";
+            report.print_table(rendered);
+        }
+        result.report = rendered.str();
+    }
+
+    result.diagnostics = diagnostics.str();
+    return result;
+}
+
+// Scheduling level of each input: 0 if it imports no other input of the
+// batch, otherwise one more than the deepest input it imports. Returns an
+// empty vector (after reporting) if the batch imports form a cycle.
+static std::vector<unsigned> import_levels(const DriverOptions& options, std::ostream& err) {
+    const size_t count = options.inputs.size();
+    std::map<std::string, size_t> input_for_module;
+    for (size_t i = 0; i < count; ++i) input_for_module[module_name_for_path(options.inputs[i])] = i;
+
+    std::vector<std::vector<size_t>> dependencies(count);
+    for (size_t i = 0; i < count; ++i) {
+        for (const auto& name : scan_imports(resolve_path(options.inputs[i], options))) {
+            auto it = input_for_module.find(name);
+            if (it != input_for_module.end()) dependencies[i].push_back(it->second);
+        }
+    }
+
+    enum class Mark { None, Visiting, Done };
+    std::vector<Mark> marks(count, Mark::None);
+    std::vector<unsigned> levels(count, 0);
+    std::function<bool(size_t)> visit = [&](size_t i) {
+        if (marks[i] == Mark::Done) return true;
+        if (marks[i] == Mark::Visiting) {
+            err << "Error: Import cycle involving '" << options.inputs[i] << "'" << std::endl;
+            return false;
+        }
+        marks[i] = Mark::Visiting;
+        for (size_t dependency : dependencies[i]) {
+            if (!visit(dependency)) return false;
+            levels[i] = std::max(levels[i], levels[dependency] + 1);
+        }
+        marks[i] = Mark::Done;
+        return true;
+    };
+    for (size_t i = 0; i < count; ++i) {
+        if (!visit(i)) return {};
+    }
+    return levels;
+}
+
+// Links the bitcode produced by earlier -flto compiles with other bitcode
+// and native inputs; sources must be compiled first.
+static int run_lto_link(const DriverOptions& options, std::ostream& err) {
+    if (options.output_path.empty()) {
+        err << "Error: An -flto link needs an output file (-o path)." << std::endl;
+        return 1;
+    }
+    std::vector<std::string> inputs;
+    for (const auto& input : options.inputs) {
+        if (is_source_file(input)) {
+            err << "Error: '" << input << "' is a source file; compile it with -flto first and link the .bc." << std::endl;
+            return 1;
+        }
+        inputs.push_back(resolve_path(input, options));
+    }
+    std::vector<std::string> linker_args;
+    if (options.codegen.freestanding) {
+        linker_args = {"-nostdlib", "-static", "-Wl,-e," + options.codegen.entry_symbol};
+    }
+    if (options.gc_sections) linker_args.push_back("-Wl,--gc-sections");
+    if (!options.linker_script.empty()) linker_args.push_back("-Wl,-T," + resolve_path(options.linker_script, options));
+    return lto_link(inputs, resolve_path(options.output_path, options), options.linker, linker_args, options.codegen, options.jobs, err);
+}
+
+int run_compilations(const DriverOptions& options, std::ostream& err) {
+    if (is_lto_link(options)) return run_lto_link(options, err);
+    const size_t count = options.inputs.size();
+    std::vector<CompileResult> results(count);
+
+    if (count == 1) {
+        std::string output = options.output_path.empty() ? "-" : options.output_path;
+        results[0] = compile_file(options.inputs[0], output, options);
+    } else {
+        // With --emit-interface, an input is compiled only once the inputs it
+        // imports have written their summaries.
+        std::vector<unsigned> levels = options.emit_interface ? import_levels(options, err) : std::vector<unsigned>(count, 0);
+        if (levels.empty()) return 1;
+        unsigned last_level = *std::max_element(levels.begin(), levels.end());
+
+        ThreadPool pool(std::min<size_t>(options.jobs ? options.jobs : std::thread::hardware_concurrency(), count));
+        for (unsigned level = 0; level <= last_level; ++level) {
+            for (size_t i = 0; i < count; ++i) {
+                if (levels[i] != level) continue;
+                pool.submit([&, i]() {
+                    results[i] = compile_file(options.inputs[i], batch_output_path(options.inputs[i], options), options);
+                });
+            }
+            pool.wait();
+        }
+    }
+
+    std::ofstream report_file;
+    if (!options.report_path.empty() && options.report_format != ReportFormat::None) {
+        report_file.open(resolve_path(options.report_path, options));
+        if (!report_file.is_open()) {
+            err << "Error: Could not open report file '" << options.report_path << "'" << std::endl;
+            return 1;
+        }
+    }
+
+    int exit_code = 0;
+    for (const auto& result : results) {
+        err << result.diagnostics;
+        if (!result.report.empty()) {
+            (report_file.is_open() ? static_cast<std::ostream&>(report_file) : err) << result.report;
+        }
+        exit_code = std::max(exit_code, result.exit_code);
+    }
+    return exit_code;
+}
@@ -0,0 +1,63 @@
+#ifndef MANIT_DRIVER_HPP
+#define MANIT_DRIVER_HPP
+
+#include "codegen.hpp"
+#include <ostream>
+#include <string>
+#include <vector>
+
+enum class ReportFormat { None, Table, Json };
+
+// Everything a manitc invocation (or a compile-server request) asks for.
+struct DriverOptions {
+    CodeGenOptions codegen;
+    ReportFormat report_format = ReportFormat::None;
+    std::string report_path;       // --time-report-out=path
+    std::string output_path;       // -o path, single input only ("-" is stdout)
+    std::string output_dir;        // --out-dir=dir for batch compiles
+    std::string working_directory; // Base for relative paths (--working-directory=dir)
+    unsigned jobs = 0;             // -j N; 0 runs one job per hardware thread
+    std::string server_socket;     // --server=path
+    std::vector<std::string> import_paths; // -I dir: searched for <module>.mti after the importer's directory
+    bool emit_interface = false;   // --emit-interface: write <name>.mti for each input
+    std::string linker = "c++";    // --linker=program: compiler driver for the final link of -flto builds
+    std::string linker_script;     // --linker-script=path: passed to the -flto link (-T)
+    bool gc_sections = false;      // --gc-sections: the -flto link drops unreferenced sections
+    std::vector<std::string> inputs;
+};
+
+struct CompileResult {
+    int exit_code = 0;
+    std::string diagnostics;
+    std::string report; // Rendered --time-report, if requested
+};
+
+void print_usage(std::ostream& os, const char* argv0);
+
+// Parses manitc arguments (without argv[0]) on top of the values already in
+// options. Writes a message to err and returns false on malformed input.
+bool parse_command_line(const std::vector<std::string>& args, DriverOptions& options, std::ostream& err);
+
+// Compiles one source file to textual IR at output_path ("-" for stdout).
+// Each call owns its LLVMContext, so calls may run concurrently.
+CompileResult compile_file(const std::string& input_path, const std::string& output_path, const DriverOptions& options);
+
+// True if options ask for an LTO link (-flto with bitcode or object inputs)
+// rather than compiling sources.
+bool is_lto_link(const DriverOptions& options);
+
+// Output path for input when compiling several files at once: <input>.ll
+// (<input>.bc with -flto), or the same file name inside options.output_dir.
+std::string batch_output_path(const std::string& input_path, const DriverOptions& options);
+
+// Path of the interface summary written for input with --emit-interface:
+// <input>.mti, or the same file name inside options.output_dir.
+std::string interface_output_path(const std::string& input_path, const DriverOptions& options);
+
+// Compiles options.inputs, using a pool of options.jobs threads when there is
+// more than one, or performs the LTO link they ask for. Diagnostics and
+// reports are written to err in input order. Returns the highest exit code of
+// all jobs.
+int run_compilations(const DriverOptions& options, std::ostream& err);
+
+#endif // MANIT_DRIVER_HPP
@@ -0,0 +1,48 @@
+#include "instrumentation.hpp"
+#include <llvm/IR/DebugInfoMetadata.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Module.h>
+#include <vector>
+
+void instrument_functions(llvm::Module& module) {
+    llvm::LLVMContext& context = module.getContext();
+    llvm::IRBuilder<> builder(context);
+    llvm::Type* ptr_type = builder.getPtrTy();
+
+    // Matches `Site` in the runtime: { const char* name; atomic<uint32_t> id; }
+    llvm::StructType* site_type = llvm::StructType::create(context, {ptr_type, builder.getInt32Ty()}, "manit.prof_site");
+    llvm::FunctionType* hook_type = llvm::FunctionType::get(builder.getVoidTy(), {ptr_type}, false);
+    llvm::FunctionCallee enter_hook = module.getOrInsertFunction("__manit_prof_enter", hook_type);
+    llvm::FunctionCallee exit_hook = module.getOrInsertFunction("__manit_prof_exit", hook_type);
+
+    std::vector<llvm::Function*> functions;
+    for (auto& function : module) {
+        if (!function.isDeclaration()) functions.push_back(&function);
+    }
+
+    for (llvm::Function* function : functions) {
+        std::string name = function->getName().str();
+        llvm::GlobalVariable* name_string = builder.CreateGlobalString(name, "__manit_prof_name." + name, 0, &module);
+        llvm::Constant* site_init = llvm::ConstantStruct::get(
+            site_type, {llvm::ConstantExpr::getPointerCast(name_string, ptr_type), builder.getInt32(0)});
+        auto* site_global = new llvm::GlobalVariable(module, site_type, false, llvm::GlobalValue::PrivateLinkage,
+                                                     site_init, "__manit_prof_site." + name);
+        llvm::Constant* site = llvm::ConstantExpr::getPointerCast(site_global, ptr_type);
+
+        // The entry hook is attributed to the function's own line when it has debug info.
+        builder.SetInsertPoint(&*function->getEntryBlock().getFirstInsertionPt());
+        if (llvm::DISubprogram* subprogram = function->getSubprogram()) {
+            builder.SetCurrentDebugLocation(llvm::DILocation::get(context, subprogram->getLine(), 0, subprogram));
+        } else {
+            builder.SetCurrentDebugLocation(llvm::DebugLoc());
+        }
+        builder.CreateCall(enter_hook, {site});
+
+        for (auto& block : *function) {
+            if (auto* ret = llvm::dyn_cast_or_null<llvm::ReturnInst>(block.getTerminator())) {
+                builder.SetInsertPoint(ret); // Takes the return's debug location
+                builder.CreateCall(exit_hook, {site});
+            }
+        }
+    }
+}
@@ -0,0 +1,14 @@
+#ifndef MANIT_INSTRUMENTATION_HPP
+#define MANIT_INSTRUMENTATION_HPP
+
+namespace llvm {
+    class Module;
+}
+
+// Inserts calls to the manit_prof runtime (runtime/manit_prof.cpp) into every
+// function defined in module: __manit_prof_enter on entry and
+// __manit_prof_exit before each return. Each function passes a private site
+// record holding its name, which the runtime numbers on first call.
+void instrument_functions(llvm::Module& module);
+
+#endif // MANIT_INSTRUMENTATION_HPP
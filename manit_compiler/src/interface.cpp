@@ -0,0 +1,295 @@
+#include "interface.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+// File layout: the magic and version, then the module name and four
+// length-prefixed tables (functions, structs, constants, generics). Integers are
+// little-endian; strings are a u32 length followed by the bytes.
+static const char interface_magic[4] = {'M', 'T', 'I', '\0'};
+static const std::uint32_t interface_version = 2;
+
+std::string module_name_for_path(const std::string& path) {
+    size_t slash = path.find_last_of('/');
+    std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+    size_t dot = name.find_last_of('.');
+    if (dot != std::string::npos && dot > 0) name.erase(dot);
+    return name;
+}
+
+bool fold_constant(const Expression& expr, std::string& type, long long& value) {
+    if (auto const* int_lit = dynamic_cast<const IntegerLiteral*>(&expr)) {
+        type = "i32";
+        value = int_lit->value;
+        return value <= INT32_MAX;
+    }
+    if (auto const* bool_lit = dynamic_cast<const BooleanLiteral*>(&expr)) {
+        type = "bool";
+        value = bool_lit->value;
+        return true;
+    }
+    if (auto const* prefix_expr = dynamic_cast<const PrefixExpression*>(&expr)) {
+        if (prefix_expr->op != "-" || !prefix_expr->right) return false;
+        auto const* int_lit = dynamic_cast<const IntegerLiteral*>(prefix_expr->right.get());
+        if (int_lit && int_lit->value == -static_cast<long long>(INT32_MIN)) {
+            type = "i32";
+            value = INT32_MIN;
+            return true;
+        }
+        if (!fold_constant(*prefix_expr->right, type, value) || type != "i32") return false;
+        value = -value;
+        return value <= INT32_MAX;
+    }
+    if (auto const* infix_expr = dynamic_cast<const InfixExpression*>(&expr)) {
+        std::string left_type, right_type;
+        long long left, right;
+        if (!infix_expr->left || !infix_expr->right) return false;
+        if (!fold_constant(*infix_expr->left, left_type, left) || left_type != "i32") return false;
+        if (!fold_constant(*infix_expr->right, right_type, right) || right_type != "i32") return false;
+        type = "i32";
+        const std::string& op = infix_expr->op;
+        if (op == "+" || op == "+%") value = left + right;
+        else if (op == "-" || op == "-%") value = left - right;
+        else if (op == "*" || op == "*%") value = left * right;
+        else if (op == "/" && right != 0) value = left / right;
+        else return false;
+        // Only the wrapping operators may leave the i32 range; codegen
+        // reports overflow of the others.
+        if (op.back() == '%') value = static_cast<std::int32_t>(static_cast<std::uint32_t>(value));
+        return value >= INT32_MIN && value <= INT32_MAX;
+    }
+    return false;
+}
+
+ModuleInterface collect_interface(const Program& program, const std::string& module_name, const std::string& source) {
+    ModuleInterface iface;
+    iface.module_name = module_name;
+    for (const auto& stmt : program.statements) {
+        if (auto const* let_stmt = dynamic_cast<const LetStatement*>(stmt.get())) {
+            if (!let_stmt->is_public || !let_stmt->value) continue;
+            if (auto const* func_lit = dynamic_cast<const FunctionLiteral*>(let_stmt->value.get())) {
+                if (!func_lit->type_parameters.empty()) {
+                    GenericFunction generic;
+                    generic.name = let_stmt->name->name();
+                    for (const auto& annotation : func_lit->annotations) generic.source += annotation_to_string(annotation) + " ";
+                    generic.source += (func_lit->is_async ? "async " : "") + source.substr(func_lit->token.offset, func_lit->end_offset - func_lit->token.offset);
+                    iface.generics.push_back(generic);
+                    continue;
+                }
+                FunctionSignature signature;
+                signature.name = let_stmt->name->name();
+                for (const auto& type : func_lit->parameter_types) signature.param_types.push_back(type ? type->to_string() : "i32");
+                signature.return_type = func_lit->is_async ? "task" : func_lit->return_type ? func_lit->return_type->to_string() : "i32";
+                iface.functions.push_back(signature);
+                continue;
+            }
+            ConstantValue constant;
+            constant.name = let_stmt->name->name();
+            if (fold_constant(*let_stmt->value, constant.type, constant.value)) iface.constants.push_back(constant);
+        }
+        else if (auto const* struct_def_stmt = dynamic_cast<const StructDefinitionStatement*>(stmt.get())) {
+            if (!struct_def_stmt->is_public) continue;
+            StructLayout layout;
+            layout.name = struct_def_stmt->name->name();
+            for (const auto& field : struct_def_stmt->fields) {
+                layout.fields.emplace_back(field.name->name(), field.type->name());
+            }
+            iface.structs.push_back(layout);
+        }
+    }
+
+    auto by_name = [](const auto& a, const auto& b) { return a.name < b.name; };
+    std::sort(iface.functions.begin(), iface.functions.end(), by_name);
+    std::sort(iface.structs.begin(), iface.structs.end(), by_name);
+    std::sort(iface.constants.begin(), iface.constants.end(), by_name);
+    std::sort(iface.generics.begin(), iface.generics.end(), by_name);
+    return iface;
+}
+
+namespace {
+
+class Writer {
+public:
+    void u32(std::uint32_t v) { for (int i = 0; i < 4; ++i) out.push_back(static_cast<char>(v >> (8 * i))); }
+    void i64(long long v) { auto u = static_cast<std::uint64_t>(v); for (int i = 0; i < 8; ++i) out.push_back(static_cast<char>(u >> (8 * i))); }
+    void str(const std::string& s) { u32(static_cast<std::uint32_t>(s.size())); out += s; }
+    std::string out;
+};
+
+class Reader {
+public:
+    Reader(const std::string& bytes, size_t pos) : bytes(bytes), pos(pos) {}
+    bool u32(std::uint32_t& v) {
+        if (bytes.size() - pos < 4) return false;
+        v = 0;
+        for (int i = 0; i < 4; ++i) v |= static_cast<std::uint32_t>(static_cast<unsigned char>(bytes[pos++])) << (8 * i);
+        return true;
+    }
+    bool i64(long long& v) {
+        if (bytes.size() - pos < 8) return false;
+        std::uint64_t u = 0;
+        for (int i = 0; i < 8; ++i) u |= static_cast<std::uint64_t>(static_cast<unsigned char>(bytes[pos++])) << (8 * i);
+        v = static_cast<long long>(u);
+        return true;
+    }
+    bool str(std::string& s) {
+        std::uint32_t size;
+        if (!u32(size) || bytes.size() - pos < size) return false;
+        s = bytes.substr(pos, size);
+        pos += size;
+        return true;
+    }
+    bool at_end() const { return pos == bytes.size(); }
+private:
+    const std::string& bytes;
+    size_t pos;
+};
+
+} // namespace
+
+std::string serialize_interface(const ModuleInterface& iface) {
+    Writer w;
+    w.out.append(interface_magic, sizeof(interface_magic));
+    w.u32(interface_version);
+    w.str(iface.module_name);
+
+    w.u32(static_cast<std::uint32_t>(iface.functions.size()));
+    for (const auto& f : iface.functions) {
+        w.str(f.name);
+        w.u32(static_cast<std::uint32_t>(f.param_types.size()));
+        for (const auto& t : f.param_types) w.str(t);
+        w.str(f.return_type);
+    }
+
+    w.u32(static_cast<std::uint32_t>(iface.structs.size()));
+    for (const auto& s : iface.structs) {
+        w.str(s.name);
+        w.u32(static_cast<std::uint32_t>(s.fields.size()));
+        for (const auto& field : s.fields) { w.str(field.first); w.str(field.second); }
+    }
+
+    w.u32(static_cast<std::uint32_t>(iface.constants.size()));
+    for (const auto& c : iface.constants) {
+        w.str(c.name);
+        w.str(c.type);
+        w.i64(c.value);
+    }
+
+    w.u32(static_cast<std::uint32_t>(iface.generics.size()));
+    for (const auto& g : iface.generics) {
+        w.str(g.name);
+        w.str(g.source);
+    }
+    return w.out;
+}
+
+bool deserialize_interface(const std::string& bytes, ModuleInterface& iface, std::string& error) {
+    if (bytes.size() < sizeof(interface_magic) || bytes.compare(0, sizeof(interface_magic), interface_magic, sizeof(interface_magic)) != 0) {
+        error = "not a ManiT interface file";
+        return false;
+    }
+    Reader r(bytes, sizeof(interface_magic));
+    std::uint32_t version, count;
+    if (!r.u32(version) || version != interface_version) {
+        error = "unsupported interface version";
+        return false;
+    }
+
+    iface = ModuleInterface();
+    bool ok = r.str(iface.module_name) && r.u32(count);
+    for (std::uint32_t i = 0; ok && i < count; ++i) {
+        FunctionSignature f;
+        std::uint32_t params;
+        ok = r.str(f.name) && r.u32(params);
+        for (std::uint32_t p = 0; ok && p < params; ++p) {
+            std::string type;
+            ok = r.str(type);
+            f.param_types.push_back(type);
+        }
+        ok = ok && r.str(f.return_type);
+        iface.functions.push_back(f);
+    }
+
+    ok = ok && r.u32(count);
+    for (std::uint32_t i = 0; ok && i < count; ++i) {
+        StructLayout s;
+        std::uint32_t fields;
+        ok = r.str(s.name) && r.u32(fields);
+        for (std::uint32_t f = 0; ok && f < fields; ++f) {
+            std::string name, type;
+            ok = r.str(name) && r.str(type);
+            s.fields.emplace_back(name, type);
+        }
+        iface.structs.push_back(s);
+    }
+
+    ok = ok && r.u32(count);
+    for (std::uint32_t i = 0; ok && i < count; ++i) {
+        ConstantValue c;
+        ok = r.str(c.name) && r.str(c.type) && r.i64(c.value);
+        iface.constants.push_back(c);
+    }
+
+    ok = ok && r.u32(count);
+    for (std::uint32_t i = 0; ok && i < count; ++i) {
+        GenericFunction g;
+        ok = r.str(g.name) && r.str(g.source);
+        iface.generics.push_back(g);
+    }
+
+    if (!ok || !r.at_end()) {
+        error = "truncated or corrupt interface file";
+        return false;
+    }
+    return true;
+}
+
+bool read_interface(const std::string& path, ModuleInterface& iface, std::string& error) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) {
+        error = "could not open '" + path + "'";
+        return false;
+    }
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    if (!deserialize_interface(buffer.str(), iface, error)) {
+        error = "'" + path + "': " + error;
+        return false;
+    }
+    return true;
+}
+
+bool write_interface_if_changed(const std::string& path, const ModuleInterface& iface, bool& changed, std::string& error) {
+    std::string bytes = serialize_interface(iface);
+    {
+        std::ifstream existing(path, std::ios::binary);
+        if (existing.is_open()) {
+            std::stringstream buffer;
+            buffer << existing.rdbuf();
+            if (buffer.str() == bytes) {
+                changed = false;
+                return true;
+            }
+        }
+    }
+
+    // Write to a temporary and rename so a concurrent importer never sees a
+    // partially written summary.
+    std::string temp_path = path + ".tmp";
+    {
+        std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+        if (!out.is_open() || !out.write(bytes.data(), bytes.size())) {
+            error = "could not write '" + temp_path + "'";
+            return false;
+        }
+    }
+    if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        std::remove(temp_path.c_str());
+        error = "could not replace '" + path + "'";
+        return false;
+    }
+    changed = true;
+    return true;
+}
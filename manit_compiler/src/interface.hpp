@@ -0,0 +1,73 @@
+#ifndef MANIT_INTERFACE_HPP
+#define MANIT_INTERFACE_HPP
+
+#include "ast.hpp"
+#include <string>
+#include <utility>
+#include <vector>
+
+// Module interface summaries (.mti files).
+//
+// A summary lists what a module exports with `pub`: function signatures,
+// struct layouts and compile-time constants. Modules that `import` it are
+// compiled against the summary alone and never re-parse its source, except
+// for generic functions: those are instantiated by the importer, so the
+// summary carries their source text.
+
+struct FunctionSignature {
+    std::string name; // Also the link-time symbol
+    std::vector<std::string> param_types;
+    std::string return_type;
+};
+
+struct GenericFunction {
+    std::string name;
+    std::string source; // The `fn<...>(...) { ... }` literal as written
+};
+
+struct StructLayout {
+    std::string name;
+    std::vector<std::pair<std::string, std::string>> fields; // (name, type) in layout order
+};
+
+struct ConstantValue {
+    std::string name;
+    std::string type; // "i32" or "bool"
+    long long value = 0;
+};
+
+struct ModuleInterface {
+    std::string module_name;
+    std::vector<FunctionSignature> functions;
+    std::vector<StructLayout> structs;
+    std::vector<ConstantValue> constants;
+    std::vector<GenericFunction> generics;
+};
+
+// Module name for a source or interface path: the file name without its
+// directory and extension.
+std::string module_name_for_path(const std::string& path);
+
+// Evaluates an integer or boolean expression built from literals, unary minus,
+// + - * / and the wrapping +% -% *%. Returns false if expr is not a
+// compile-time constant, if a literal does not fit in i32 (2147483648 only
+// as the operand of unary minus), or if it overflows i32 other than by
+// wrapping.
+bool fold_constant(const Expression& expr, std::string& type, long long& value);
+
+// Collects the `pub` declarations at the top level of program, which was
+// parsed from source. Entries are sorted by name so reordering definitions
+// does not change the summary.
+ModuleInterface collect_interface(const Program& program, const std::string& module_name, const std::string& source);
+
+std::string serialize_interface(const ModuleInterface& iface);
+bool deserialize_interface(const std::string& bytes, ModuleInterface& iface, std::string& error);
+
+bool read_interface(const std::string& path, ModuleInterface& iface, std::string& error);
+
+// Writes the summary to path unless the file already holds identical bytes.
+// An unchanged interface keeps its timestamp, so build tools that track the
+// .mti do not rebuild dependents when only a function body changed.
+bool write_interface_if_changed(const std::string& path, const ModuleInterface& iface, bool& changed, std::string& error);
+
+#endif // MANIT_INTERFACE_HPP
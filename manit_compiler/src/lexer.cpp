@@ -1,5 +1,7 @@
 #include "lexer.hpp"
-#include <map>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 // Helper functions
 bool is_letter(char ch) {
@@ -10,15 +12,33 @@ bool is_digit(char ch) {
     return '0' <= ch && ch <= '9';
 }
 
-// Map of keywords to their corresponding token types
-std::map<std::string, TokenType> keywords = {
+static const std::pair<const char*, TokenType> keyword_spellings[] = {
     {"fn", TokenType::FN},       {"let", TokenType::LET},   {"var", TokenType::VAR},
     {"if", TokenType::IF},       {"else", TokenType::ELSE}, {"while", TokenType::WHILE},
     {"for", TokenType::FOR},     {"return", TokenType::RETURN}, {"true", TokenType::TRUE},
-    {"false", TokenType::FALSE}, {"struct", TokenType::STRUCT},
+    {"false", TokenType::FALSE}, {"struct", TokenType::STRUCT}, {"import", TokenType::IMPORT},
+    {"pub", TokenType::PUB},     {"async", TokenType::ASYNC}, {"await", TokenType::AWAIT},
+    {"match", TokenType::MATCH},
 };
 
+// Token type of every keyword, indexed by its symbol (IDENTIFIER elsewhere).
+// Keywords are interned by the first Lexer, so they get the lowest ids and
+// classifying an identifier is one bounds-checked index.
+static const std::vector<TokenType>& keyword_types() {
+    static const std::vector<TokenType> table = [] {
+        std::vector<TokenType> types;
+        for (const auto& keyword : keyword_spellings) {
+            Symbol symbol = intern(keyword.first);
+            if (symbol >= types.size()) types.resize(symbol + 1, TokenType::IDENTIFIER);
+            types[symbol] = keyword.second;
+        }
+        return types;
+    }();
+    return table;
+}
+
 Lexer::Lexer(std::string input) : input(input), position(0), read_position(0), ch(0) {
+    keyword_types();
     read_char();
 }
 
@@ -47,15 +67,20 @@ void Lexer::skip_whitespace() {
 
 Token Lexer::read_identifier() {
     size_t start_pos = position;
-    while (is_letter(ch)) {
+    // Digits may follow the first letter, as in `i32` or `vec2`.
+    while (is_letter(ch) || is_digit(ch)) {
         read_char();
     }
-    std::string literal = input.substr(start_pos, position - start_pos);
+    std::string_view text = std::string_view(input).substr(start_pos, position - start_pos);
+    auto cached = symbols.find(text);
+    Symbol symbol = cached != symbols.end() ? cached->second : symbols.emplace(text, intern(text)).first->second;
+    auto offset = static_cast<std::uint32_t>(start_pos);
 
-    if (keywords.count(literal)) {
-        return {keywords[literal], literal};
+    const std::vector<TokenType>& types = keyword_types();
+    if (symbol < types.size() && types[symbol] != TokenType::IDENTIFIER) {
+        return {types[symbol], symbol_name(symbol), offset, symbol};
     }
-    return {TokenType::IDENTIFIER, literal};
+    return {TokenType::IDENTIFIER, std::string(), offset, symbol};
 }
 
 Token Lexer::read_number() {
@@ -63,28 +88,45 @@ Token Lexer::read_number() {
     while (is_digit(ch)) {
         read_char();
     }
-    return {TokenType::INTEGER_LITERAL, input.substr(start_pos, position - start_pos)};
+    return {TokenType::INTEGER_LITERAL, input.substr(start_pos, position - start_pos), static_cast<std::uint32_t>(start_pos)};
 }
 
 Token Lexer::next_token() {
     Token tok;
 
     skip_whitespace();
+    const size_t start_pos = position;
 
     switch (ch) {
         case '=':
             if (peek_char() == '=') {
                 read_char();
                 tok = {TokenType::EQUAL_EQUAL, "=="};
+            } else if (peek_char() == '>') {
+                read_char();
+                tok = {TokenType::FAT_ARROW, "=>"};
             } else {
                 tok = {TokenType::EQUAL, "="};
             }
             break;
         case '+':
-            tok = {TokenType::PLUS, "+"};
+            if (peek_char() == '%') {
+                read_char();
+                tok = {TokenType::PLUS_PERCENT, "+%"};
+            } else {
+                tok = {TokenType::PLUS, "+"};
+            }
             break;
         case '-':
-            tok = {TokenType::MINUS, "-"};
+            if (peek_char() == '>') {
+                read_char();
+                tok = {TokenType::ARROW, "->"};
+            } else if (peek_char() == '%') {
+                read_char();
+                tok = {TokenType::MINUS_PERCENT, "-%"};
+            } else {
+                tok = {TokenType::MINUS, "-"};
+            }
             break;
         case '!':
             if (peek_char() == '=') {
@@ -95,7 +137,15 @@ Token Lexer::next_token() {
             }
             break;
         case '*':
-            tok = {TokenType::STAR, "*"};
+            if (peek_char() == '%') {
+                read_char();
+                tok = {TokenType::STAR_PERCENT, "*%"};
+            } else {
+                tok = {TokenType::STAR, "*"};
+            }
+            break;
+        case '&':
+            tok = {TokenType::AMPERSAND, "&"};
             break;
         case '/':
             if (peek_char() == '/') { // Handle comments
@@ -150,6 +200,28 @@ Token Lexer::next_token() {
         case ',':
             tok = {TokenType::COMMA, ","};
             break;
+        case '.':
+            if (peek_char() == '.') {
+                read_char();
+                if (peek_char() == '=') {
+                    read_char();
+                    tok = {TokenType::DOT_DOT_EQUAL, "..="};
+                } else {
+                    tok = {TokenType::DOT_DOT, ".."};
+                }
+            } else {
+                tok = {TokenType::DOT, "."};
+            }
+            break;
+        case '@':
+            // `@name` names a builtin; keywords are not reserved after '@'.
+            if (is_letter(peek_char())) {
+                read_char();
+                Token name = read_identifier();
+                return {TokenType::BUILTIN, std::string(), static_cast<std::uint32_t>(start_pos), name.symbol};
+            }
+            tok = {TokenType::ILLEGAL, "@"};
+            break;
         case 0:
             tok = {TokenType::END_OF_FILE, ""};
             break;
@@ -163,6 +235,7 @@ Token Lexer::next_token() {
             }
     }
 
+    tok.offset = static_cast<std::uint32_t>(start_pos);
     read_char();
     return tok;
 }
\ No newline at end of file
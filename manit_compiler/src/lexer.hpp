@@ -3,6 +3,8 @@
 
 #include "token.hpp"
 #include <string>
+#include <string_view>
+#include <unordered_map>
 
 class Lexer {
 public:
@@ -10,6 +12,9 @@ public:
     Token next_token();
 private:
     std::string input;
+    // Symbols already seen in this input, so repeated identifiers skip the
+    // shared interner. Keys view into input.
+    std::unordered_map<std::string_view, Symbol> symbols;
     size_t position;
     size_t read_position;
     char ch;
@@ -0,0 +1,249 @@
+#include "lto.hpp"
+#include "target.hpp"
+#include <llvm/ADT/StringSet.h>
+#include <llvm/BinaryFormat/Magic.h>
+#include <llvm/IR/DiagnosticInfo.h>
+#include <llvm/IR/DiagnosticPrinter.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/LTO/LTO.h>
+#include <llvm/Object/Archive.h>
+#include <llvm/Object/SymbolicFile.h>
+#include <llvm/Support/Caching.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Program.h>
+#include <llvm/Support/Threading.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Target/TargetMachine.h>
+#include <llvm/TargetParser/Host.h>
+#include <map>
+#include <mutex>
+#include <optional>
+
+bool is_bitcode_file(const std::string& path) {
+    llvm::file_magic magic;
+    return !llvm::identify_magic(path, magic) && magic == llvm::file_magic::bitcode;
+}
+
+static bool visible_outside_bitcode(llvm::StringRef name, const CodeGenOptions& options) {
+    return name == (options.freestanding ? options.entry_symbol : "main") || name.starts_with("__manit_") || name.starts_with("__llvm_");
+}
+
+// Adds the symbols file leaves undefined to references.
+static bool add_undefined_symbols(llvm::MemoryBufferRef file, llvm::LLVMContext& context, llvm::StringSet<>& references) {
+    auto symbols = llvm::object::SymbolicFile::createSymbolicFile(file, llvm::file_magic::unknown, &context);
+    if (!symbols) {
+        llvm::consumeError(symbols.takeError());
+        return false;
+    }
+    for (const llvm::object::BasicSymbolRef& symbol : (*symbols)->symbols()) {
+        llvm::Expected<uint32_t> flags = symbol.getFlags();
+        if (!flags) {
+            llvm::consumeError(flags.takeError());
+            return false;
+        }
+        if (!(*flags & llvm::object::BasicSymbolRef::SF_Undefined)) continue;
+        std::string name;
+        llvm::raw_string_ostream stream(name);
+        if (llvm::Error e = symbol.printName(stream)) {
+            llvm::consumeError(std::move(e));
+            return false;
+        }
+        references.insert(stream.str());
+    }
+    return true;
+}
+
+// Collects the symbols the native inputs (objects, shared libraries and
+// archive members) reference without defining; bitcode definitions of them
+// must stay visible to the final link. Returns false if an input's symbol
+// table cannot be read.
+static bool native_references(const std::vector<std::string>& inputs, llvm::StringSet<>& references) {
+    llvm::LLVMContext context; // For bitcode archive members
+    for (const auto& input : inputs) {
+        auto buffer = llvm::MemoryBuffer::getFile(input);
+        if (!buffer) return false;
+        llvm::MemoryBufferRef file = (*buffer)->getMemBufferRef();
+        if (llvm::identify_magic(file.getBuffer()) != llvm::file_magic::archive) {
+            if (!add_undefined_symbols(file, context, references)) return false;
+            continue;
+        }
+        auto archive = llvm::object::Archive::create(file);
+        if (!archive) {
+            llvm::consumeError(archive.takeError());
+            return false;
+        }
+        llvm::Error error = llvm::Error::success();
+        for (const llvm::object::Archive::Child& child : (*archive)->children(error)) {
+            auto member = child.getMemoryBufferRef();
+            if (!member) {
+                llvm::consumeError(member.takeError());
+                llvm::consumeError(std::move(error));
+                return false;
+            }
+            if (!add_undefined_symbols(*member, context, references)) {
+                llvm::consumeError(std::move(error));
+                return false;
+            }
+        }
+        if (error) {
+            llvm::consumeError(std::move(error));
+            return false;
+        }
+    }
+    return true;
+}
+
+// Which input defines each symbol: its strong definition, or failing that
+// the first weak one (linkonce_odr generic instances, for example). Two
+// strong definitions of one symbol are an error, as with a native linker.
+static bool choose_prevailing(const std::vector<std::unique_ptr<llvm::lto::InputFile>>& files, const std::vector<std::string>& paths,
+                              std::map<std::string, size_t>& prevailing, std::ostream& err) {
+    std::map<std::string, std::pair<size_t, bool>> chosen; // Name -> (input, weak)
+    bool ok = true;
+    for (size_t i = 0; i < files.size(); ++i) {
+        for (const auto& symbol : files[i]->symbols()) {
+            if (symbol.isUndefined()) continue;
+            bool weak = symbol.isWeak() || symbol.isCommon();
+            auto inserted = chosen.emplace(symbol.getName().str(), std::make_pair(i, weak));
+            if (inserted.second) continue;
+            if (inserted.first->second.second) {
+                if (!weak) inserted.first->second = {i, false};
+            } else if (!weak) {
+                err << "Error: Duplicate symbol '" << symbol.getName().str() << "' defined in '" << paths[inserted.first->second.first]
+                    << "' and '" << paths[i] << "'" << std::endl;
+                ok = false;
+            }
+        }
+    }
+    for (const auto& entry : chosen) prevailing[entry.first] = entry.second.first;
+    return ok;
+}
+
+int lto_link(const std::vector<std::string>& inputs, const std::string& output_path, const std::string& linker,
+             const std::vector<std::string>& linker_args, const CodeGenOptions& options, unsigned jobs, std::ostream& err) {
+    std::string error;
+    if (!create_target_machine(options, error)) {
+        err << "Error: " << error << std::endl;
+        return 1;
+    }
+
+    std::mutex err_mutex; // ThinLTO backends report from their own threads
+    llvm::lto::Config config;
+    config.OptLevel = options.opt_level;
+    config.CGOptLevel = options.opt_level == 0 ? llvm::CodeGenOptLevel::None
+                      : options.opt_level == 3 ? llvm::CodeGenOptLevel::Aggressive
+                                               : llvm::CodeGenOptLevel::Default;
+    config.RelocModel = llvm::Reloc::PIC_;
+    config.CPU = options.target_cpu;
+    llvm::SmallVector<llvm::StringRef, 8> features;
+    llvm::StringRef(options.target_features).split(features, ',', -1, false);
+    for (llvm::StringRef feature : features) config.MAttrs.push_back(feature.str());
+    config.DefaultTriple = llvm::sys::getDefaultTargetTriple();
+    config.DiagHandler = [&err, &err_mutex](const llvm::DiagnosticInfo& info) {
+        std::string message;
+        llvm::raw_string_ostream stream(message);
+        llvm::DiagnosticPrinterRawOStream printer(stream);
+        info.print(printer);
+        stream.flush();
+        std::lock_guard<std::mutex> lock(err_mutex);
+        err << (info.getSeverity() == llvm::DS_Error ? "Error: " : "Warning: ") << message << std::endl;
+    };
+    llvm::lto::LTO lto(std::move(config), llvm::lto::createInProcessThinBackend(llvm::heavyweight_hardware_concurrency(jobs)));
+
+    std::vector<std::unique_ptr<llvm::MemoryBuffer>> buffers; // Must outlive the link
+    std::vector<std::unique_ptr<llvm::lto::InputFile>> files;
+    std::vector<std::string> bitcode_inputs; // Parallel to files
+    std::vector<std::string> native_inputs;
+    for (const auto& input : inputs) {
+        if (!is_bitcode_file(input)) {
+            native_inputs.push_back(input);
+            continue;
+        }
+        auto buffer = llvm::MemoryBuffer::getFile(input);
+        if (!buffer) {
+            err << "Error: Could not read '" << input << "': " << buffer.getError().message() << std::endl;
+            return 1;
+        }
+        auto file = llvm::lto::InputFile::create((*buffer)->getMemBufferRef());
+        if (!file) {
+            err << "Error: '" << input << "': " << llvm::toString(file.takeError()) << std::endl;
+            return 1;
+        }
+        buffers.push_back(std::move(*buffer));
+        files.push_back(std::move(*file));
+        bitcode_inputs.push_back(input);
+    }
+
+    // A bitcode definition that a native input calls must survive
+    // internalization. If some native input's symbols cannot be read, every
+    // external definition is kept instead.
+    llvm::StringSet<> references;
+    bool keep_external = !native_references(native_inputs, references);
+
+    std::map<std::string, size_t> prevailing;
+    if (!choose_prevailing(files, bitcode_inputs, prevailing, err)) return 1;
+    for (size_t i = 0; i < files.size(); ++i) {
+        std::vector<llvm::lto::SymbolResolution> resolutions;
+        for (const auto& symbol : files[i]->symbols()) {
+            llvm::lto::SymbolResolution resolution;
+            auto chosen = prevailing.find(symbol.getName().str());
+            resolution.Prevailing = !symbol.isUndefined() && chosen != prevailing.end() && chosen->second == i;
+            resolution.FinalDefinitionInLinkageUnit = chosen != prevailing.end();
+            resolution.VisibleToRegularObj =
+                keep_external || references.contains(symbol.getName()) || visible_outside_bitcode(symbol.getName(), options);
+            resolutions.push_back(resolution);
+        }
+        if (llvm::Error e = lto.add(std::move(files[i]), resolutions)) {
+            err << "Error: " << llvm::toString(std::move(e)) << std::endl;
+            return 1;
+        }
+    }
+
+    // Each task (the merged module, then one per ThinLTO module) produces an object.
+    std::vector<llvm::SmallString<0>> objects(lto.getMaxTasks());
+    auto add_stream = [&objects](unsigned task, const llvm::Twine&) -> llvm::Expected<std::unique_ptr<llvm::CachedFileStream>> {
+        return std::make_unique<llvm::CachedFileStream>(std::make_unique<llvm::raw_svector_ostream>(objects[task]));
+    };
+    if (llvm::Error e = lto.run(add_stream)) {
+        err << "Error: " << llvm::toString(std::move(e)) << std::endl;
+        return 1;
+    }
+
+    std::vector<std::string> object_paths;
+    auto remove_objects = [&object_paths]() {
+        for (const auto& path : object_paths) llvm::sys::fs::remove(path);
+    };
+    for (const auto& object : objects) {
+        if (object.empty()) continue;
+        int fd;
+        llvm::SmallString<128> path;
+        if (std::error_code ec = llvm::sys::fs::createTemporaryFile("manit-lto", "o", fd, path)) {
+            err << "Error: Could not create a temporary object: " << ec.message() << std::endl;
+            remove_objects();
+            return 1;
+        }
+        object_paths.push_back(path.str().str());
+        llvm::raw_fd_ostream out(fd, true);
+        out << object.str();
+    }
+
+    auto program = llvm::sys::findProgramByName(linker);
+    if (!program) {
+        err << "Error: Could not find linker '" << linker << "'" << std::endl;
+        remove_objects();
+        return 1;
+    }
+    std::vector<llvm::StringRef> args = {*program, "-o", output_path};
+    for (const auto& path : object_paths) args.push_back(path);
+    for (const auto& path : native_inputs) args.push_back(path);
+    for (const auto& arg : linker_args) args.push_back(arg);
+    std::string message;
+    int status = llvm::sys::ExecuteAndWait(*program, args, std::nullopt, {}, 0, 0, &message);
+    remove_objects();
+    if (status != 0) {
+        err << "Error: Linker '" << linker << "' failed" << (message.empty() ? "" : ": " + message) << std::endl;
+        return 1;
+    }
+    return 0;
+}
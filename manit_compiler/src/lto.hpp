@@ -0,0 +1,32 @@
+#ifndef MANIT_LTO_HPP
+#define MANIT_LTO_HPP
+
+#include "codegen.hpp"
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Link-time optimization (-flto=full|thin).
+//
+// With -flto a compile writes bitcode that carries a module summary instead
+// of textual IR (CodeGenerator::write_bitcode). lto_link() then optimizes
+// those modules, and any other LLVM bitcode such as a C runtime built with
+// `clang -flto`, as one program, so helpers defined in one module inline
+// into callers in another. Full LTO merges everything into one module;
+// ThinLTO keeps the modules apart and runs one backend per module on a
+// thread pool, importing only what the summaries say is worth inlining.
+
+// True if path holds LLVM bitcode.
+bool is_bitcode_file(const std::string& path);
+
+// Links inputs into the executable output_path. Bitcode inputs go through
+// LTO in-process and become native objects; those and every other input
+// (objects, archives) are then passed to linker, a compiler driver, followed
+// by linker_args. Only `main` (the entry symbol with --freestanding),
+// runtime entry points (`__manit_*`, `__llvm_*`) and the symbols the native
+// inputs reference stay visible outside the bitcode; everything else is
+// internalized.
+int lto_link(const std::vector<std::string>& inputs, const std::string& output_path, const std::string& linker,
+             const std::vector<std::string>& linker_args, const CodeGenOptions& options, unsigned jobs, std::ostream& err);
+
+#endif // MANIT_LTO_HPP
@@ -1,43 +1,29 @@
 #include <iostream>
 #include <string>
 #include <vector>
-#include <fstream>
-#include <sstream>
-#include "lexer.hpp"
-#include "parser.hpp"
-#include "codegen.hpp"
+#include "driver.hpp"
+#include "server.hpp"
 
 int main(int argc, char* argv[]) {
-    if (argc != 2) {
-        std::cerr << "Usage: " << argv[0] << " <filename.manit>" << std::endl;
+    std::vector<std::string> args(argv + 1, argv + argc);
+    DriverOptions options;
+    if (!parse_command_line(args, options, std::cerr)) {
+        print_usage(std::cerr, argv[0]);
         return 1;
     }
 
-    std::ifstream file(argv[1]);
-    if (!file.is_open()) {
-        std::cerr << "Error: Could not open file '" << argv[1] << "'" << std::endl;
-        return 1;
-    }
-
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    std::string source_code = buffer.str();
-    
-    if (source_code.empty()) {
-        std::cerr << "Warning: Input file '" << argv[1] << "' is empty." << std::endl;
+    if (!options.server_socket.empty()) {
+        if (!options.inputs.empty()) {
+            std::cerr << "Error: --server does not take input files" << std::endl;
+            return 1;
+        }
+        return run_server(options, std::cerr);
     }
 
-    Lexer l(source_code);
-    Parser p(l);
-    auto program = p.parse_program();
-
-    if (!program) {
-        std::cerr << "Error: Parsing failed. Please check the source code for syntax errors." << std::endl;
+    if (options.inputs.empty()) {
+        print_usage(std::cerr, argv[0]);
         return 1;
     }
 
-    CodeGenerator codegen;
-    codegen.generate(*program);
-
-    return 0;
-}
\ No newline at end of file
+    return run_compilations(options, std::cerr);
+}
@@ -0,0 +1,51 @@
+#include "noalias.hpp"
+#include <llvm/Analysis/AliasAnalysis.h>
+#include <llvm/Analysis/ValueTracking.h>
+#include <llvm/IR/InstrTypes.h>
+#include <llvm/IR/Module.h>
+
+// True if the pointer passed as argument arg_no of call is based on an
+// identified local object that no other pointer argument of the call is.
+static bool passes_distinct_object(const llvm::CallBase& call, unsigned arg_no) {
+    const llvm::Value* object = llvm::getUnderlyingObject(call.getArgOperand(arg_no));
+    if (!llvm::isIdentifiedFunctionLocal(object)) return false;
+    for (unsigned i = 0; i < call.arg_size(); ++i) {
+        const llvm::Value* operand = call.getArgOperand(i);
+        if (i == arg_no || !operand->getType()->isPointerTy()) continue;
+        const llvm::Value* other = llvm::getUnderlyingObject(operand);
+        if (other == object || !llvm::isIdentifiedFunctionLocal(other)) return false;
+    }
+    return true;
+}
+
+static bool only_called_directly(const llvm::Function& function) {
+    if (function.use_empty()) return false;
+    for (const llvm::Use& use : function.uses()) {
+        auto const* call = llvm::dyn_cast<llvm::CallBase>(use.getUser());
+        if (!call || !call->isCallee(&use)) return false;
+    }
+    return true;
+}
+
+void infer_noalias_parameters(llvm::Module& module) {
+    // A parameter marked noalias makes it an identified object inside its
+    // function, which can in turn prove the calls made from there.
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (llvm::Function& function : module) {
+            // A coroutine keeps using its arguments after the call returns.
+            if (function.isDeclaration() || !function.hasLocalLinkage() || function.isPresplitCoroutine() || !only_called_directly(function)) continue;
+            for (llvm::Argument& arg : function.args()) {
+                if (!arg.getType()->isPointerTy() || arg.hasNoAliasAttr()) continue;
+                bool proven = true;
+                for (const llvm::Use& use : function.uses()) {
+                    proven = proven && passes_distinct_object(*llvm::cast<llvm::CallBase>(use.getUser()), arg.getArgNo());
+                }
+                if (!proven) continue;
+                arg.addAttr(llvm::Attribute::NoAlias);
+                changed = true;
+            }
+        }
+    }
+}
@@ -0,0 +1,17 @@
+#ifndef MANIT_NOALIAS_HPP
+#define MANIT_NOALIAS_HPP
+
+namespace llvm {
+    class Module;
+}
+
+// Marks pointer parameters of internal functions noalias where every call
+// site proves it: the argument points into a local (or noalias) object that no
+// other pointer argument of the same call is based on. ManiT functions reach
+// memory only through their parameters and top-level globals, and globals
+// never hold pointers, so a local is out of reach of the callee otherwise.
+// This is all the optimizer needs to vectorize loops that read one slice and
+// write another.
+void infer_noalias_parameters(llvm::Module& module);
+
+#endif // MANIT_NOALIAS_HPP
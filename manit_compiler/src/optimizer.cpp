@@ -0,0 +1,56 @@
+#include "optimizer.hpp"
+#include "target.hpp"
+#include <llvm/IR/Module.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Support/PGOOptions.h>
+#include <llvm/Support/VirtualFileSystem.h>
+#include <llvm/Target/TargetMachine.h>
+#include <optional>
+
+static llvm::OptimizationLevel to_optimization_level(unsigned level) {
+    switch (level) {
+        case 0: return llvm::OptimizationLevel::O0;
+        case 1: return llvm::OptimizationLevel::O1;
+        case 2: return llvm::OptimizationLevel::O2;
+        default: return llvm::OptimizationLevel::O3;
+    }
+}
+
+static std::optional<llvm::PGOOptions> make_pgo_options(const CodeGenOptions& options) {
+    if (options.profile_generate) {
+        return llvm::PGOOptions(options.profile_generate_path, "", "", "", llvm::vfs::getRealFileSystem(),
+                                llvm::PGOOptions::IRInstr);
+    }
+    if (!options.profile_use_path.empty()) {
+        return llvm::PGOOptions(options.profile_use_path, "", "", "", llvm::vfs::getRealFileSystem(),
+                                llvm::PGOOptions::IRUse);
+    }
+    return std::nullopt;
+}
+
+void optimize_module(llvm::Module& module, const CodeGenOptions& options) {
+    llvm::LoopAnalysisManager lam;
+    llvm::FunctionAnalysisManager fam;
+    llvm::CGSCCAnalysisManager cgam;
+    llvm::ModuleAnalysisManager mam;
+
+    // The target machine gives the vectorizer and unroller the CPU's real
+    // costs and register widths; without it they assume a generic target.
+    std::string error;
+    std::unique_ptr<llvm::TargetMachine> machine = create_target_machine(options, error);
+    llvm::PassBuilder pass_builder(machine.get(), llvm::PipelineTuningOptions(), make_pgo_options(options));
+    pass_builder.registerModuleAnalyses(mam);
+    pass_builder.registerCGSCCAnalyses(cgam);
+    pass_builder.registerFunctionAnalyses(fam);
+    pass_builder.registerLoopAnalyses(lam);
+    pass_builder.crossRegisterProxies(lam, fam, cgam, mam);
+
+    // With LTO only the pre-link half runs here; the link finishes the job.
+    llvm::OptimizationLevel level = to_optimization_level(options.opt_level);
+    llvm::ModulePassManager mpm;
+    if (level == llvm::OptimizationLevel::O0) mpm = pass_builder.buildO0DefaultPipeline(level, options.lto != LTOMode::None);
+    else if (options.lto == LTOMode::Full) mpm = pass_builder.buildLTOPreLinkDefaultPipeline(level);
+    else if (options.lto == LTOMode::Thin) mpm = pass_builder.buildThinLTOPreLinkDefaultPipeline(level);
+    else mpm = pass_builder.buildPerModuleDefaultPipeline(level);
+    mpm.run(module, mam);
+}
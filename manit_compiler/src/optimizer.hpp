@@ -0,0 +1,17 @@
+#ifndef MANIT_OPTIMIZER_HPP
+#define MANIT_OPTIMIZER_HPP
+
+#include "codegen.hpp"
+
+namespace llvm {
+    class Module;
+}
+
+// Runs LLVM's default pass pipeline for options.opt_level over the module.
+// With profile_generate the pipeline inserts IR-level PGO counters on the
+// function CFGs; with profile_use it attaches the profile's branch weights
+// and function entry counts before inlining, block layout and unrolling.
+// With options.lto it runs the (Thin)LTO pre-link pipeline instead.
+void optimize_module(llvm::Module& module, const CodeGenOptions& options);
+
+#endif // MANIT_OPTIMIZER_HPP
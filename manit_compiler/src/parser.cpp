@@ -15,8 +15,12 @@ Parser::Parser(Lexer& l) : lexer(l) {
         {TokenType::MINUS, Precedence::SUM},
         {TokenType::SLASH, Precedence::PRODUCT},
         {TokenType::STAR, Precedence::PRODUCT},
+        {TokenType::PLUS_PERCENT, Precedence::SUM},
+        {TokenType::MINUS_PERCENT, Precedence::SUM},
+        {TokenType::STAR_PERCENT, Precedence::PRODUCT},
         {TokenType::LPAREN, Precedence::CALL},
         {TokenType::LBRACKET, Precedence::INDEX},
+        {TokenType::DOT, Precedence::INDEX},
     };
     next_token();
     next_token();
@@ -55,6 +59,13 @@ std::unique_ptr<Statement> Parser::parse_statement() {
             return parse_var_statement();
         case TokenType::STRUCT:
             return parse_struct_definition_statement();
+        case TokenType::IMPORT:
+            return parse_import_statement();
+        case TokenType::PUB:
+            return parse_public_declaration();
+        case TokenType::BUILTIN:
+            if (is_annotation()) return parse_annotated_statement();
+            return parse_expression_statement();
         case TokenType::RETURN:
             return parse_return_statement();
         default:
@@ -71,19 +82,15 @@ std::unique_ptr<LetStatement> Parser::parse_let_statement() {
 
     auto ident = std::make_unique<Identifier>();
     ident->token = current_token;
-    ident->value = current_token.literal;
+    ident->symbol = current_token.symbol;
     stmt->name = std::move(ident);
 
     // Check for optional type annotation
     if (peek_token.type == TokenType::COLON) {
         next_token(); // Consume ':'
-        next_token(); // Consume type identifier
-        if (current_token.type != TokenType::IDENTIFIER) return nullptr;
-        
-        auto type_ident = std::make_unique<Identifier>();
-        type_ident->token = current_token;
-        type_ident->value = current_token.literal;
-        stmt->type = std::move(type_ident);
+        next_token(); // Move to the type
+        stmt->type = parse_type_annotation();
+        if (!stmt->type) return nullptr;
     }
 
     if (peek_token.type != TokenType::EQUAL) return nullptr;
@@ -104,19 +111,15 @@ std::unique_ptr<VarStatement> Parser::parse_var_statement() {
 
     auto ident = std::make_unique<Identifier>();
     ident->token = current_token;
-    ident->value = current_token.literal;
+    ident->symbol = current_token.symbol;
     stmt->name = std::move(ident);
 
     // Check for optional type annotation
     if (peek_token.type == TokenType::COLON) {
         next_token(); // Consume ':'
-        next_token(); // Consume type identifier
-        if (current_token.type != TokenType::IDENTIFIER) return nullptr;
-
-        auto type_ident = std::make_unique<Identifier>();
-        type_ident->token = current_token;
-        type_ident->value = current_token.literal;
-        stmt->type = std::move(type_ident);
+        next_token(); // Move to the type
+        stmt->type = parse_type_annotation();
+        if (!stmt->type) return nullptr;
     }
 
     if (peek_token.type != TokenType::EQUAL) return nullptr;
@@ -137,7 +140,7 @@ std::unique_ptr<StructDefinitionStatement> Parser::parse_struct_definition_state
     
     auto name = std::make_unique<Identifier>();
     name->token = current_token;
-    name->value = current_token.literal;
+    name->symbol = current_token.symbol;
     stmt->name = std::move(name);
 
     if (peek_token.type != TokenType::LBRACE) return nullptr;
@@ -149,7 +152,7 @@ std::unique_ptr<StructDefinitionStatement> Parser::parse_struct_definition_state
         if (current_token.type != TokenType::IDENTIFIER) return nullptr;
         auto first_field_name = std::make_unique<Identifier>();
         first_field_name->token = current_token;
-        first_field_name->value = current_token.literal;
+        first_field_name->symbol = current_token.symbol;
 
         if (peek_token.type != TokenType::COLON) return nullptr;
         next_token();
@@ -158,7 +161,7 @@ std::unique_ptr<StructDefinitionStatement> Parser::parse_struct_definition_state
         next_token();
         auto first_field_type = std::make_unique<Identifier>();
         first_field_type->token = current_token;
-        first_field_type->value = current_token.literal;
+        first_field_type->symbol = current_token.symbol;
         stmt->fields.push_back({std::move(first_field_name), std::move(first_field_type)});
 
         while (peek_token.type == TokenType::COMMA) {
@@ -168,7 +171,7 @@ std::unique_ptr<StructDefinitionStatement> Parser::parse_struct_definition_state
             if (current_token.type != TokenType::IDENTIFIER) return nullptr;
             auto next_field_name = std::make_unique<Identifier>();
             next_field_name->token = current_token;
-            next_field_name->value = current_token.literal;
+            next_field_name->symbol = current_token.symbol;
 
             if (peek_token.type != TokenType::COLON) return nullptr;
             next_token();
@@ -177,7 +180,7 @@ std::unique_ptr<StructDefinitionStatement> Parser::parse_struct_definition_state
             next_token();
             auto next_field_type = std::make_unique<Identifier>();
             next_field_type->token = current_token;
-            next_field_type->value = current_token.literal;
+            next_field_type->symbol = current_token.symbol;
             stmt->fields.push_back({std::move(next_field_name), std::move(next_field_type)});
         }
     }
@@ -190,6 +193,63 @@ std::unique_ptr<StructDefinitionStatement> Parser::parse_struct_definition_state
     return stmt;
 }
 
+std::unique_ptr<ImportStatement> Parser::parse_import_statement() {
+    auto stmt = std::make_unique<ImportStatement>();
+    stmt->token = current_token;
+
+    if (peek_token.type != TokenType::IDENTIFIER) return nullptr;
+    next_token();
+
+    auto name = std::make_unique<Identifier>();
+    name->token = current_token;
+    name->symbol = current_token.symbol;
+    stmt->module_name = std::move(name);
+
+    if (peek_token.type == TokenType::SEMICOLON) next_token();
+    return stmt;
+}
+
+// `pub` marks a let or struct declaration as part of the module interface.
+std::unique_ptr<Statement> Parser::parse_public_declaration() {
+    next_token();
+    if (current_token.type == TokenType::LET) {
+        auto stmt = parse_let_statement();
+        if (stmt) stmt->is_public = true;
+        return stmt;
+    }
+    if (current_token.type == TokenType::STRUCT) {
+        auto stmt = parse_struct_definition_statement();
+        if (stmt) stmt->is_public = true;
+        return stmt;
+    }
+    return nullptr;
+}
+
+// `@name ... let ...`, `@name ... var ...`, or an annotated function or match
+// as an expression statement; entered at the first annotation.
+std::unique_ptr<Statement> Parser::parse_annotated_statement() {
+    Token token = current_token;
+    std::vector<Annotation> annotations;
+    if (!parse_annotations(annotations)) return nullptr;
+    if (current_token.type == TokenType::LET) {
+        auto stmt = parse_let_statement();
+        if (stmt) stmt->annotations = std::move(annotations);
+        return stmt;
+    }
+    if (current_token.type == TokenType::VAR) {
+        auto stmt = parse_var_statement();
+        if (stmt) stmt->annotations = std::move(annotations);
+        return stmt;
+    }
+    auto stmt = std::make_unique<ExpressionStatement>();
+    stmt->token = token;
+    // An annotated match ends at its closing brace, like a plain one.
+    bool block_like = current_token.type == TokenType::MATCH;
+    stmt->expression = parse_operators(annotate_expression(std::move(annotations)), block_like ? Precedence::INDEX : Precedence::LOWEST);
+    if (peek_token.type == TokenType::SEMICOLON) next_token();
+    return stmt;
+}
+
 std::unique_ptr<ReturnStatement> Parser::parse_return_statement() {
     auto stmt = std::make_unique<ReturnStatement>();
     stmt->token = current_token;
@@ -202,7 +262,10 @@ std::unique_ptr<ReturnStatement> Parser::parse_return_statement() {
 std::unique_ptr<ExpressionStatement> Parser::parse_expression_statement() {
     auto stmt = std::make_unique<ExpressionStatement>();
     stmt->token = current_token;
-    stmt->expression = parse_expression(Precedence::LOWEST);
+    // Like a block, an if/match/while/for statement ends at its closing brace, so
+    // a following `*p = x` or `-x` starts a new statement instead of continuing it.
+    bool block_like = current_token.type == TokenType::IF || current_token.type == TokenType::MATCH || current_token.type == TokenType::WHILE || current_token.type == TokenType::FOR;
+    stmt->expression = parse_expression(block_like ? Precedence::INDEX : Precedence::LOWEST);
     if (peek_token.type == TokenType::SEMICOLON) next_token();
     return stmt;
 }
@@ -214,39 +277,253 @@ std::unique_ptr<Expression> Parser::parse_expression(Precedence precedence) {
         case TokenType::INTEGER_LITERAL: left_exp = parse_integer_literal(); break;
         case TokenType::TRUE: case TokenType::FALSE: left_exp = parse_boolean_literal(); break;
         case TokenType::LBRACKET: left_exp = parse_array_literal(); break;
-        case TokenType::BANG: case TokenType::MINUS: left_exp = parse_prefix_expression(); break;
+        case TokenType::LPAREN: left_exp = parse_grouped_expression(); break;
+        case TokenType::BANG: case TokenType::MINUS: case TokenType::STAR: case TokenType::AMPERSAND: left_exp = parse_prefix_expression(); break;
+        case TokenType::BUILTIN: left_exp = is_annotation() ? parse_annotated_expression() : parse_builtin_call(); break;
         case TokenType::IF: left_exp = parse_if_expression(); break;
+        case TokenType::MATCH: left_exp = parse_match_expression(); break;
         case TokenType::FN: left_exp = parse_function_literal(); break;
+        case TokenType::ASYNC: left_exp = parse_async_function_literal(); break;
+        case TokenType::AWAIT: left_exp = parse_await_expression(); break;
         case TokenType::WHILE: left_exp = parse_while_expression(); break;
         case TokenType::FOR: left_exp = parse_for_loop_expression(); break;
         default: return nullptr;
     }
+    return parse_operators(std::move(left_exp), precedence);
+}
 
+// Applies the calls, indexing, member accesses and binary operators that
+// follow left and bind tighter than precedence.
+std::unique_ptr<Expression> Parser::parse_operators(std::unique_ptr<Expression> left_exp, Precedence precedence) {
     while (peek_token.type != TokenType::SEMICOLON && precedence < peek_precedence()) {
         TokenType peek_type = peek_token.type;
         if (peek_type == TokenType::LPAREN) { next_token(); left_exp = parse_call_expression(std::move(left_exp)); }
         else if (peek_type == TokenType::LBRACKET) { next_token(); left_exp = parse_index_expression(std::move(left_exp)); }
+        else if (peek_type == TokenType::DOT) { next_token(); left_exp = parse_member_expression(std::move(left_exp)); }
         else if (peek_type == TokenType::EQUAL) { next_token(); left_exp = parse_assignment_expression(std::move(left_exp)); }
-        else if (peek_type == TokenType::PLUS || peek_type == TokenType::MINUS || peek_type == TokenType::SLASH || peek_type == TokenType::STAR || peek_type == TokenType::EQUAL_EQUAL || peek_type == TokenType::BANG_EQUAL || peek_type == TokenType::LESS || peek_type == TokenType::GREATER || peek_type == TokenType::LESS_EQUAL || peek_type == TokenType::GREATER_EQUAL) { next_token(); left_exp = parse_infix_expression(std::move(left_exp)); }
+        else if (peek_type == TokenType::PLUS || peek_type == TokenType::MINUS || peek_type == TokenType::SLASH || peek_type == TokenType::STAR || peek_type == TokenType::PLUS_PERCENT || peek_type == TokenType::MINUS_PERCENT || peek_type == TokenType::STAR_PERCENT || peek_type == TokenType::EQUAL_EQUAL || peek_type == TokenType::BANG_EQUAL || peek_type == TokenType::LESS || peek_type == TokenType::GREATER || peek_type == TokenType::LESS_EQUAL || peek_type == TokenType::GREATER_EQUAL) { next_token(); left_exp = parse_infix_expression(std::move(left_exp)); }
         else { return left_exp; }
     }
     return left_exp;
 }
 
-std::unique_ptr<Expression> Parser::parse_identifier() { auto ident = std::make_unique<Identifier>(); ident->token = current_token; ident->value = current_token.literal; return ident; }
+std::unique_ptr<Expression> Parser::parse_identifier() { if (peek_token.type == TokenType::LBRACE) return parse_struct_literal(); auto ident = std::make_unique<Identifier>(); ident->token = current_token; ident->symbol = current_token.symbol; return ident; }
 std::unique_ptr<Expression> Parser::parse_integer_literal() { auto literal = std::make_unique<IntegerLiteral>(); literal->token = current_token; const std::string& s = current_token.literal; auto result = std::from_chars(s.data(), s.data() + s.size(), literal->value); if (result.ec != std::errc() || result.ptr != s.data() + s.size()) return nullptr; return literal; }
 std::unique_ptr<Expression> Parser::parse_boolean_literal() { auto literal = std::make_unique<BooleanLiteral>(); literal->token = current_token; literal->value = (current_token.type == TokenType::TRUE); return literal; }
+std::unique_ptr<Expression> Parser::parse_grouped_expression() { next_token(); auto expr = parse_expression(Precedence::LOWEST); if (peek_token.type != TokenType::RPAREN) return nullptr; next_token(); return expr; }
 std::unique_ptr<Expression> Parser::parse_array_literal() { auto array_lit = std::make_unique<ArrayLiteral>(); array_lit->token = current_token; array_lit->elements = parse_expression_list(TokenType::RBRACKET); return array_lit; }
-std::unique_ptr<Expression> Parser::parse_index_expression(std::unique_ptr<Expression> left) { auto expr = std::make_unique<IndexExpression>(); expr->token = current_token; expr->left = std::move(left); next_token(); expr->index = parse_expression(Precedence::LOWEST); if (peek_token.type != TokenType::RBRACKET) return nullptr; next_token(); return expr; }
+// `left[index]`, or a slice `left[low:high]` with either bound optional.
+std::unique_ptr<Expression> Parser::parse_index_expression(std::unique_ptr<Expression> left) {
+    Token bracket = current_token;
+    next_token();
+    std::unique_ptr<Expression> index;
+    if (current_token.type != TokenType::COLON) {
+        index = parse_expression(Precedence::LOWEST);
+        if (!index) return nullptr;
+        if (peek_token.type == TokenType::COLON) next_token();
+    }
+    if (current_token.type != TokenType::COLON) {
+        if (peek_token.type != TokenType::RBRACKET) return nullptr;
+        next_token();
+        auto expr = std::make_unique<IndexExpression>(); expr->token = bracket; expr->left = std::move(left); expr->index = std::move(index);
+        return expr;
+    }
+    auto expr = std::make_unique<SliceExpression>(); expr->token = bracket; expr->left = std::move(left); expr->low = std::move(index);
+    if (peek_token.type != TokenType::RBRACKET) { next_token(); expr->high = parse_expression(Precedence::LOWEST); if (!expr->high) return nullptr; }
+    if (peek_token.type != TokenType::RBRACKET) return nullptr;
+    next_token();
+    return expr;
+}
 std::unique_ptr<Expression> Parser::parse_prefix_expression() { auto expr = std::make_unique<PrefixExpression>(); expr->token = current_token; expr->op = current_token.literal; next_token(); expr->right = parse_expression(Precedence::PREFIX); return expr; }
 std::unique_ptr<Expression> Parser::parse_infix_expression(std::unique_ptr<Expression> left) { auto expr = std::make_unique<InfixExpression>(); expr->token = current_token; expr->op = current_token.literal; expr->left = std::move(left); Precedence p = current_precedence(); next_token(); expr->right = parse_expression(p); return expr; }
-std::unique_ptr<Expression> Parser::parse_assignment_expression(std::unique_ptr<Expression> left) { auto ident_node = dynamic_cast<Identifier*>(left.get()); if (!ident_node) return nullptr; auto expr = std::make_unique<AssignmentExpression>(); expr->token = current_token; left.release(); expr->name = std::unique_ptr<Identifier>(ident_node); Precedence p = current_precedence(); next_token(); expr->value = parse_expression(p); return expr; }
+std::unique_ptr<Expression> Parser::parse_assignment_expression(std::unique_ptr<Expression> left) { auto const* deref = dynamic_cast<PrefixExpression*>(left.get()); if (!dynamic_cast<Identifier*>(left.get()) && !dynamic_cast<IndexExpression*>(left.get()) && !dynamic_cast<MemberExpression*>(left.get()) && !(deref && deref->op == "*")) return nullptr; auto expr = std::make_unique<AssignmentExpression>(); expr->token = current_token; expr->target = std::move(left); Precedence p = current_precedence(); next_token(); expr->value = parse_expression(p); return expr; }
 std::unique_ptr<BlockStatement> Parser::parse_block_statement() { auto block = std::make_unique<BlockStatement>(); block->token = current_token; next_token(); while (current_token.type != TokenType::RBRACE && current_token.type != TokenType::END_OF_FILE) { auto stmt = parse_statement(); if (stmt) block->statements.push_back(std::move(stmt)); next_token(); } return block; }
 std::vector<std::unique_ptr<Expression>> Parser::parse_expression_list(TokenType end_token) { std::vector<std::unique_ptr<Expression>> list; if (peek_token.type == end_token) { next_token(); return list; } next_token(); list.push_back(parse_expression(Precedence::LOWEST)); while (peek_token.type == TokenType::COMMA) { next_token(); next_token(); list.push_back(parse_expression(Precedence::LOWEST)); } if (peek_token.type != end_token) return {}; next_token(); return list; }
 std::vector<std::unique_ptr<Expression>> Parser::parse_call_arguments() { return parse_expression_list(TokenType::RPAREN); }
 std::unique_ptr<Expression> Parser::parse_call_expression(std::unique_ptr<Expression> function) { auto expr = std::make_unique<CallExpression>(); expr->token = current_token; expr->function = std::move(function); expr->arguments = parse_call_arguments(); return expr; }
+std::unique_ptr<Expression> Parser::parse_builtin_call() { auto expr = std::make_unique<BuiltinCall>(); expr->token = current_token; expr->name = current_token.symbol; if (peek_token.type != TokenType::LPAREN) return nullptr; next_token(); expr->arguments = parse_call_arguments(); return expr; }
 std::unique_ptr<Expression> Parser::parse_if_expression() { auto expr = std::make_unique<IfExpression>(); expr->token = current_token; if (peek_token.type != TokenType::LPAREN) return nullptr; next_token(); next_token(); expr->condition = parse_expression(Precedence::LOWEST); if (peek_token.type != TokenType::RPAREN) return nullptr; next_token(); if (peek_token.type != TokenType::LBRACE) return nullptr; next_token(); expr->consequence = parse_block_statement(); if (peek_token.type == TokenType::ELSE) { next_token(); if (peek_token.type != TokenType::LBRACE) return nullptr; next_token(); expr->alternative = parse_block_statement(); } return expr; }
+// `match (subject) { arm, ... }`; commas between arms are optional after a block.
+std::unique_ptr<Expression> Parser::parse_match_expression() {
+    auto expr = std::make_unique<MatchExpression>();
+    expr->token = current_token;
+    if (peek_token.type != TokenType::LPAREN) return nullptr;
+    next_token();
+    next_token();
+    expr->subject = parse_expression(Precedence::LOWEST);
+    if (!expr->subject || peek_token.type != TokenType::RPAREN) return nullptr;
+    next_token();
+    if (peek_token.type != TokenType::LBRACE) return nullptr;
+    next_token();
+    while (peek_token.type != TokenType::RBRACE) {
+        next_token();
+        MatchArm arm;
+        if (!parse_match_arm(arm)) return nullptr;
+        expr->arms.push_back(std::move(arm));
+        if (peek_token.type == TokenType::COMMA) next_token();
+        else if (peek_token.type != TokenType::RBRACE && current_token.type != TokenType::RBRACE) return nullptr;
+    }
+    next_token(); // Move to '}'
+    return expr;
+}
+// `patterns => body`, entered at the first pattern (or `else`) and left at
+// the last token of the body.
+bool Parser::parse_match_arm(MatchArm& arm) {
+    if (current_token.type == TokenType::ELSE) {
+        next_token();
+    } else {
+        while (true) {
+            MatchPattern pattern;
+            pattern.low = parse_expression(Precedence::LOWEST);
+            if (!pattern.low) return false;
+            if (peek_token.type == TokenType::DOT_DOT || peek_token.type == TokenType::DOT_DOT_EQUAL) {
+                next_token();
+                pattern.inclusive = current_token.type == TokenType::DOT_DOT_EQUAL;
+                next_token();
+                pattern.high = parse_expression(Precedence::LOWEST);
+                if (!pattern.high) return false;
+            }
+            arm.patterns.push_back(std::move(pattern));
+            next_token();
+            if (current_token.type != TokenType::COMMA) break;
+            next_token();
+        }
+    }
+    if (current_token.type != TokenType::FAT_ARROW) return false;
+    next_token();
+    if (current_token.type == TokenType::LBRACE) {
+        arm.body = parse_block_statement();
+        return true;
+    }
+    auto stmt = std::make_unique<ExpressionStatement>();
+    stmt->token = current_token;
+    stmt->expression = parse_expression(Precedence::LOWEST);
+    if (!stmt->expression) return false;
+    arm.body = std::make_unique<BlockStatement>();
+    arm.body->token = stmt->token;
+    arm.body->statements.push_back(std::move(stmt));
+    return true;
+}
 std::unique_ptr<Expression> Parser::parse_while_expression() { auto expr = std::make_unique<WhileExpression>(); expr->token = current_token; if (peek_token.type != TokenType::LPAREN) return nullptr; next_token(); next_token(); expr->condition = parse_expression(Precedence::LOWEST); if (peek_token.type != TokenType::RPAREN) return nullptr; next_token(); if (peek_token.type != TokenType::LBRACE) return nullptr; next_token(); expr->body = parse_block_statement(); return expr; }
 std::unique_ptr<Expression> Parser::parse_for_loop_expression() { auto expr = std::make_unique<ForLoopExpression>(); expr->token = current_token; if (peek_token.type != TokenType::LPAREN) return nullptr; next_token(); next_token(); if (current_token.type != TokenType::SEMICOLON) expr->initializer = parse_statement(); if (current_token.type != TokenType::SEMICOLON) return nullptr; next_token(); if (current_token.type != TokenType::SEMICOLON) expr->condition = parse_expression(Precedence::LOWEST); if (peek_token.type != TokenType::SEMICOLON) return nullptr; next_token(); next_token(); if (current_token.type != TokenType::RPAREN) expr->increment = parse_expression(Precedence::LOWEST); if (peek_token.type != TokenType::RPAREN) return nullptr; next_token(); if (peek_token.type != TokenType::LBRACE) return nullptr; next_token(); expr->body = parse_block_statement(); return expr; }
-std::vector<std::unique_ptr<Identifier>> Parser::parse_function_parameters() { std::vector<std::unique_ptr<Identifier>> params; if (peek_token.type == TokenType::RPAREN) { next_token(); return params; } next_token(); auto ident = std::make_unique<Identifier>(); ident->token = current_token; ident->value = current_token.literal; params.push_back(std::move(ident)); while (peek_token.type == TokenType::COMMA) { next_token(); next_token(); auto next_ident = std::make_unique<Identifier>(); next_ident->token = current_token; next_ident->value = current_token.literal; params.push_back(std::move(next_ident)); } if (peek_token.type != TokenType::RPAREN) return {}; next_token(); return params; }
-std::unique_ptr<Expression> Parser::parse_function_literal() { auto func = std::make_unique<FunctionLiteral>(); func->token = current_token; if (peek_token.type != TokenType::LPAREN) return nullptr; next_token(); func->parameters = parse_function_parameters(); if (peek_token.type != TokenType::LBRACE) return nullptr; next_token(); func->body = parse_block_statement(); return func; }
\ No newline at end of file
+// Parameters are `name` or `name: type`; the type defaults to i32.
+bool Parser::parse_function_parameters(FunctionLiteral& func) {
+    if (peek_token.type == TokenType::RPAREN) { next_token(); return true; }
+    while (true) {
+        next_token(); // Move past '(' or ',' to the name
+        if (current_token.type != TokenType::IDENTIFIER) return false;
+        auto ident = std::make_unique<Identifier>(); ident->token = current_token; ident->symbol = current_token.symbol;
+        std::unique_ptr<TypeAnnotation> type;
+        if (peek_token.type == TokenType::COLON) { next_token(); next_token(); type = parse_type_annotation(); if (!type) return false; }
+        func.parameters.push_back(std::move(ident));
+        func.parameter_types.push_back(std::move(type));
+        if (peek_token.type != TokenType::COMMA) break;
+        next_token();
+    }
+    if (peek_token.type != TokenType::RPAREN) return false;
+    next_token();
+    return true;
+}
+// Type parameters are `<T, U>`, entered with '<' as the peek token.
+bool Parser::parse_type_parameters(FunctionLiteral& func) {
+    next_token(); // Move to '<'
+    do {
+        next_token(); // Move past '<' or ',' to the name
+        if (current_token.type != TokenType::IDENTIFIER) return false;
+        func.type_parameters.push_back(current_token.symbol);
+        next_token();
+    } while (current_token.type == TokenType::COMMA);
+    return current_token.type == TokenType::GREATER;
+}
+std::unique_ptr<Expression> Parser::parse_function_literal() { auto func = std::make_unique<FunctionLiteral>(); func->token = current_token; if (peek_token.type == TokenType::LESS && !parse_type_parameters(*func)) return nullptr; if (peek_token.type != TokenType::LPAREN) return nullptr; next_token(); if (!parse_function_parameters(*func)) return nullptr; if (peek_token.type == TokenType::ARROW) { next_token(); next_token(); func->return_type = parse_type_annotation(); if (!func->return_type) return nullptr; } if (peek_token.type != TokenType::LBRACE) return nullptr; next_token(); func->body = parse_block_statement(); func->end_offset = current_token.offset + 1; return func; }
+std::unique_ptr<Expression> Parser::parse_async_function_literal() { if (peek_token.type != TokenType::FN) return nullptr; next_token(); auto func = parse_function_literal(); if (func) static_cast<FunctionLiteral&>(*func).is_async = true; return func; }
+// `@name` is an annotation rather than a builtin call when no arguments
+// follow, or when it is one of the annotations that take them.
+bool Parser::is_annotation() const {
+    static const Symbol target_clones = intern("target_clones");
+    return current_token.type == TokenType::BUILTIN && (peek_token.type != TokenType::LPAREN || current_token.symbol == target_clones);
+}
+// `@name @name(arg, ...) ...`: reads annotations while is_annotation(),
+// leaving the current token at what they apply to.
+bool Parser::parse_annotations(std::vector<Annotation>& annotations) {
+    while (is_annotation()) {
+        Annotation annotation;
+        annotation.name = current_token.symbol;
+        if (peek_token.type == TokenType::LPAREN) {
+            next_token();
+            for (const auto& argument : parse_call_arguments()) {
+                auto const* name = dynamic_cast<const Identifier*>(argument.get());
+                if (!name) return false;
+                annotation.arguments.push_back(name->symbol);
+            }
+            if (annotation.arguments.empty()) return false;
+        }
+        annotations.push_back(std::move(annotation));
+        next_token();
+    }
+    return true;
+}
+// `@name ... fn(...) { ... }` or `@name ... match`, entered at the first annotation.
+std::unique_ptr<Expression> Parser::parse_annotated_expression() {
+    std::vector<Annotation> annotations;
+    if (!parse_annotations(annotations)) return nullptr;
+    return annotate_expression(std::move(annotations));
+}
+// The function or match that annotations apply to, entered at it.
+std::unique_ptr<Expression> Parser::annotate_expression(std::vector<Annotation> annotations) {
+    if (current_token.type == TokenType::MATCH) {
+        auto match = parse_match_expression();
+        if (match) static_cast<MatchExpression&>(*match).annotations = std::move(annotations);
+        return match;
+    }
+    std::unique_ptr<Expression> func;
+    if (current_token.type == TokenType::FN) func = parse_function_literal();
+    else if (current_token.type == TokenType::ASYNC) func = parse_async_function_literal();
+    if (func) static_cast<FunctionLiteral&>(*func).annotations = std::move(annotations);
+    return func;
+}
+std::unique_ptr<Expression> Parser::parse_await_expression() { auto expr = std::make_unique<AwaitExpression>(); expr->token = current_token; next_token(); expr->task = parse_expression(Precedence::PREFIX); if (!expr->task) return nullptr; return expr; }
+
+// `Name { field: value, ... }`, entered with the name as the current token.
+std::unique_ptr<Expression> Parser::parse_struct_literal() {
+    auto literal = std::make_unique<StructLiteral>();
+    literal->token = current_token;
+    literal->type_name = current_token.symbol;
+    next_token(); // Move to '{'
+    while (peek_token.type != TokenType::RBRACE) {
+        next_token();
+        if (current_token.type != TokenType::IDENTIFIER || peek_token.type != TokenType::COLON) return nullptr;
+        auto field = std::make_unique<Identifier>(); field->token = current_token; field->symbol = current_token.symbol;
+        next_token(); // Move to ':'
+        next_token(); // Move to the value
+        auto value = parse_expression(Precedence::LOWEST);
+        if (!value) return nullptr;
+        literal->fields.emplace_back(std::move(field), std::move(value));
+        if (peek_token.type == TokenType::COMMA) next_token();
+        else if (peek_token.type != TokenType::RBRACE) return nullptr;
+    }
+    next_token(); // Move to '}'
+    return literal;
+}
+
+std::unique_ptr<Expression> Parser::parse_member_expression(std::unique_ptr<Expression> left) {
+    auto expr = std::make_unique<MemberExpression>(); expr->token = current_token; expr->left = std::move(left);
+    if (peek_token.type != TokenType::IDENTIFIER) return nullptr;
+    next_token();
+    expr->field = std::make_unique<Identifier>(); expr->field->token = current_token; expr->field->symbol = current_token.symbol;
+    return expr;
+}
+
+// Parses the type starting at the current token: `name`, `*T` or `[]T`.
+std::unique_ptr<TypeAnnotation> Parser::parse_type_annotation() {
+    auto type = std::make_unique<TypeAnnotation>();
+    type->token = current_token;
+    if (current_token.type == TokenType::IDENTIFIER) { type->name = current_token.symbol; return type; }
+    if (current_token.type == TokenType::STAR) { type->kind = TypeAnnotation::Kind::Pointer; }
+    else if (current_token.type == TokenType::LBRACKET && peek_token.type == TokenType::RBRACKET) { type->kind = TypeAnnotation::Kind::Slice; next_token(); }
+    else return nullptr;
+    next_token();
+    type->element = parse_type_annotation();
+    if (!type->element) return nullptr;
+    return type;
+}
\ No newline at end of file
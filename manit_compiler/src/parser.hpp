@@ -36,30 +36,48 @@ private:
     std::unique_ptr<LetStatement> parse_let_statement();
     std::unique_ptr<VarStatement> parse_var_statement();
     std::unique_ptr<StructDefinitionStatement> parse_struct_definition_statement();
+    std::unique_ptr<ImportStatement> parse_import_statement();
+    std::unique_ptr<Statement> parse_public_declaration();
+    std::unique_ptr<Statement> parse_annotated_statement();
     std::unique_ptr<ReturnStatement> parse_return_statement();
     std::unique_ptr<ExpressionStatement> parse_expression_statement();
     std::unique_ptr<BlockStatement> parse_block_statement();
     
     // Expression Parsers
     std::unique_ptr<Expression> parse_expression(Precedence precedence);
+    std::unique_ptr<Expression> parse_operators(std::unique_ptr<Expression> left, Precedence precedence);
     std::unique_ptr<Expression> parse_identifier();
     std::unique_ptr<Expression> parse_integer_literal();
     std::unique_ptr<Expression> parse_boolean_literal();
+    std::unique_ptr<Expression> parse_grouped_expression();
     std::unique_ptr<Expression> parse_array_literal();
     std::unique_ptr<Expression> parse_prefix_expression();
     std::unique_ptr<Expression> parse_infix_expression(std::unique_ptr<Expression> left);
     std::unique_ptr<Expression> parse_assignment_expression(std::unique_ptr<Expression> left);
     std::unique_ptr<Expression> parse_index_expression(std::unique_ptr<Expression> left);
+    std::unique_ptr<Expression> parse_member_expression(std::unique_ptr<Expression> left);
+    std::unique_ptr<Expression> parse_struct_literal();
     std::unique_ptr<Expression> parse_if_expression();
+    std::unique_ptr<Expression> parse_match_expression();
     std::unique_ptr<Expression> parse_function_literal();
+    std::unique_ptr<Expression> parse_async_function_literal();
+    std::unique_ptr<Expression> parse_annotated_expression();
+    std::unique_ptr<Expression> annotate_expression(std::vector<Annotation> annotations);
+    std::unique_ptr<Expression> parse_await_expression();
     std::unique_ptr<Expression> parse_call_expression(std::unique_ptr<Expression> function);
+    std::unique_ptr<Expression> parse_builtin_call();
     std::unique_ptr<Expression> parse_while_expression();
     std::unique_ptr<Expression> parse_for_loop_expression();
 
     // Parser Helpers
-    std::vector<std::unique_ptr<Identifier>> parse_function_parameters();
+    bool parse_type_parameters(FunctionLiteral& func);
+    bool parse_match_arm(MatchArm& arm);
+    bool parse_function_parameters(FunctionLiteral& func);
+    std::unique_ptr<TypeAnnotation> parse_type_annotation();
     std::vector<std::unique_ptr<Expression>> parse_call_arguments();
     std::vector<std::unique_ptr<Expression>> parse_expression_list(TokenType end_token);
+    bool is_annotation() const;
+    bool parse_annotations(std::vector<Annotation>& annotations);
     Precedence peek_precedence();
     Precedence current_precedence();
 };
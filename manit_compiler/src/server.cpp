@@ -0,0 +1,134 @@
+#include "server.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static const size_t kMaxRequestBytes = 1 << 20;
+
+// Reads arguments up to the terminating empty line. Returns false on a
+// truncated or oversized request.
+static bool read_request(int fd, std::vector<std::string>& args) {
+    std::string data;
+    char buffer[4096];
+    while (data.size() < kMaxRequestBytes) {
+        size_t end = data.find("\n\n");
+        if (end != std::string::npos || (data == "\n")) {
+            std::stringstream lines(data.substr(0, end == std::string::npos ? 0 : end));
+            std::string line;
+            while (std::getline(lines, line)) {
+                if (!line.empty() && line.back() == '\r') line.pop_back();
+                args.push_back(line);
+            }
+            return true;
+        }
+        ssize_t n = read(fd, buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data.append(buffer, static_cast<size_t>(n));
+    }
+    return false;
+}
+
+static void write_all(int fd, const std::string& data) {
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t n = write(fd, data.data() + written, data.size() - written);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+        written += static_cast<size_t>(n);
+    }
+}
+
+static void handle_connection(int fd, const DriverOptions& defaults, int listen_fd, std::atomic<bool>& stopping) {
+    std::vector<std::string> args;
+    if (!read_request(fd, args)) {
+        write_all(fd, "status 1\nError: Malformed request\n");
+        close(fd);
+        return;
+    }
+
+    if (args.size() == 1 && args[0] == "--shutdown-server") {
+        stopping = true;
+        write_all(fd, "status 0\n");
+        close(fd);
+        shutdown(listen_fd, SHUT_RDWR); // Wakes the accept loop
+        return;
+    }
+
+    DriverOptions options = defaults;
+    options.inputs.clear();
+    options.server_socket.clear();
+    std::stringstream diagnostics;
+    int exit_code = 1;
+    if (!parse_command_line(args, options, diagnostics)) {
+        // Message already in diagnostics
+    } else if (options.inputs.empty()) {
+        diagnostics << "Error: No input files" << std::endl;
+    } else {
+        exit_code = 0;
+        for (const auto& input : options.inputs) {
+            std::string output = options.output_path.empty() ? batch_output_path(input, options) : options.output_path;
+            CompileResult result = compile_file(input, output, options);
+            diagnostics << result.diagnostics << result.report;
+            exit_code = std::max(exit_code, result.exit_code);
+        }
+    }
+
+    write_all(fd, "status " + std::to_string(exit_code) + "\n" + diagnostics.str());
+    close(fd);
+}
+
+int run_server(const DriverOptions& defaults, std::ostream& err) {
+    const std::string& socket_path = defaults.server_socket;
+    sockaddr_un address{};
+    if (socket_path.size() >= sizeof(address.sun_path)) {
+        err << "Error: Socket path '" << socket_path << "' is too long" << std::endl;
+        return 1;
+    }
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        err << "Error: Could not create socket: " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    unlink(socket_path.c_str()); // Left behind by a previous server that was killed
+    if (bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || listen(listen_fd, 128) < 0) {
+        err << "Error: Could not listen on '" << socket_path << "': " << std::strerror(errno) << std::endl;
+        close(listen_fd);
+        return 1;
+    }
+
+    // A client that disconnects early must not kill the server.
+    std::signal(SIGPIPE, SIG_IGN);
+
+    std::atomic<bool> stopping{false};
+    {
+        ThreadPool pool(defaults.jobs);
+        while (!stopping) {
+            int fd = accept(listen_fd, nullptr, nullptr);
+            if (fd < 0) {
+                if (errno == EINTR) continue;
+                break;
+            }
+            pool.submit([fd, &defaults, listen_fd, &stopping]() {
+                handle_connection(fd, defaults, listen_fd, stopping);
+            });
+        }
+        pool.wait();
+    }
+
+    close(listen_fd);
+    unlink(socket_path.c_str());
+    return 0;
+}
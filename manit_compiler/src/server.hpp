@@ -0,0 +1,24 @@
+#ifndef MANIT_SERVER_HPP
+#define MANIT_SERVER_HPP
+
+#include "driver.hpp"
+#include <ostream>
+
+// Keeps manitc resident on the Unix domain socket defaults.server_socket so
+// build systems can submit compiles without paying process startup.
+//
+// Protocol, one request per connection: the client writes the arguments of a
+// manitc invocation one per line and ends the request with an empty line.
+// Arguments are parsed on top of the server's own options (so `manitc
+// --server=s -O2` makes -O2 the default). Every input is written to `-o`, or
+// to <input>.ll (see --out-dir) when there is none; relative paths are resolved
+// against --working-directory. The server replies with "status <code>\n"
+// followed by any diagnostics, then closes the connection. A request whose
+// only argument is --shutdown-server stops the server.
+//
+// Requests run concurrently on defaults.jobs worker threads.
+//
+//   printf -- '-O2\n--working-directory=%s\nfoo.manit\n\n' "$PWD" | socat - UNIX-CONNECT:/tmp/manitc.sock
+int run_server(const DriverOptions& defaults, std::ostream& err);
+
+#endif // MANIT_SERVER_HPP
@@ -0,0 +1,18 @@
+#include "source_map.hpp"
+#include <algorithm>
+
+SourceMap::SourceMap(const std::string& source) {
+    line_starts.push_back(0);
+    for (std::uint32_t i = 0; i < source.size(); ++i) {
+        if (source[i] == '\n') line_starts.push_back(i + 1);
+    }
+}
+
+SourceLocation SourceMap::locate(std::uint32_t offset) const {
+    // The last line start at or before offset.
+    auto it = std::upper_bound(line_starts.begin(), line_starts.end(), offset) - 1;
+    SourceLocation loc;
+    loc.line = static_cast<unsigned>(it - line_starts.begin()) + 1;
+    loc.column = offset - *it + 1;
+    return loc;
+}
@@ -0,0 +1,25 @@
+#ifndef MANIT_SOURCE_MAP_HPP
+#define MANIT_SOURCE_MAP_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct SourceLocation {
+    unsigned line = 1;   // 1-based
+    unsigned column = 1; // 1-based, in bytes
+};
+
+// Turns token offsets back into line/column pairs. Tokens only carry an
+// offset; the line table is built once per file and searched on demand, so
+// the lexer pays nothing for locations that are never asked for.
+class SourceMap {
+public:
+    explicit SourceMap(const std::string& source);
+    SourceLocation locate(std::uint32_t offset) const;
+
+private:
+    std::vector<std::uint32_t> line_starts;
+};
+
+#endif // MANIT_SOURCE_MAP_HPP
@@ -0,0 +1,83 @@
+#include "symbol.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace {
+
+// Spellings live in fixed-size chunks that never move, so symbol_name() can
+// read them without taking the lock while other threads intern new names.
+// Chunks are found through directories of chunk pointers, allocated as the
+// symbols grow, which covers every 32-bit id without reserving the table.
+constexpr std::uint32_t chunk_bits = 12;
+constexpr std::uint32_t chunk_size = 1u << chunk_bits;
+constexpr std::uint32_t directory_bits = 10;
+constexpr std::uint32_t directory_size = 1u << directory_bits;
+constexpr std::uint32_t max_directories = 1u << (32 - chunk_bits - directory_bits);
+
+class Interner {
+public:
+    Interner() { intern(""); }
+
+    Symbol intern(std::string_view text) {
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex);
+            auto it = ids.find(text);
+            if (it != ids.end()) return it->second;
+        }
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        auto it = ids.find(text);
+        if (it != ids.end()) return it->second;
+
+        Symbol id = count.load(std::memory_order_relaxed);
+        if (id == std::numeric_limits<Symbol>::max()) {
+            std::cerr << "Error: Too many distinct identifiers" << std::endl;
+            std::abort();
+        }
+        std::uint32_t chunk = id >> chunk_bits;
+        std::atomic<std::string*>* directory = directories[chunk >> directory_bits].load(std::memory_order_relaxed);
+        if (!directory) {
+            directory = new std::atomic<std::string*>[directory_size]();
+            directories[chunk >> directory_bits].store(directory, std::memory_order_release);
+        }
+        std::atomic<std::string*>& entry = directory[chunk & (directory_size - 1)];
+        if (!entry.load(std::memory_order_relaxed)) entry.store(new std::string[chunk_size], std::memory_order_release);
+        std::string& slot = entry.load(std::memory_order_relaxed)[id & (chunk_size - 1)];
+        slot.assign(text.data(), text.size());
+        ids.emplace(std::string_view(slot), id);
+        count.store(id + 1, std::memory_order_release);
+        return id;
+    }
+
+    const std::string& name(Symbol symbol) const {
+        std::uint32_t chunk = symbol >> chunk_bits;
+        std::atomic<std::string*>* directory = directories[chunk >> directory_bits].load(std::memory_order_acquire);
+        return directory[chunk & (directory_size - 1)].load(std::memory_order_acquire)[symbol & (chunk_size - 1)];
+    }
+
+private:
+    std::shared_mutex mutex;
+    std::unordered_map<std::string_view, Symbol> ids; // Keys view the strings in chunks
+    std::atomic<std::atomic<std::string*>*> directories[max_directories] = {};
+    std::atomic<Symbol> count{0};
+};
+
+Interner& interner() {
+    static Interner* instance = new Interner(); // Never destroyed: symbols outlive static teardown
+    return *instance;
+}
+
+} // namespace
+
+Symbol intern(std::string_view text) {
+    return interner().intern(text);
+}
+
+const std::string& symbol_name(Symbol symbol) {
+    return interner().name(symbol);
+}
@@ -0,0 +1,41 @@
+#ifndef MANIT_SYMBOL_HPP
+#define MANIT_SYMBOL_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Interned identifier. Equal spellings always get the same id, so the parser
+// and code generator compare and index by integer instead of by string. Ids
+// are process-wide and shared by concurrent compilations.
+using Symbol = std::uint32_t;
+
+// Id of the empty string; also used for "no symbol".
+constexpr Symbol no_symbol = 0;
+
+// Returns the symbol for text, adding it on first use. Thread-safe.
+Symbol intern(std::string_view text);
+
+// Spelling of a symbol returned by intern(). Thread-safe and lock-free; the
+// reference stays valid for the life of the process.
+const std::string& symbol_name(Symbol symbol);
+
+// Table keyed by symbol, for lookups on every identifier. Absent entries
+// read as T() (null for pointers). It is a hash map rather than a vector
+// indexed by id: ids are process-wide, so a resident compiler (--server)
+// would otherwise size every table by all the names any earlier compile saw.
+template <typename T>
+class SymbolMap {
+public:
+    T lookup(Symbol symbol) const {
+        auto it = values.find(symbol);
+        return it != values.end() ? it->second : T();
+    }
+    T& operator[](Symbol symbol) { return values[symbol]; }
+
+private:
+    std::unordered_map<Symbol, T> values;
+};
+
+#endif // MANIT_SYMBOL_HPP
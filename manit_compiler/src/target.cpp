@@ -0,0 +1,63 @@
+#include "target.hpp"
+#include <llvm/ADT/StringMap.h>
+#include <llvm/MC/MCSubtargetInfo.h>
+#include <llvm/MC/TargetRegistry.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Target/TargetMachine.h>
+#include <llvm/TargetParser/Host.h>
+#include <mutex>
+
+static const llvm::Target* host_target(std::string& error) {
+    static std::once_flag initialized;
+    std::call_once(initialized, [] {
+        llvm::InitializeNativeTarget();
+        llvm::InitializeNativeTargetAsmPrinter();
+    });
+    return llvm::TargetRegistry::lookupTarget(llvm::sys::getDefaultTargetTriple(), error);
+}
+
+void resolve_native_target(CodeGenOptions& options) {
+    if (options.target_cpu != "native") return;
+    options.target_cpu = llvm::sys::getHostCPUName().str();
+    std::string features;
+    for (const auto& feature : llvm::sys::getHostCPUFeatures()) {
+        features += (features.empty() ? "" : ",") + std::string(feature.second ? "+" : "-") + feature.first().str();
+    }
+    if (!options.target_features.empty()) features += (features.empty() ? "" : ",") + options.target_features;
+    options.target_features = features;
+}
+
+bool check_target_options(const CodeGenOptions& options, std::string& error) {
+    if (options.target_cpu.empty()) return true;
+    const llvm::Target* target = host_target(error);
+    if (!target) return false;
+    std::string triple = llvm::sys::getDefaultTargetTriple();
+    std::unique_ptr<llvm::MCSubtargetInfo> subtarget(target->createMCSubtargetInfo(triple, "", ""));
+    if (subtarget && subtarget->isCPUStringValid(options.target_cpu)) return true;
+    error = "Unknown target CPU '" + options.target_cpu + "' for " + triple;
+    return false;
+}
+
+std::unique_ptr<llvm::TargetMachine> create_target_machine(const CodeGenOptions& options, std::string& error) {
+    const llvm::Target* target = host_target(error);
+    if (!target) return nullptr;
+    std::string cpu = options.target_cpu.empty() ? "generic" : options.target_cpu;
+    return std::unique_ptr<llvm::TargetMachine>(target->createTargetMachine(
+        llvm::sys::getDefaultTargetTriple(), cpu, options.target_features, llvm::TargetOptions(), llvm::Reloc::PIC_));
+}
+
+// Ordered from the least to the most preferred version.
+static const CloneTarget clone_targets[] = {
+    {"popcnt", "+popcnt", 2, 0},   {"sse4_1", "+sse4.1", 7, 1}, {"sse4_2", "+sse4.2", 8, 2},
+    {"avx", "+avx", 9, 3},         {"bmi", "+bmi", 16, 4},      {"bmi2", "+bmi2", 17, 5},
+    {"avx2", "+avx2", 10, 6},      {"fma", "+fma", 14, 7},      {"avx512f", "+avx512f", 15, 8},
+    {"avx512cd", "+avx512cd", 23, 9}, {"avx512dq", "+avx512dq", 22, 10}, {"avx512bw", "+avx512bw", 21, 11},
+    {"avx512vl", "+avx512vl", 20, 12},
+};
+
+const CloneTarget* find_clone_target(const std::string& name) {
+    for (const auto& clone : clone_targets) {
+        if (name == clone.name) return &clone;
+    }
+    return nullptr;
+}
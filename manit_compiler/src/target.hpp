@@ -0,0 +1,42 @@
+#ifndef MANIT_TARGET_HPP
+#define MANIT_TARGET_HPP
+
+#include "codegen.hpp"
+#include <memory>
+#include <string>
+
+namespace llvm {
+    class TargetMachine;
+}
+
+// Target selection (--target-cpu, --target-features).
+//
+// Modules are always compiled for the host triple. The CPU and feature
+// string, when given, are also set on every function, which is what the
+// backend and the optimizer's cost model read; without them the target's
+// baseline CPU is assumed.
+
+// Replaces --target-cpu=native by the host CPU, and prepends the host's
+// features to options.target_features. The user's own features come last
+// so they can still turn a host feature off.
+void resolve_native_target(CodeGenOptions& options);
+
+// Checks that options.target_cpu names a CPU the host target knows.
+bool check_target_options(const CodeGenOptions& options, std::string& error);
+
+// Target machine for the host triple with the CPU and features of options.
+// Returns nullptr and sets error if the host target is not available.
+std::unique_ptr<llvm::TargetMachine> create_target_machine(const CodeGenOptions& options, std::string& error);
+
+// A version of a function that @target_clones can ask for on x86.
+struct CloneTarget {
+    const char* name;      // As written in the annotation
+    const char* feature;   // LLVM target feature enabled for the version
+    unsigned cpu_feature;  // Bit in __cpu_model.__cpu_features[0] (libgcc and compiler-rt)
+    unsigned priority;     // The resolver tries versions in decreasing priority
+};
+
+// The clone target called name, or nullptr if there is none.
+const CloneTarget* find_clone_target(const std::string& name);
+
+#endif // MANIT_TARGET_HPP
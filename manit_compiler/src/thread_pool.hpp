@@ -0,0 +1,40 @@
+#ifndef MANIT_THREAD_POOL_HPP
+#define MANIT_THREAD_POOL_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size pool of worker threads consuming a FIFO of tasks.
+class ThreadPool {
+public:
+    // thread_count == 0 selects std::thread::hardware_concurrency().
+    explicit ThreadPool(std::size_t thread_count);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(std::function<void()> task);
+    // Blocks until every submitted task has finished.
+    void wait();
+
+    std::size_t size() const { return workers.size(); }
+
+private:
+    void worker_loop();
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable task_available;
+    std::condition_variable all_done;
+    std::size_t active = 0;
+    bool stopping = false;
+};
+
+#endif // MANIT_THREAD_POOL_HPP
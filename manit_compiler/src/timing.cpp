@@ -0,0 +1,109 @@
+#include "timing.hpp"
+#include <ctime>
+#include <iomanip>
+#include <sys/resource.h>
+
+double thread_cpu_time_ms() {
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+long peak_rss_kb() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss; // Reported in kilobytes on Linux
+}
+
+void TimeReport::begin_phase(const std::string& name) {
+    end_phase();
+    PhaseRecord record;
+    record.name = name;
+    records.push_back(record);
+    running = true;
+    wall_start = std::chrono::steady_clock::now();
+    cpu_start_ms = thread_cpu_time_ms();
+}
+
+void TimeReport::end_phase() {
+    if (!running) return;
+    PhaseRecord& record = records.back();
+    record.wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wall_start).count();
+    record.cpu_ms = thread_cpu_time_ms() - cpu_start_ms;
+    record.peak_rss_kb = peak_rss_kb();
+    running = false;
+}
+
+void TimeReport::add_count(const std::string& name, std::uint64_t value) {
+    if (records.empty()) return;
+    records.back().counts.emplace_back(name, value);
+}
+
+void TimeReport::print_table(std::ostream& os) const {
+    double total_wall = 0, total_cpu = 0;
+    for (const auto& r : records) { total_wall += r.wall_ms; total_cpu += r.cpu_ms; }
+
+    os << "===-------------------------------------------------------------------------===\n"
+       << "                          ManiT compile time report\n"
+       << "===-------------------------------------------------------------------------===\n";
+    os << std::left << std::setw(12) << "Phase" << std::right
+       << std::setw(12) << "Wall (ms)" << std::setw(8) << "%"
+       << std::setw(12) << "CPU (ms)" << std::setw(14) << "Peak RSS (KB)" << "  Counts\n";
+    os << std::fixed << std::setprecision(3);
+    for (const auto& r : records) {
+        os << std::left << std::setw(12) << r.name << std::right
+           << std::setw(12) << r.wall_ms
+           << std::setw(7) << std::setprecision(1) << (total_wall > 0 ? 100.0 * r.wall_ms / total_wall : 0.0) << "%"
+           << std::setprecision(3) << std::setw(12) << r.cpu_ms
+           << std::setw(14) << r.peak_rss_kb << " ";
+        for (const auto& c : r.counts) os << " " << c.first << "=" << c.second;
+        os << "\n";
+    }
+    os << std::left << std::setw(12) << "Total" << std::right
+       << std::setw(12) << total_wall << std::setw(8) << "100.0%"
+       << std::setw(12) << total_cpu << std::setw(14) << peak_rss_kb() << "\n";
+    os << std::defaultfloat;
+}
+
+static void write_json_string(std::ostream& os, const std::string& s) {
+    os << '"';
+    for (char c : s) {
+        switch (c) {
+            case '"': os << "\\\""; break;
+            case '\\': os << "\\\\"; break;
+            case '\n': os << "\\n"; break;
+            case '\t': os << "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    os << "\\u" << std::hex << std::setw(4) << std::setfill('0') << int(c) << std::dec << std::setfill(' ');
+                } else {
+                    os << c;
+                }
+        }
+    }
+    os << '"';
+}
+
+void TimeReport::print_json(std::ostream& os, const std::string& input_name) const {
+    double total_wall = 0, total_cpu = 0;
+    for (const auto& r : records) { total_wall += r.wall_ms; total_cpu += r.cpu_ms; }
+
+    os << "{\"input\":";
+    write_json_string(os, input_name);
+    os << ",\"phases\":[";
+    for (size_t i = 0; i < records.size(); ++i) {
+        const auto& r = records[i];
+        os << (i ? "," : "") << "{\"name\":";
+        write_json_string(os, r.name);
+        os << ",\"wall_ms\":" << r.wall_ms << ",\"cpu_ms\":" << r.cpu_ms
+           << ",\"peak_rss_kb\":" << r.peak_rss_kb << ",\"counts\":{";
+        for (size_t j = 0; j < r.counts.size(); ++j) {
+            os << (j ? "," : "");
+            write_json_string(os, r.counts[j].first);
+            os << ":" << r.counts[j].second;
+        }
+        os << "}}";
+    }
+    os << "],\"total_wall_ms\":" << total_wall << ",\"total_cpu_ms\":" << total_cpu
+       << ",\"peak_rss_kb\":" << peak_rss_kb() << "}\n";
+}
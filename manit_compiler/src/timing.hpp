@@ -0,0 +1,45 @@
+#ifndef MANIT_TIMING_HPP
+#define MANIT_TIMING_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Per-phase compile statistics collected for --time-report.
+struct PhaseRecord {
+    std::string name;
+    double wall_ms = 0;
+    double cpu_ms = 0;
+    long peak_rss_kb = 0; // Process high-water mark at the end of the phase
+    std::vector<std::pair<std::string, std::uint64_t>> counts;
+};
+
+class TimeReport {
+public:
+    // Starts a new phase, ending the current one if it is still running.
+    void begin_phase(const std::string& name);
+    void end_phase();
+    // Attaches a counter (tokens, AST nodes, IR instructions, ...) to the latest phase.
+    void add_count(const std::string& name, std::uint64_t value);
+
+    const std::vector<PhaseRecord>& phases() const { return records; }
+
+    void print_table(std::ostream& os) const;
+    void print_json(std::ostream& os, const std::string& input_name) const;
+
+private:
+    std::vector<PhaseRecord> records;
+    bool running = false;
+    std::chrono::steady_clock::time_point wall_start;
+    double cpu_start_ms = 0;
+};
+
+// CPU time consumed by the calling thread, in milliseconds.
+double thread_cpu_time_ms();
+// Peak resident set size of the process, in kilobytes.
+long peak_rss_kb();
+
+#endif // MANIT_TIMING_HPP
@@ -1,24 +1,28 @@
 #ifndef MANIT_TOKEN_HPP
 #define MANIT_TOKEN_HPP
 
+#include "symbol.hpp"
+#include <cstdint>
 #include <string>
 #include <vector>
 
 enum class TokenType {
     // Keywords
-    FN, LET, VAR, IF, ELSE, WHILE, FOR, RETURN, TRUE, FALSE, STRUCT,
+    FN, LET, VAR, IF, ELSE, MATCH, WHILE, FOR, RETURN, TRUE, FALSE, STRUCT, IMPORT, PUB, ASYNC, AWAIT,
 
     // Identifiers and Literals
-    IDENTIFIER, INTEGER_LITERAL,
+    IDENTIFIER, INTEGER_LITERAL, BUILTIN, // BUILTIN: `@name`, symbol holds name
 
     // Operators
-    PLUS, MINUS, STAR, SLASH,
+    PLUS, MINUS, STAR, SLASH, AMPERSAND,
+    PLUS_PERCENT, MINUS_PERCENT, STAR_PERCENT, // Wrapping `+%`, `-%` and `*%`
     EQUAL, EQUAL_EQUAL, BANG, BANG_EQUAL,
     LESS, LESS_EQUAL, GREATER, GREATER_EQUAL,
 
     // Delimiters
     LPAREN, RPAREN, LBRACE, RBRACE, LBRACKET, RBRACKET,
-    COMMA, SEMICOLON, COLON,
+    COMMA, SEMICOLON, COLON, DOT, ARROW,
+    FAT_ARROW, DOT_DOT, DOT_DOT_EQUAL, // `=>`, `..` and `..=` in match arms
 
     // Special
     END_OF_FILE, ILLEGAL
@@ -26,7 +30,9 @@ enum class TokenType {
 
 struct Token {
     TokenType type;
-    std::string literal;
+    std::string literal;      // Spelling of keywords, numbers and operators; empty for identifiers
+    std::uint32_t offset = 0; // Byte offset of the first character in the source; see SourceMap
+    Symbol symbol = no_symbol; // Interned spelling of identifiers and keywords
 };
 
 #endif //MANIT_TOKEN_HPP
\ No newline at end of file
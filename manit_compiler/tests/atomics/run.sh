@@ -0,0 +1,24 @@
+#!/bin/bash
+# Multi-threaded stress test of the atomic builtins at one optimization level:
+#   manitc -ON lockfree.manit > lockfree.ll ; llc -ON lockfree.ll
+#   cc -ON -pthread stress.c lockfree.o && ./stress
+# Fails if any step fails or stress reports a broken invariant.
+#
+# Usage: run.sh [N] (default 0)
+# Environment: MANITC (default ../../build/manitc), LLC, CC.
+
+set -eu
+here=$(cd "$(dirname "$0")" && pwd)
+MANITC=${MANITC:-$here/../../build/manitc}
+LLC=${LLC:-llc}
+CC=${CC:-cc}
+level=${1:-0}
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+# The kernels are `pub` functions called only from C.
+"$MANITC" "-O$level" --keep-exported "$here/lockfree.manit" > "$work/lockfree.ll"
+"$LLC" "-O$level" -relocation-model=pic -filetype=obj "$work/lockfree.ll" -o "$work/lockfree.o"
+"$CC" "-O$level" -pthread "$here/stress.c" "$work/lockfree.o" -o "$work/stress"
+"$work/stress"
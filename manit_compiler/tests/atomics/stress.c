@@ -0,0 +1,92 @@
+/* Multi-threaded stress test of the atomic builtins: drives the kernels of
+ * lockfree.manit from pthreads and exits non-zero if any invariant breaks.
+ *   SPSC ring    one producer and one consumer pass 1..N in order
+ *   Treiber      THREADS threads pop and push NODES nodes; no node is ever
+ *                held by two threads, and all of them are back at the end
+ *   counter      four threads' fetch_add/fetch_sub balance out exactly */
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* ManiT slices are passed as a data pointer and an i64 length. */
+bool ring_push(int* head, int* tail, int* buf, long len, int v);
+bool ring_pop(int* head, int* tail, int* buf, long len, int* out);
+int stack_push(int* top, int* next, long len, int node);
+int stack_pop(int* top, int* next, long len);
+int counter_add(int64_t* c, int64_t* step, int n);
+
+enum { N = 2000000, CAP = 64, NODES = 256, THREADS = 8, ITERS = 400000, ROUNDS = 1000000, COUNTERS = 4 };
+
+static int head, tail, buf[CAP];
+static int top, next[NODES];
+static _Atomic int owner[NODES];
+static int64_t counter, step = 1;
+static _Atomic int errors;
+
+static void* producer(void* arg) {
+    (void)arg;
+    for (int i = 1; i <= N; ++i) {
+        while (!ring_push(&head, &tail, buf, CAP, i)) sched_yield();
+    }
+    return 0;
+}
+
+static void* consumer(void* arg) {
+    (void)arg;
+    int v, expect = 1;
+    while (expect <= N) {
+        if (!ring_pop(&head, &tail, buf, CAP, &v)) {
+            sched_yield();
+            continue;
+        }
+        if (v != expect) errors++;
+        expect++;
+    }
+    return 0;
+}
+
+static void* churn(void* arg) {
+    int id = (int)(intptr_t)arg;
+    for (int i = 0; i < ITERS; ++i) {
+        int node = stack_pop(&top, next, NODES);
+        if (node < 0) continue;
+        if (atomic_exchange(&owner[node], id + 1) != 0) errors++;
+        atomic_store(&owner[node], 0);
+        stack_push(&top, next, NODES, node);
+    }
+    return 0;
+}
+
+static void* count(void* arg) {
+    (void)arg;
+    counter_add(&counter, &step, ROUNDS);
+    return 0;
+}
+
+int main(void) {
+    pthread_t threads[THREADS];
+
+    pthread_create(&threads[0], 0, producer, 0);
+    pthread_create(&threads[1], 0, consumer, 0);
+    for (int i = 0; i < 2; ++i) pthread_join(threads[i], 0);
+    printf("spsc ring:     %d errors\n", errors);
+
+    for (int i = 0; i < NODES; ++i) stack_push(&top, next, NODES, i);
+    for (int i = 0; i < THREADS; ++i) pthread_create(&threads[i], 0, churn, (void*)(intptr_t)i);
+    for (int i = 0; i < THREADS; ++i) pthread_join(threads[i], 0);
+    int seen[NODES] = {0}, nodes = 0, node;
+    while ((node = stack_pop(&top, next, NODES)) >= 0) {
+        if (seen[node]++) errors++;
+        nodes++;
+    }
+    printf("treiber stack: %d errors, %d of %d nodes\n", errors, nodes, NODES);
+
+    for (int i = 0; i < COUNTERS; ++i) pthread_create(&threads[i], 0, count, 0);
+    for (int i = 0; i < COUNTERS; ++i) pthread_join(threads[i], 0);
+    printf("counter:       %lld of %lld\n", (long long)counter, (long long)COUNTERS * ROUNDS);
+
+    return errors != 0 || nodes != NODES || counter != (int64_t)COUNTERS * ROUNDS;
+}
@@ -0,0 +1,56 @@
+#!/bin/bash
+# Compiles and runs every program in this directory at one optimization
+# level. The first line of each states what it must do:
+#   // exit: N         compile, link and exit with status N
+#   // error: text     fail to compile with a message containing text
+#
+# Usage: run.sh [N] (default 0)
+# Environment: MANITC (default ../../build/manitc), LLC, CC.
+
+set -u
+here=$(cd "$(dirname "$0")" && pwd)
+MANITC=${MANITC:-$here/../../build/manitc}
+LLC=${LLC:-llc}
+CC=${CC:-cc}
+level=${1:-0}
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+failures=0
+for src in "$here"/*.manit; do
+    name=$(basename "$src" .manit)
+    expect=$(head -n 1 "$src")
+    if [[ $expect == "// error: "* ]]; then
+        message=${expect#// error: }
+        if "$MANITC" "-O$level" "$src" > "$work/$name.ll" 2> "$work/$name.err"; then
+            echo "FAIL $name: compiled, expected an error containing '$message'"
+            failures=$((failures + 1))
+        elif ! grep -qF -- "$message" "$work/$name.err"; then
+            echo "FAIL $name: expected an error containing '$message', got:"
+            cat "$work/$name.err"
+            failures=$((failures + 1))
+        fi
+        continue
+    fi
+    if [[ $expect != "// exit: "* ]]; then
+        echo "FAIL $name: first line must be '// exit: N' or '// error: text'"
+        failures=$((failures + 1))
+        continue
+    fi
+    if ! "$MANITC" "-O$level" "$src" > "$work/$name.ll" ||
+       ! "$LLC" "-O$level" -relocation-model=pic -filetype=obj "$work/$name.ll" -o "$work/$name.o" ||
+       ! "$CC" "$work/$name.o" -o "$work/$name"; then
+        echo "FAIL $name: build failed"
+        failures=$((failures + 1))
+        continue
+    fi
+    "$work/$name"
+    status=$?
+    if [ "$status" != "${expect#// exit: }" ]; then
+        echo "FAIL $name: exited with $status, expected ${expect#// exit: }"
+        failures=$((failures + 1))
+    fi
+done
+
+exit $((failures > 0))